@@ -0,0 +1,632 @@
+#include "benchmark_functions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "log_duration.h"
+#include "process_queries.h"
+#include "query_profiler.h"
+#include "query_result_cache.h"
+#include "remove_duplicates.h"
+#include "request_statistics.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "string_processing.h"
+
+using namespace std;
+
+namespace {
+
+// Реализация SplitIntoWords до перехода на блочный разбор
+vector<string_view> SplitIntoWordsWithFind(string_view str) {
+    vector<string_view> result;
+    str.remove_prefix(min(str.find_first_not_of(" "), str.size()));
+
+    while (str.size() != str.npos && !str.empty()) {
+        result.push_back(str.substr(0u, str.find(' ')));
+        str.remove_prefix(min(str.find(" "), str.size()));
+        str.remove_prefix(min(str.find_first_not_of(" "), str.size()));
+    }
+
+    return result;
+}
+
+bool IsValidWordByChar(string_view word) {
+    return none_of(word.begin(), word.end(), [](char c) {
+        return c >= '\0' && c < ' ';
+    });
+}
+
+vector<string> GenerateTexts(mt19937& generator, int text_count, int word_count, int max_word_length) {
+    vector<string> texts(text_count);
+    for (string& text : texts) {
+        for (int i = 0; i < word_count; ++i) {
+            text += string(uniform_int_distribution(1, 2)(generator), ' ');
+            const int length = uniform_int_distribution(1, max_word_length)(generator);
+            for (int j = 0; j < length; ++j) {
+                text.push_back(uniform_int_distribution('a', 'z')(generator));
+            }
+        }
+    }
+    return texts;
+}
+
+// Запрос из word_count слов словаря текстов; длина запросов разная, чтобы
+// работа делилась между потоками неравномерно
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& texts, int query_count, int max_word_count) {
+    vector<string> queries(query_count);
+    for (string& query : queries) {
+        const vector<string_view> words = SplitIntoWords(texts[uniform_int_distribution<size_t>(0, texts.size() - 1)(generator)]);
+        const int word_count = uniform_int_distribution(1, max_word_count)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            query += words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+            query.push_back(' ');
+        }
+    }
+    return queries;
+}
+
+// Номера от 0 до count - 1, i-й выпадает с вероятностью, пропорциональной 1 / (i + 1)^exponent
+vector<size_t> GenerateZipfIndices(mt19937& generator, size_t count, double exponent, size_t sample_count) {
+    vector<double> cumulative_weights(count);
+    double total_weight = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        total_weight += 1.0 / pow(static_cast<double>(i + 1), exponent);
+        cumulative_weights[i] = total_weight;
+    }
+    vector<size_t> indices(sample_count);
+    for (size_t& index : indices) {
+        const double weight = uniform_real_distribution<>(0.0, total_weight)(generator);
+        index = min(count - 1, static_cast<size_t>(lower_bound(cumulative_weights.begin(), cumulative_weights.end(), weight)
+                                                   - cumulative_weights.begin()));
+    }
+    return indices;
+}
+
+template <typename Function>
+void MeasureThroughput(const string& mark, size_t query_count, Function function) {
+    const auto start = chrono::steady_clock::now();
+    const double total_relevance = function();
+    const chrono::duration<double> duration = chrono::steady_clock::now() - start;
+    cout << mark << ": "s << static_cast<size_t>(query_count / duration.count()) << " queries/s, "s
+         << total_relevance << endl;
+}
+
+}  // namespace
+
+void BenchmarkSplitIntoWords() {
+    mt19937 generator;
+    const vector<string> texts = GenerateTexts(generator, 20'000, 70, 10);
+    const int repeat_count = 10;
+
+    size_t word_count = 0;
+    {
+        LOG_DURATION("SplitIntoWords with find"s);
+        for (int repeat = 0; repeat < repeat_count; ++repeat) {
+            for (const string& text : texts) {
+                word_count += SplitIntoWordsWithFind(text).size();
+            }
+        }
+    }
+    {
+        LOG_DURATION("SplitIntoWords"s);
+        for (int repeat = 0; repeat < repeat_count; ++repeat) {
+            for (const string& text : texts) {
+                word_count -= SplitIntoWords(text).size();
+            }
+        }
+    }
+    {
+        LOG_DURATION("SplitIntoWords into buffer"s);
+        vector<string_view> words;
+        for (int repeat = 0; repeat < repeat_count; ++repeat) {
+            for (const string& text : texts) {
+                SplitIntoWords(text, words);
+                word_count += words.size();
+            }
+        }
+    }
+
+    size_t valid_count = 0;
+    {
+        LOG_DURATION("IsValidWord by char"s);
+        for (int repeat = 0; repeat < repeat_count; ++repeat) {
+            for (const string& text : texts) {
+                valid_count += IsValidWordByChar(text);
+            }
+        }
+    }
+    {
+        LOG_DURATION("HasControlChars"s);
+        for (int repeat = 0; repeat < repeat_count; ++repeat) {
+            for (const string& text : texts) {
+                valid_count -= !HasControlChars(text);
+            }
+        }
+    }
+    // Счётчики не дают компилятору выбросить разбор; оба должны сойтись к числу слов и нулю
+    cout << word_count / repeat_count << ' ' << valid_count << endl;
+}
+
+void BenchmarkProcessQueries() {
+    mt19937 generator;
+    const vector<string> texts = GenerateTexts(generator, 20'000, 70, 4);
+    SearchServer search_server(""s);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const vector<string> queries = GenerateQueries(generator, texts, 2'000, 20);
+
+    MeasureThroughput("FindTopDocuments seq loop"s, queries.size(), [&] {
+        double total_relevance = 0;
+        for (const string& query : queries) {
+            for (const Document& document : search_server.FindTopDocuments(execution::seq, query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    MeasureThroughput("FindTopDocuments par loop"s, queries.size(), [&] {
+        double total_relevance = 0;
+        for (const string& query : queries) {
+            for (const Document& document : search_server.FindTopDocuments(execution::par, query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    MeasureThroughput("ProcessQueriesJoined"s, queries.size(), [&] {
+        double total_relevance = 0;
+        for (const Document& document : ProcessQueriesJoined(search_server, queries)) {
+            total_relevance += document.relevance;
+        }
+        return total_relevance;
+    });
+}
+
+void BenchmarkSharedScan() {
+    mt19937 generator;
+    const vector<string> dictionary = GenerateTexts(generator, 5'000, 1, 8);
+    SearchServer search_server(""s);
+    for (int id = 0; id < 20'000; ++id) {
+        string text;
+        for (int i = 0; i < 50; ++i) {
+            text += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    // Слова запросов берутся из первых vocabulary_size слов словаря: чем он меньше,
+    // тем больше слов у запросов пачки общие
+    for (const size_t vocabulary_size : {5'000u, 500u, 50u}) {
+        vector<string> queries(1'000);
+        for (string& query : queries) {
+            for (int i = 0; i < 5; ++i) {
+                query += dictionary[uniform_int_distribution<size_t>(0, vocabulary_size - 1)(generator)];
+            }
+        }
+        const string mark = " ("s + to_string(vocabulary_size) + " query words)"s;
+        MeasureThroughput("FindTopDocuments loop"s + mark, queries.size(), [&] {
+            double total_relevance = 0;
+            for (const string& query : queries) {
+                for (const Document& document : search_server.FindTopDocuments(query)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+        MeasureThroughput("FindTopDocumentsBatch"s + mark, queries.size(), [&] {
+            double total_relevance = 0;
+            for (const auto& documents : search_server.FindTopDocumentsBatch(queries)) {
+                for (const Document& document : documents) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+    }
+}
+
+void BenchmarkQueryResultCache() {
+    mt19937 generator;
+    const vector<string> dictionary = GenerateTexts(generator, 5'000, 1, 8);
+    SearchServer search_server(""s);
+    for (int id = 0; id < 20'000; ++id) {
+        string text;
+        for (int i = 0; i < 50; ++i) {
+            text += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    vector<string> distinct_queries(20'000);
+    for (string& query : distinct_queries) {
+        for (int i = 0; i < 3; ++i) {
+            query += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+    }
+    const vector<size_t> requests = GenerateZipfIndices(generator, distinct_queries.size(), 0.9, 100'000);
+
+    MeasureThroughput("Zipf without cache"s, requests.size(), [&] {
+        double total_relevance = 0;
+        for (const size_t request : requests) {
+            for (const Document& document : search_server.FindTopDocuments(distinct_queries[request])) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    for (const bool use_frequency_admission : {false, true}) {
+        QueryResultCache cache(search_server, {2'000, 16, use_frequency_admission});
+        MeasureThroughput(use_frequency_admission ? "Zipf with TinyLFU cache"s : "Zipf with LRU cache"s,
+                          requests.size(), [&] {
+            double total_relevance = 0;
+            for (const size_t request : requests) {
+                for (const Document& document : cache.FindTopDocuments(distinct_queries[request])) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+        cout << cache.GetStats() << endl;
+    }
+}
+
+void BenchmarkQuantizedScores() {
+    mt19937 generator;
+    const vector<string> dictionary = GenerateTexts(generator, 5'000, 1, 8);
+    SearchServer search_server(""s);
+    for (int id = 0; id < 50'000; ++id) {
+        string text;
+        for (int i = 0; i < uniform_int_distribution(5, 60)(generator); ++i) {
+            text += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    search_server.CompressIndex();
+    search_server.QuantizeIndex();
+    vector<string> queries(2'000);
+    for (string& query : queries) {
+        for (int i = 0; i < uniform_int_distribution(1, 6)(generator); ++i) {
+            query += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+    }
+
+    const SearchOptions exact_options{10, QueryEvaluation::EXHAUSTIVE};
+    const SearchOptions quantized_options{10, QueryEvaluation::QUANTIZED};
+    vector<vector<Document>> exact(queries.size());
+    vector<vector<Document>> quantized(queries.size());
+    MeasureThroughput("Exact scores"s, queries.size(), [&] {
+        double total_relevance = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            exact[i] = search_server.FindTopDocuments(execution::seq, queries[i], DocumentStatus::ACTUAL, exact_options);
+            for (const Document& document : exact[i]) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    MeasureThroughput("Quantized scores"s, queries.size(), [&] {
+        double total_relevance = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            quantized[i] = search_server.FindTopDocuments(execution::seq, queries[i], DocumentStatus::ACTUAL,
+                                                          quantized_options);
+            for (const Document& document : quantized[i]) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+
+    // Доля документов точного топа, попавших в квантованный, и ошибка релевантности на местах топа
+    size_t exact_count = 0;
+    size_t matched_count = 0;
+    double max_error = 0.0;
+    double total_relative_error = 0.0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        set<int> quantized_ids;
+        for (const Document& document : quantized[i]) {
+            quantized_ids.insert(document.id);
+        }
+        for (size_t j = 0; j < exact[i].size(); ++j) {
+            matched_count += quantized_ids.count(exact[i][j].id);
+            if (j < quantized[i].size()) {
+                const double error = abs(exact[i][j].relevance - quantized[i][j].relevance);
+                max_error = max(max_error, error);
+                total_relative_error += error / exact[i][j].relevance;
+            }
+        }
+        exact_count += exact[i].size();
+    }
+    cout << "Quantized recall@10: "s << static_cast<double>(matched_count) / exact_count
+         << ", max relevance error: "s << max_error
+         << ", mean relative error: "s << total_relative_error / exact_count << endl;
+}
+
+void BenchmarkStatusFilter() {
+    mt19937 generator;
+    const vector<string> dictionary = GenerateTexts(generator, 2'000, 1, 8);
+    const vector<DocumentStatus> statuses = {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT,
+                                             DocumentStatus::BANNED, DocumentStatus::REMOVED};
+    SearchServer search_server(""s);
+    for (int id = 0; id < 50'000; ++id) {
+        string text;
+        for (int i = 0; i < uniform_int_distribution(5, 60)(generator); ++i) {
+            text += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        search_server.AddDocument(id, text, statuses[uniform_int_distribution(0, 3)(generator)], {1, 2, 3});
+    }
+    vector<string> queries(2'000);
+    for (string& query : queries) {
+        for (int i = 0; i < uniform_int_distribution(1, 6)(generator); ++i) {
+            query += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+    }
+
+    const auto is_actual = [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL;
+    };
+    for (const QueryEvaluation evaluation : {QueryEvaluation::EXHAUSTIVE, QueryEvaluation::WAND}) {
+        const SearchOptions options{5, evaluation};
+        const string mark = evaluation == QueryEvaluation::WAND ? " (WAND)"s : ""s;
+        MeasureThroughput("Status predicate"s + mark, queries.size(), [&] {
+            double total_relevance = 0;
+            for (const string& query : queries) {
+                for (const Document& document : search_server.FindTopDocuments(execution::seq, query, is_actual,
+                                                                               options)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+        MeasureThroughput("Status mask"s + mark, queries.size(), [&] {
+            double total_relevance = 0;
+            for (const string& query : queries) {
+                for (const Document& document : search_server.FindTopDocuments(execution::seq, query,
+                                                                               DocumentStatus::ACTUAL, options)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+    }
+}
+
+void BenchmarkMinusWords() {
+    mt19937 generator;
+    // Частоты слов по Ципфу: первые слова словаря встречаются в большинстве документов
+    const vector<string> dictionary = GenerateTexts(generator, 5'000, 1, 8);
+    const vector<size_t> word_indices = GenerateZipfIndices(generator, dictionary.size(), 1.0, 50'000 * 30);
+    SearchServer search_server(""s);
+    for (int id = 0; id < 50'000; ++id) {
+        string text;
+        for (size_t i = static_cast<size_t>(id) * 30; i < static_cast<size_t>(id + 1) * 30; ++i) {
+            text += dictionary[word_indices[i]];
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    search_server.CompressIndex();
+    const auto get_word = [&](size_t min_index, size_t max_index) {
+        const string& word = dictionary[uniform_int_distribution<size_t>(min_index, max_index)(generator)];
+        return word.substr(word.find_first_not_of(' '));
+    };
+    vector<string> minus_queries(1'000);
+    vector<string> required_queries(1'000);
+    for (size_t i = 0; i < minus_queries.size(); ++i) {
+        const string plus_words = get_word(20, 200) + " "s + get_word(20, 200);
+        minus_queries[i] = plus_words;
+        for (int j = 0; j < 6; ++j) {
+            minus_queries[i] += " -"s + get_word(0, 10);
+        }
+        required_queries[i] = plus_words + " +"s + get_word(0, 10);
+    }
+
+    for (const auto& [mark, queries] : {pair{"Hot minus words"s, &minus_queries},
+                                        pair{"Required words"s, &required_queries}}) {
+        MeasureThroughput(mark, queries->size(), [&] {
+            double total_relevance = 0;
+            for (const string& query : *queries) {
+                for (const Document& document : search_server.FindTopDocuments(query)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+    }
+}
+
+void BenchmarkMatchDocuments() {
+    mt19937 generator;
+    const vector<string> dictionary = GenerateTexts(generator, 5'000, 1, 8);
+    SearchServer search_server(""s);
+    for (int id = 0; id < 50'000; ++id) {
+        string text;
+        for (int i = 0; i < uniform_int_distribution(5, 60)(generator); ++i) {
+            text += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    search_server.CompressIndex();
+    vector<string> queries(500);
+    vector<vector<int>> result_ids(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (int j = 0; j < uniform_int_distribution(2, 6)(generator); ++j) {
+            queries[i] += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        for (const Document& document : search_server.FindTopDocuments(execution::seq, queries[i],
+                                                                       DocumentStatus::ACTUAL, {50})) {
+            result_ids[i].push_back(document.id);
+        }
+    }
+
+    MeasureThroughput("MatchDocument per result"s, queries.size(), [&] {
+        double matched_count = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (const int document_id : result_ids[i]) {
+                matched_count += get<0>(search_server.MatchDocument(queries[i], document_id)).size();
+            }
+        }
+        return matched_count;
+    });
+    MeasureThroughput("MatchDocuments"s, queries.size(), [&] {
+        double matched_count = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (const auto& [words, status] : search_server.MatchDocuments(queries[i], result_ids[i])) {
+                matched_count += words.size();
+            }
+        }
+        return matched_count;
+    });
+}
+
+void BenchmarkShardedSearch() {
+    mt19937 generator;
+    const vector<string> texts = GenerateTexts(generator, 50'000, 70, 10);
+    const vector<string> queries = GenerateQueries(generator, texts, 1'000, 6);
+    vector<DocumentToAdd> documents;
+    documents.reserve(texts.size());
+    for (size_t id = 0; id < texts.size(); ++id) {
+        documents.push_back({static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+    SearchServer search_server(""s);
+    search_server.AddDocuments(documents);
+
+    MeasureThroughput("single server"s, queries.size(), [&] {
+        double total_relevance = 0;
+        for (const string& query : queries) {
+            for (const Document& document : search_server.FindTopDocuments(execution::seq, query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    for (const size_t shard_count : {2u, 4u, 8u}) {
+        ShardedSearchServer sharded_server(""s, shard_count);
+        sharded_server.AddDocuments(documents);
+        MeasureThroughput(to_string(shard_count) + " shards"s, queries.size(), [&] {
+            double total_relevance = 0;
+            for (const string& query : queries) {
+                for (const Document& document : sharded_server.FindTopDocuments(query)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+    }
+}
+
+void BenchmarkFindDuplicates() {
+    mt19937 generator;
+    vector<string> texts = GenerateTexts(generator, 50'000, 70, 10);
+    // Каждый пятый документ повторяет набор слов одного из предыдущих
+    for (size_t i = 5; i < texts.size(); i += 5) {
+        texts[i] = texts[uniform_int_distribution<size_t>(0, i - 1)(generator)];
+    }
+    SearchServer search_server(""s);
+    for (size_t id = 0; id < texts.size(); ++id) {
+        search_server.AddDocument(static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    MeasureThroughput("strings of words"s, texts.size(), [&] {
+        set<string> word_sets;
+        double duplicate_count = 0;
+        for (const int document_id : search_server) {
+            string words;
+            for (const auto& [word, freq] : search_server.GetWordFrequencies(document_id)) {
+                words += word;
+            }
+            duplicate_count += !word_sets.insert(move(words)).second;
+        }
+        return duplicate_count;
+    });
+    MeasureThroughput("word set hashes"s, texts.size(), [&] {
+        return static_cast<double>(FindDuplicates(search_server).size());
+    });
+    MeasureThroughput("MinHash near duplicates"s, texts.size(), [&] {
+        return static_cast<double>(FindNearDuplicates(search_server).size());
+    });
+}
+
+void BenchmarkRequestStatistics() {
+    const int thread_count = 4;
+    const int record_count = 1'000'000;
+    const auto run_threads = [&](const auto& record) {
+        vector<thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&record, t] {
+                const auto time = RequestStatistics::Clock::now();
+                for (int i = 0; i < record_count; ++i) {
+                    record(time, chrono::microseconds((i * 7 + t) % 500), i % 10 != 0);
+                }
+            });
+        }
+        for (thread& worker : threads) {
+            worker.join();
+        }
+    };
+
+    // Те же минутные корзины, но под общим мьютексом
+    MeasureThroughput("mutex-guarded counters"s, thread_count * record_count, [&] {
+        mutex counters_mutex;
+        vector<uint64_t> latency_counts(RequestWindowStats::kLatencyBucketCount);
+        uint64_t no_result_count = 0;
+        run_threads([&](RequestStatistics::Clock::time_point, chrono::microseconds latency, bool has_results) {
+            lock_guard guard(counters_mutex);
+            ++latency_counts[min<size_t>(static_cast<size_t>(log2(latency.count() + 1)) + 1,
+                                         latency_counts.size() - 1)];
+            no_result_count += !has_results;
+        });
+        return static_cast<double>(no_result_count);
+    });
+    MeasureThroughput("RequestStatistics::Record"s, thread_count * record_count, [&] {
+        RequestStatistics statistics;
+        run_threads([&](RequestStatistics::Clock::time_point time, chrono::microseconds latency, bool has_results) {
+            statistics.Record(time, latency, has_results);
+        });
+        return static_cast<double>(statistics.GetStats(RequestStatistics::Clock::now()).no_result_count);
+    });
+}
+
+void BenchmarkQueryPhases() {
+    mt19937 generator;
+    const vector<string> texts = GenerateTexts(generator, 20'000, 70, 10);
+    const vector<string> queries = GenerateQueries(generator, texts, 2'000, 6);
+    SearchServer search_server(""s);
+    for (size_t id = 0; id < texts.size(); ++id) {
+        search_server.AddDocument(static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    // Стоимость одной записи в гистограмму
+    LatencyHistogram histogram;
+    MeasureThroughput("LatencyHistogram::Record"s, 10'000'000, [&] {
+        for (uint64_t i = 0; i < 10'000'000; ++i) {
+            histogram.Record(i * 2654435761 % 1'000'000);
+        }
+        return static_cast<double>(histogram.GetValueAtQuantile(0.99));
+    });
+
+    ResetQueryPhaseStats();
+    MeasureThroughput(kQueryProfilingEnabled ? "FindTopDocuments, phases measured"s
+                                             : "FindTopDocuments, phases not measured"s,
+                      queries.size(), [&] {
+        double total_relevance = 0;
+        for (const string& query : queries) {
+            for (const Document& document : search_server.FindTopDocuments(execution::seq, query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    if (kQueryProfilingEnabled) {
+        for (const QueryPhaseStats& stats : GetQueryPhaseStats()) {
+            cout << stats << endl;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Разбор текста на слова и проверка слов: прежняя реализация через find против блочной
+void BenchmarkSplitIntoWords();
+
+// Пропускная способность пачки запросов: цикл FindTopDocuments против ProcessQueries
+void BenchmarkProcessQueries();
+
+// Пачка запросов по одному против общего прохода при разной доле общих слов
+void BenchmarkSharedScan();
+
+// Поток запросов с распределением Ципфа без кэша, с LRU и с TinyLFU
+void BenchmarkQueryResultCache();
+
+// Точный подсчёт против квантованных вкладов: скорость, совпадение топа и ошибка релевантности
+void BenchmarkQuantizedScores();
+
+// Фильтр по статусу маской против того же условия в предикате
+void BenchmarkStatusFilter();
+
+// Запросы с частыми минус-словами и с обязательными словами
+void BenchmarkMinusWords();
+
+// Совпадения запроса с документами выдачи: MatchDocument на каждый документ против MatchDocuments
+void BenchmarkMatchDocuments();
+
+// Поиск по одному серверу против поиска по шардам с общим IDF и слиянием топов
+void BenchmarkShardedSearch();
+
+// Поиск дубликатов: строки слов документов в множестве против отпечатков наборов слов и MinHash
+void BenchmarkFindDuplicates();
+
+// Запись статистики запросов из нескольких потоков: счётчики под мьютексом против атомарных корзин
+void BenchmarkRequestStatistics();
+
+// Цена замера этапов запроса и сводка по этапам при сборке с SEARCH_SERVER_PROFILE
+void BenchmarkQueryPhases();
@@ -0,0 +1,382 @@
+#include "benchmark_suite.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <sys/resource.h>
+#include "query_profiler.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const std::atomic<std::uint64_t>* allocation_counter = nullptr;
+
+std::uint64_t GetAllocationCount() {
+    return allocation_counter == nullptr ? 0 : allocation_counter->load(std::memory_order_relaxed);
+}
+
+std::size_t GetPeakRssKilobytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#endif
+}
+
+// Номера от 0 до count - 1, i-й выпадает с вероятностью, пропорциональной 1 / (i + 1)^exponent
+class ZipfDistribution {
+public:
+    ZipfDistribution(std::size_t count, double exponent)
+            : cumulative_weights_(count) {
+        double total_weight = 0.0;
+        for (std::size_t i = 0; i < count; ++i) {
+            total_weight += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+            cumulative_weights_[i] = total_weight;
+        }
+    }
+
+    std::size_t operator()(std::mt19937& generator) const {
+        const double weight = std::uniform_real_distribution<>(0.0, cumulative_weights_.back())(generator);
+        return std::min(cumulative_weights_.size() - 1,
+                        static_cast<std::size_t>(std::lower_bound(cumulative_weights_.begin(),
+                                                                  cumulative_weights_.end(), weight)
+                                                 - cumulative_weights_.begin()));
+    }
+
+private:
+    std::vector<double> cumulative_weights_;
+};
+
+std::string GenerateWord(std::mt19937& generator, std::size_t max_length) {
+    const std::size_t length = std::uniform_int_distribution<std::size_t>(1, max_length)(generator);
+    std::string word;
+    word.reserve(length);
+    for (std::size_t i = 0; i < length; ++i) {
+        word.push_back(std::uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, std::size_t word_count, std::size_t max_length) {
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    for (std::size_t i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    // Порядок слов задаёт их частоту, поэтому повторы убираются без сортировки
+    std::vector<std::string> unique_words;
+    std::unordered_set<std::string> seen_words;
+    for (std::string& word : words) {
+        if (seen_words.insert(word).second) {
+            unique_words.push_back(std::move(word));
+        }
+    }
+    return unique_words;
+}
+
+std::string GenerateText(std::mt19937& generator, const std::vector<std::string>& dictionary,
+                         const ZipfDistribution& distribution, std::size_t word_count) {
+    std::string text;
+    for (std::size_t i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += dictionary[distribution(generator)];
+    }
+    return text;
+}
+
+struct Corpus {
+    std::string stop_words;
+    std::vector<std::string> documents;
+    std::vector<std::string> queries;
+    // Документ, с которым сопоставляется i-й запрос в замере MatchDocument
+    std::vector<int> match_document_ids;
+    // Порядок удаления документов в замере RemoveDocument
+    std::vector<int> removal_order;
+};
+
+Corpus GenerateCorpus(const BenchmarkConfig& config) {
+    std::mt19937 generator(config.seed);
+    const std::vector<std::string> dictionary = GenerateDictionary(generator, config.dictionary_size,
+                                                                   config.max_word_length);
+    const ZipfDistribution distribution(dictionary.size(), config.zipf_exponent);
+    Corpus corpus;
+    // Самое частое слово - стоп-слово, как и в настоящих текстах
+    corpus.stop_words = dictionary.front();
+    corpus.documents.reserve(config.document_count);
+    for (std::size_t i = 0; i < config.document_count; ++i) {
+        if (i > 0 && std::uniform_real_distribution<>(0.0, 1.0)(generator) < config.duplicate_share) {
+            corpus.documents.push_back(
+                    corpus.documents[std::uniform_int_distribution<std::size_t>(0, i - 1)(generator)]);
+        } else {
+            corpus.documents.push_back(GenerateText(generator, dictionary, distribution, config.document_word_count));
+        }
+    }
+    for (std::size_t i = 0; i < config.query_count; ++i) {
+        corpus.queries.push_back(GenerateText(generator, dictionary, distribution, config.query_word_count));
+        corpus.match_document_ids.push_back(
+                std::uniform_int_distribution<int>(0, static_cast<int>(config.document_count) - 1)(generator));
+    }
+    corpus.removal_order.resize(config.document_count);
+    for (std::size_t i = 0; i < config.document_count; ++i) {
+        corpus.removal_order[i] = static_cast<int>(i);
+    }
+    std::shuffle(corpus.removal_order.begin(), corpus.removal_order.end(), generator);
+    return corpus;
+}
+
+void BuildServer(std::optional<SearchServer>& search_server, const Corpus& corpus) {
+    search_server.reset();
+    search_server.emplace(corpus.stop_words);
+    for (std::size_t i = 0; i < corpus.documents.size(); ++i) {
+        search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+}
+
+// Выполняет prepare() вне замера и run(measure) под замером warmup_count + repetition_count раз.
+// run передаёт каждую операцию в measure, и её длительность идёт в гистограмму задержек
+template <typename Prepare, typename Run>
+BenchmarkResult Measure(const std::string& name, const BenchmarkConfig& config, Prepare prepare, Run run) {
+    LatencyHistogram latencies;
+    std::vector<double> throughputs;
+    std::uint64_t allocation_count = 0;
+    BenchmarkResult result;
+    result.name = name;
+    for (std::size_t repetition = 0; repetition < config.warmup_count + config.repetition_count; ++repetition) {
+        prepare();
+        const bool is_measured = repetition >= config.warmup_count;
+        std::size_t operation_count = 0;
+        const std::uint64_t allocations_before = GetAllocationCount();
+        const Clock::time_point start = Clock::now();
+        run([&](const auto& operation) {
+            const Clock::time_point operation_start = Clock::now();
+            operation();
+            const Clock::time_point operation_finish = Clock::now();
+            if (is_measured) {
+                latencies.Record(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(operation_finish - operation_start)
+                                .count()));
+            }
+            ++operation_count;
+        });
+        const std::chrono::duration<double> duration = Clock::now() - start;
+        if (is_measured) {
+            allocation_count += GetAllocationCount() - allocations_before;
+            throughputs.push_back(operation_count / std::max(duration.count(), 1e-9));
+            result.operation_count = operation_count;
+        }
+    }
+    std::sort(throughputs.begin(), throughputs.end());
+    result.repetition_count = throughputs.size();
+    result.median_throughput = throughputs[throughputs.size() / 2];
+    result.min_throughput = throughputs.front();
+    result.max_throughput = throughputs.back();
+    result.p50_nanoseconds = latencies.GetValueAtQuantile(0.5);
+    result.p99_nanoseconds = latencies.GetValueAtQuantile(0.99);
+    result.p999_nanoseconds = latencies.GetValueAtQuantile(0.999);
+    result.max_nanoseconds = latencies.GetMax();
+    if (allocation_counter != nullptr && result.operation_count > 0) {
+        result.allocations_per_operation = static_cast<double>(allocation_count)
+                                           / (result.operation_count * result.repetition_count);
+    }
+    result.peak_rss_kilobytes = GetPeakRssKilobytes();
+    return result;
+}
+
+std::size_t ParseSize(std::string_view name, const std::string& value, std::size_t min_value) {
+    std::size_t position = 0;
+    unsigned long long result = 0;
+    try {
+        result = std::stoull(value, &position);
+    } catch (const std::exception&) {
+        position = 0;
+    }
+    if (value.empty() || position != value.size() || value.front() == '-' || result < min_value) {
+        throw std::invalid_argument(std::string("Invalid value of --") + std::string(name) + ": " + value);
+    }
+    return static_cast<std::size_t>(result);
+}
+
+double ParseDouble(std::string_view name, const std::string& value, double min_value, double max_value) {
+    std::size_t position = 0;
+    double result = 0.0;
+    try {
+        result = std::stod(value, &position);
+    } catch (const std::exception&) {
+        position = 0;
+    }
+    if (value.empty() || position != value.size() || !(result >= min_value && result <= max_value)) {
+        throw std::invalid_argument(std::string("Invalid value of --") + std::string(name) + ": " + value);
+    }
+    return result;
+}
+
+}  // namespace
+
+BenchmarkConfig ParseBenchmarkConfig(const std::vector<std::string>& arguments) {
+    BenchmarkConfig config;
+    for (const std::string& argument : arguments) {
+        const std::size_t separator = argument.find('=');
+        if (argument.rfind("--", 0) != 0 || separator == std::string::npos) {
+            throw std::invalid_argument(std::string("Invalid benchmark option: ") + argument);
+        }
+        const std::string name = argument.substr(2, separator - 2);
+        const std::string value = argument.substr(separator + 1);
+        if (name == "documents") {
+            config.document_count = ParseSize(name, value, 1);
+        } else if (name == "dictionary") {
+            config.dictionary_size = ParseSize(name, value, 1);
+        } else if (name == "word-length") {
+            config.max_word_length = ParseSize(name, value, 1);
+        } else if (name == "document-words") {
+            config.document_word_count = ParseSize(name, value, 1);
+        } else if (name == "queries") {
+            config.query_count = ParseSize(name, value, 1);
+        } else if (name == "query-words") {
+            config.query_word_count = ParseSize(name, value, 1);
+        } else if (name == "zipf") {
+            config.zipf_exponent = ParseDouble(name, value, 0.0, 10.0);
+        } else if (name == "duplicates") {
+            config.duplicate_share = ParseDouble(name, value, 0.0, 1.0);
+        } else if (name == "warmup") {
+            config.warmup_count = ParseSize(name, value, 0);
+        } else if (name == "repetitions") {
+            config.repetition_count = ParseSize(name, value, 1);
+        } else if (name == "seed") {
+            config.seed = static_cast<std::uint32_t>(ParseSize(name, value, 0));
+        } else if (name == "format" && (value == "text" || value == "json")) {
+            config.format = value == "json" ? BenchmarkFormat::JSON : BenchmarkFormat::TEXT;
+        } else {
+            throw std::invalid_argument(std::string("Invalid benchmark option: ") + argument);
+        }
+    }
+    return config;
+}
+
+void SetAllocationCounter(const std::atomic<std::uint64_t>* allocation_count) {
+    allocation_counter = allocation_count;
+}
+
+std::vector<BenchmarkResult> RunBenchmarkSuite(const BenchmarkConfig& config) {
+    const Corpus corpus = GenerateCorpus(config);
+    std::vector<BenchmarkResult> results;
+    std::optional<SearchServer> search_server;
+
+    results.push_back(Measure("AddDocument", config, [&] {
+        search_server.reset();
+        search_server.emplace(corpus.stop_words);
+    }, [&](const auto& measure) {
+        for (std::size_t i = 0; i < corpus.documents.size(); ++i) {
+            measure([&] {
+                search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL,
+                                           {1, 2, 3});
+            });
+        }
+    }));
+
+    BuildServer(search_server, corpus);
+    const auto find_top_documents = [&](const auto& policy) {
+        return [&search_server, &corpus, policy](const auto& measure) {
+            for (const std::string& query : corpus.queries) {
+                measure([&] {
+                    search_server->FindTopDocuments(policy, query);
+                });
+            }
+        };
+    };
+    results.push_back(Measure("FindTopDocuments seq", config, [] {}, find_top_documents(std::execution::seq)));
+    results.push_back(Measure("FindTopDocuments par", config, [] {}, find_top_documents(std::execution::par)));
+    results.push_back(Measure("MatchDocument", config, [] {}, [&](const auto& measure) {
+        for (std::size_t i = 0; i < corpus.queries.size(); ++i) {
+            measure([&] {
+                search_server->MatchDocument(corpus.queries[i], corpus.match_document_ids[i]);
+            });
+        }
+    }));
+
+    results.push_back(Measure("RemoveDocument", config, [&] {
+        BuildServer(search_server, corpus);
+    }, [&](const auto& measure) {
+        for (const int document_id : corpus.removal_order) {
+            measure([&] {
+                search_server->RemoveDocument(document_id);
+            });
+        }
+    }));
+    // Операция - проход по всему корпусу; найденные документы не печатаются, в отличие от RemoveDuplicates
+    results.push_back(Measure("RemoveDuplicates", config, [&] {
+        BuildServer(search_server, corpus);
+    }, [&](const auto& measure) {
+        measure([&] {
+            for (const int document_id : FindDuplicates(*search_server)) {
+                search_server->RemoveDocument(document_id);
+            }
+        });
+    }));
+    return results;
+}
+
+void PrintBenchmarkResults(std::ostream& output, const BenchmarkConfig& config,
+                           const std::vector<BenchmarkResult>& results) {
+    if (config.format == BenchmarkFormat::TEXT) {
+        for (const BenchmarkResult& result : results) {
+            output << result.name << ": " << result.operation_count << " ops x " << result.repetition_count << ", "
+                   << static_cast<std::uint64_t>(result.median_throughput) << " ops/s (min "
+                   << static_cast<std::uint64_t>(result.min_throughput) << ", max "
+                   << static_cast<std::uint64_t>(result.max_throughput) << "), latency p50 "
+                   << result.p50_nanoseconds << " ns, p99 " << result.p99_nanoseconds << " ns, p999 "
+                   << result.p999_nanoseconds << " ns, max " << result.max_nanoseconds << " ns";
+            if (result.allocations_per_operation >= 0.0) {
+                output << ", " << result.allocations_per_operation << " allocations/op";
+            }
+            output << ", peak RSS " << result.peak_rss_kilobytes << " KB\n";
+        }
+        return;
+    }
+    // Имена замеров и параметров не содержат символов, которые в JSON нужно экранировать
+    output << "{\"config\": {\"documents\": " << config.document_count
+           << ", \"dictionary\": " << config.dictionary_size
+           << ", \"word-length\": " << config.max_word_length
+           << ", \"document-words\": " << config.document_word_count
+           << ", \"queries\": " << config.query_count
+           << ", \"query-words\": " << config.query_word_count
+           << ", \"zipf\": " << config.zipf_exponent
+           << ", \"duplicates\": " << config.duplicate_share
+           << ", \"warmup\": " << config.warmup_count
+           << ", \"repetitions\": " << config.repetition_count
+           << ", \"seed\": " << config.seed << "},\n \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        output << (i == 0 ? "\n  " : ",\n  ") << "{\"name\": \"" << result.name << "\""
+               << ", \"operations\": " << result.operation_count
+               << ", \"repetitions\": " << result.repetition_count
+               << ", \"median_ops_per_second\": " << result.median_throughput
+               << ", \"min_ops_per_second\": " << result.min_throughput
+               << ", \"max_ops_per_second\": " << result.max_throughput
+               << ", \"p50_ns\": " << result.p50_nanoseconds
+               << ", \"p99_ns\": " << result.p99_nanoseconds
+               << ", \"p999_ns\": " << result.p999_nanoseconds
+               << ", \"max_ns\": " << result.max_nanoseconds
+               << ", \"allocations_per_op\": ";
+        if (result.allocations_per_operation >= 0.0) {
+            output << result.allocations_per_operation;
+        } else {
+            output << "null";
+        }
+        output << ", \"peak_rss_kb\": " << result.peak_rss_kilobytes << "}";
+    }
+    output << "\n]}\n";
+}
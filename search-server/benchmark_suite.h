@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class BenchmarkFormat {
+    TEXT,
+    JSON,
+};
+
+// Параметры прогона. Все данные строятся из seed, поэтому прогоны с одними параметрами
+// сравнимы между версиями
+struct BenchmarkConfig {
+    std::size_t document_count = 10'000;
+    std::size_t dictionary_size = 1'000;
+    std::size_t max_word_length = 10;
+    std::size_t document_word_count = 70;
+    std::size_t query_count = 100;
+    std::size_t query_word_count = 10;
+    // Показатель закона Ципфа для частот слов: i-е слово словаря встречается с весом
+    // 1 / (i + 1)^zipf_exponent; при нуле слова равновероятны
+    double zipf_exponent = 1.0;
+    // Доля документов, повторяющих один из предыдущих
+    double duplicate_share = 0.1;
+    std::size_t warmup_count = 1;
+    std::size_t repetition_count = 5;
+    std::uint32_t seed = 42;
+    BenchmarkFormat format = BenchmarkFormat::TEXT;
+};
+
+// Разбирает аргументы вида --documents=20000 --zipf=1.1 --format=json.
+// Неизвестный параметр или неверное значение - std::invalid_argument
+BenchmarkConfig ParseBenchmarkConfig(const std::vector<std::string>& arguments);
+
+// Итоги одного замера: производительность по повторам, задержки отдельных операций
+// по всем повторам, выделения памяти на операцию и пиковый размер процесса после замера
+struct BenchmarkResult {
+    std::string name;
+    std::size_t operation_count = 0;
+    std::size_t repetition_count = 0;
+    double median_throughput = 0.0;
+    double min_throughput = 0.0;
+    double max_throughput = 0.0;
+    std::uint64_t p50_nanoseconds = 0;
+    std::uint64_t p99_nanoseconds = 0;
+    std::uint64_t p999_nanoseconds = 0;
+    std::uint64_t max_nanoseconds = 0;
+    // Отрицательно, если выделения не считаются (SetAllocationCounter не вызывался)
+    double allocations_per_operation = -1.0;
+    std::size_t peak_rss_kilobytes = 0;
+};
+
+// Счётчик выделений памяти ведёт исполняемый файл, заменяя operator new, и сообщает его сюда
+void SetAllocationCounter(const std::atomic<std::uint64_t>* allocation_count);
+
+// Замеряет AddDocument, FindTopDocuments seq и par, MatchDocument, RemoveDocument и
+// RemoveDuplicates. Каждый замер сначала выполняется warmup_count раз без учёта
+std::vector<BenchmarkResult> RunBenchmarkSuite(const BenchmarkConfig& config);
+
+void PrintBenchmarkResults(std::ostream& output, const BenchmarkConfig& config,
+                           const std::vector<BenchmarkResult>& results);
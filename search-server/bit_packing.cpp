@@ -0,0 +1,49 @@
+#include "bit_packing.h"
+
+int GetBitWidth(std::uint32_t value) {
+    int bit_width = 0;
+    while (value != 0) {
+        ++bit_width;
+        value >>= 1;
+    }
+    return bit_width;
+}
+
+void PackBits(const std::uint32_t* values, std::size_t count, int bit_width, std::vector<std::uint32_t>& output) {
+    if (bit_width == 0) {
+        return;
+    }
+    const std::size_t first_word = output.size();
+    output.resize(first_word + (count * bit_width + 31) / 32, 0);
+    std::uint32_t* words = output.data() + first_word;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t bit = i * bit_width;
+        const std::uint64_t shifted = static_cast<std::uint64_t>(values[i]) << (bit % 32);
+        words[bit / 32] |= static_cast<std::uint32_t>(shifted);
+        if (bit % 32 + bit_width > 32) {
+            words[bit / 32 + 1] |= static_cast<std::uint32_t>(shifted >> 32);
+        }
+    }
+}
+
+const std::uint32_t* UnpackBits(const std::uint32_t* input, std::size_t count, int bit_width, std::uint32_t* values) {
+    if (bit_width == 0) {
+        for (std::size_t i = 0; i < count; ++i) {
+            values[i] = 0;
+        }
+        return input;
+    }
+    // Ширина одна на весь блок, поэтому цикл без ветвлений по значениям
+    const std::uint64_t mask = (std::uint64_t{1} << bit_width) - 1;
+    const std::size_t word_count = (count * bit_width + 31) / 32;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t bit = i * bit_width;
+        const std::size_t word = bit / 32;
+        std::uint64_t chunk = input[word];
+        if (word + 1 < word_count) {
+            chunk |= static_cast<std::uint64_t>(input[word + 1]) << 32;
+        }
+        values[i] = static_cast<std::uint32_t>((chunk >> (bit % 32)) & mask);
+    }
+    return input + word_count;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Число бит, достаточное для записи value
+int GetBitWidth(std::uint32_t value);
+
+// Дописывает count значений по bit_width бит каждое, выравнивая конец по 32 битам
+void PackBits(const std::uint32_t* values, std::size_t count, int bit_width, std::vector<std::uint32_t>& output);
+
+// Читает count значений по bit_width бит; возвращает позицию за прочитанными данными
+const std::uint32_t* UnpackBits(const std::uint32_t* input, std::size_t count, int bit_width, std::uint32_t* values);
@@ -0,0 +1,68 @@
+#include "concurrent_search_server.h"
+
+#include <functional>
+#include <thread>
+
+namespace {
+
+std::size_t GetThreadReadCounter(std::size_t counter_count) {
+    thread_local const std::size_t counter = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return counter % counter_count;
+}
+
+}  // namespace
+
+ConcurrentSearchServer::ReadSnapshot::ReadSnapshot(const ConcurrentSearchServer& server) {
+    ReadIndicator& indicator = server.read_indicators_[server.version_.load()];
+    read_count_ = &indicator[GetThreadReadCounter(kReadCounterCount)].count;
+    read_count_->fetch_add(1);
+    // Копия выбирается уже после отметки: писатель, переключивший её раньше,
+    // дождётся этого чтения, прежде чем менять прежнюю копию
+    search_server_ = &server.search_servers_[server.active_server_.load()];
+}
+
+ConcurrentSearchServer::ReadSnapshot::ReadSnapshot(ReadSnapshot&& other) noexcept
+        : read_count_(std::exchange(other.read_count_, nullptr))
+        , search_server_(other.search_server_) {
+}
+
+ConcurrentSearchServer::ReadSnapshot::~ReadSnapshot() {
+    if (read_count_ != nullptr) {
+        read_count_->fetch_sub(1);
+    }
+}
+
+ConcurrentSearchServer::ReadSnapshot ConcurrentSearchServer::Read() const {
+    return ReadSnapshot(*this);
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                         const std::vector<int>& ratings) {
+    Write([&](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    Write([&](SearchServer& search_server) {
+        search_server.AddDocuments(documents);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Write([&](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return Read()->GetDocumentCount();
+}
+
+void ConcurrentSearchServer::WaitForReaders(int version) const {
+    for (const ReadCounter& counter : read_indicators_[version]) {
+        while (counter.count.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Сервер для одного писателя и многих читателей, где чтение не ждёт записи (схема left-right).
+// Индекс хранится в двух копиях: читатели работают с активной, писатель меняет вторую,
+// переключает на неё новых читателей, дожидается, пока старую копию покинут начатые
+// до переключения чтения, и повторяет изменение на ней. Ждёт только писатель; цена -
+// вдвое больше памяти и каждое изменение, выполненное дважды
+class ConcurrentSearchServer {
+public:
+    // Согласованное состояние сервера на время жизни объекта: изменения, пришедшие
+    // позже, в нём не видны. Пока объект жив, писатель не может закончить следующее
+    // изменение, поэтому держать его дольше одного-двух запросов не стоит
+    class ReadSnapshot {
+    public:
+        ReadSnapshot(ReadSnapshot&& other) noexcept;
+
+        ReadSnapshot(const ReadSnapshot&) = delete;
+        ReadSnapshot& operator=(const ReadSnapshot&) = delete;
+        ReadSnapshot& operator=(ReadSnapshot&&) = delete;
+
+        ~ReadSnapshot();
+
+        const SearchServer& operator*() const {
+            return *search_server_;
+        }
+
+        const SearchServer* operator->() const {
+            return search_server_;
+        }
+
+    private:
+        friend class ConcurrentSearchServer;
+
+        explicit ReadSnapshot(const ConcurrentSearchServer& server);
+
+        std::atomic<int>* read_count_;
+        const SearchServer* search_server_;
+    };
+
+    template <typename StopWords>
+    explicit ConcurrentSearchServer(const StopWords& stop_words);
+
+    ReadSnapshot Read() const;
+
+    // Изменения выполняются по одному; если изменение бросает исключение, сервер не меняется
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Запросы к одному снимку; результат не ссылается на память сервера
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const {
+        return Read()->FindTopDocuments(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    SearchServer::MatchedDocuments MatchDocument(Args&&... args) const {
+        return Read()->MatchDocument(std::forward<Args>(args)...);
+    }
+
+    std::vector<SearchServer::MatchedDocuments> MatchDocuments(std::string_view raw_query,
+                                                               const std::vector<int>& document_ids) const {
+        return Read()->MatchDocuments(raw_query, document_ids);
+    }
+
+    int GetDocumentCount() const;
+
+private:
+    // Число читателей копии разнесено по кэш-линиям, чтобы потоки не спорили за одну
+    static constexpr std::size_t kReadCounterCount = 16;
+
+    struct alignas(64) ReadCounter {
+        std::atomic<int> count{0};
+    };
+
+    using ReadIndicator = std::array<ReadCounter, kReadCounterCount>;
+
+    std::array<SearchServer, 2> search_servers_;
+    std::atomic<int> active_server_{0};
+    // Читатель отмечается в индикаторе текущей версии; писатель, меняя версию,
+    // дожидается, пока опустеет индикатор прежней
+    std::atomic<int> version_{0};
+    mutable std::array<ReadIndicator, 2> read_indicators_;
+    std::mutex write_mutex_;
+
+    template <typename Function>
+    void Write(Function function);
+
+    void WaitForReaders(int version) const;
+};
+
+template <typename StopWords>
+ConcurrentSearchServer::ConcurrentSearchServer(const StopWords& stop_words)
+        : search_servers_{SearchServer(stop_words), SearchServer(stop_words)} {
+}
+
+template <typename Function>
+void ConcurrentSearchServer::Write(Function function) {
+    std::lock_guard guard(write_mutex_);
+    const int active = active_server_.load();
+    // Исключение вылетит до переключения, пока читатели видят нетронутую копию
+    function(search_servers_[1 - active]);
+    active_server_.store(1 - active);
+
+    const int version = version_.load();
+    WaitForReaders(1 - version);
+    version_.store(1 - version);
+    WaitForReaders(version);
+    function(search_servers_[active]);
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <ostream>
+#include <string_view>
+#include <vector>
 
 enum class DocumentStatus {
     ACTUAL,
@@ -18,4 +20,12 @@ struct Document {
     int rating = 0;
 };
 
+// Документ для пакетного добавления; текст должен жить до конца AddDocuments
+struct DocumentToAdd {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 std::ostream& operator<<(std::ostream& output,  const Document& document);
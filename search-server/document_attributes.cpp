@@ -0,0 +1,84 @@
+#include "document_attributes.h"
+
+#include <algorithm>
+
+namespace {
+
+std::uint64_t Bit(int document_id) {
+    return std::uint64_t{1} << (static_cast<std::size_t>(document_id) % 64);
+}
+
+}  // namespace
+
+DocumentAttributes::DocumentAttributes()
+        : status_masks_(kStatusCount) {
+}
+
+void DocumentAttributes::Add(int document_id, DocumentStatus status, int rating, std::uint64_t word_set_hash) {
+    const std::size_t slot = static_cast<std::size_t>(document_id);
+    if (ratings_.size() <= slot) {
+        // Столбцы растут с запасом, чтобы добавление по возрастанию id не копировало их каждый раз
+        const std::size_t size = std::max(slot + 1, ratings_.size() * 2);
+        ratings_.resize(size, 0);
+        statuses_.resize(size, DocumentStatus::ACTUAL);
+        word_set_hashes_.resize(size, 0);
+        present_.resize((size + 63) / 64, 0);
+        for (auto& mask : status_masks_) {
+            mask.resize((size + 63) / 64, 0);
+        }
+    }
+    if (Contains(document_id)) {
+        RemoveFromWordSet(document_id);
+    } else {
+        ++count_;
+    }
+    ratings_[slot] = rating;
+    statuses_[slot] = status;
+    word_set_hashes_[slot] = word_set_hash;
+    // Документы обычно добавляются по возрастанию id, и вставка приходится на конец группы
+    std::vector<int>& documents = word_set_documents_[word_set_hash];
+    documents.insert(std::upper_bound(documents.begin(), documents.end(), document_id), document_id);
+    present_[slot / 64] |= Bit(document_id);
+    for (auto& mask : status_masks_) {
+        mask[slot / 64] &= ~Bit(document_id);
+    }
+    status_masks_[static_cast<std::size_t>(status)][slot / 64] |= Bit(document_id);
+    id_bound_ = std::max(id_bound_, document_id + 1);
+}
+
+void DocumentAttributes::Remove(int document_id) {
+    if (document_id < 0 || !Contains(document_id)) {
+        return;
+    }
+    const std::size_t slot = static_cast<std::size_t>(document_id);
+    RemoveFromWordSet(document_id);
+    present_[slot / 64] &= ~Bit(document_id);
+    status_masks_[static_cast<std::size_t>(statuses_[slot])][slot / 64] &= ~Bit(document_id);
+    --count_;
+    while (id_bound_ > 0 && !Contains(id_bound_ - 1)) {
+        --id_bound_;
+    }
+}
+
+std::size_t DocumentAttributes::GetCount() const {
+    return count_;
+}
+
+int DocumentAttributes::GetIdBound() const {
+    return id_bound_;
+}
+
+const std::vector<int>& DocumentAttributes::GetDocumentsWithWordSet(std::uint64_t word_set_hash) const {
+    static const std::vector<int> no_documents;
+    const auto it = word_set_documents_.find(word_set_hash);
+    return it == word_set_documents_.end() ? no_documents : it->second;
+}
+
+void DocumentAttributes::RemoveFromWordSet(int document_id) {
+    const auto it = word_set_documents_.find(word_set_hashes_[document_id]);
+    std::vector<int>& documents = it->second;
+    documents.erase(std::lower_bound(documents.begin(), documents.end(), document_id));
+    if (documents.empty()) {
+        word_set_documents_.erase(it);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+
+// Атрибуты документов по столбцам: рейтинг и статус лежат в плотных массивах по id,
+// а для каждого статуса есть битовая маска документов с ним. Фильтр по статусу
+// сводится к маске, которую можно наложить на множество кандидатов целыми словами.
+// Столбцы растут вместе с наибольшим id и живут вне пула индекса, как маски сегментов.
+// Ещё один столбец - отпечаток набора слов (HashWordSet), и по отпечатку документы
+// собраны в группы, так что дубликат находится без перебора документов
+class DocumentAttributes {
+public:
+    static constexpr std::size_t kStatusCount = 4;
+
+    DocumentAttributes();
+
+    void Add(int document_id, DocumentStatus status, int rating, std::uint64_t word_set_hash);
+
+    void Remove(int document_id);
+
+    bool Contains(int document_id) const {
+        return TestBit(present_, document_id);
+    }
+
+    // Статус и рейтинг читаются без проверки: документ должен быть в наборе
+    DocumentStatus GetStatus(int document_id) const {
+        return statuses_[document_id];
+    }
+
+    int GetRating(int document_id) const {
+        return ratings_[document_id];
+    }
+
+    std::uint64_t GetWordSetHash(int document_id) const {
+        return word_set_hashes_[document_id];
+    }
+
+    // Документы с таким отпечатком по возрастанию id
+    const std::vector<int>& GetDocumentsWithWordSet(std::uint64_t word_set_hash) const;
+
+    bool HasStatus(int document_id, DocumentStatus status) const {
+        return TestBit(status_masks_[static_cast<std::size_t>(status)], document_id);
+    }
+
+    // Маска документов со статусом; слов в ней не меньше (GetIdBound() + 63) / 64
+    const std::uint64_t* GetStatusMask(DocumentStatus status) const {
+        return status_masks_[static_cast<std::size_t>(status)].data();
+    }
+
+    std::size_t GetCount() const;
+
+    // Наибольший id документа плюс один
+    int GetIdBound() const;
+
+private:
+    std::vector<int> ratings_;
+    std::vector<DocumentStatus> statuses_;
+    std::vector<std::uint64_t> present_;
+    std::vector<std::vector<std::uint64_t>> status_masks_;
+    std::vector<std::uint64_t> word_set_hashes_;
+    std::unordered_map<std::uint64_t, std::vector<int>> word_set_documents_;
+    std::size_t count_ = 0;
+    int id_bound_ = 0;
+
+    void RemoveFromWordSet(int document_id);
+
+    static bool TestBit(const std::vector<std::uint64_t>& bits, int document_id) {
+        const std::size_t word = static_cast<std::size_t>(document_id) / 64;
+        return word < bits.size() && (bits[word] >> (static_cast<std::size_t>(document_id) % 64) & 1) != 0;
+    }
+};
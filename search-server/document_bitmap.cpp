@@ -0,0 +1,57 @@
+#include "document_bitmap.h"
+
+void DocumentBitmap::Add(int document_id) {
+    const std::uint32_t key = static_cast<std::uint32_t>(document_id) >> 16;
+    const std::uint16_t low = static_cast<std::uint16_t>(document_id & 0xFFFF);
+    if (containers_.empty() || containers_.back().key != key) {
+        containers_.emplace_back();
+        containers_.back().key = key;
+    }
+    Container& container = containers_.back();
+    if (container.bits.empty()) {
+        container.values.push_back(low);
+        if (container.values.size() > kMaxArraySize) {
+            container.bits.assign(kContainerWords, 0);
+            for (const std::uint16_t value : container.values) {
+                container.bits[value / 64] |= std::uint64_t{1} << (value % 64);
+            }
+            container.values.clear();
+            container.values.shrink_to_fit();
+        }
+    } else {
+        container.bits[low / 64] |= std::uint64_t{1} << (low % 64);
+    }
+    ++count_;
+}
+
+bool DocumentBitmap::Contains(int document_id) const {
+    const std::uint32_t key = static_cast<std::uint32_t>(document_id) >> 16;
+    const std::uint16_t low = static_cast<std::uint16_t>(document_id & 0xFFFF);
+    const auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                                     [](const Container& container, std::uint32_t key) {
+                                         return container.key < key;
+                                     });
+    if (it == containers_.end() || it->key != key) {
+        return false;
+    }
+    if (!it->bits.empty()) {
+        return (it->bits[low / 64] >> (low % 64) & 1) != 0;
+    }
+    return std::binary_search(it->values.begin(), it->values.end(), low);
+}
+
+std::size_t DocumentBitmap::GetCount() const {
+    return count_;
+}
+
+bool DocumentBitmap::IsEmpty() const {
+    return count_ == 0;
+}
+
+std::size_t DocumentBitmap::GetMemoryUsage() const {
+    std::size_t bytes = containers_.capacity() * sizeof(Container);
+    for (const Container& container : containers_) {
+        bytes += container.values.capacity() * sizeof(std::uint16_t) + container.bits.capacity() * sizeof(std::uint64_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатое множество id документов в духе Roaring: id делятся на куски по 2^16 по старшим
+// битам. Кусок, где id не больше kMaxArraySize, хранит их младшие 16 бит отсортированным
+// массивом, а более плотный - битовой картой на 65536 бит. Так редкие слова занимают по
+// два байта на документ, а частые - не больше бита, и наложение частого слова на маску
+// кандидатов идёт целыми словами по 64 документа
+class DocumentBitmap {
+public:
+    static constexpr std::size_t kMaxArraySize = 4096;
+
+    // id должны добавляться по возрастанию
+    void Add(int document_id);
+
+    bool Contains(int document_id) const;
+
+    std::size_t GetCount() const;
+
+    bool IsEmpty() const;
+
+    // Вызывает function(word, bits) для непустых 64-битных слов множества, задевающих
+    // [range_begin, range_end); bits - документы слова word * 64 ... word * 64 + 63.
+    // Биты за краями диапазона не срезаются
+    template <typename Function>
+    void ForEachWord(int range_begin, int range_end, Function function) const;
+
+    std::size_t GetMemoryUsage() const;
+
+private:
+    static constexpr std::size_t kContainerWords = 65536 / 64;
+
+    struct Container {
+        std::uint32_t key = 0;
+        // Младшие биты id, пока кусок разрежен; иначе пусто, и заполнены bits
+        std::vector<std::uint16_t> values;
+        std::vector<std::uint64_t> bits;
+    };
+
+    std::vector<Container> containers_;
+    std::size_t count_ = 0;
+};
+
+template <typename Function>
+void DocumentBitmap::ForEachWord(int range_begin, int range_end, Function function) const {
+    if (range_begin >= range_end) {
+        return;
+    }
+    const std::uint32_t first_key = static_cast<std::uint32_t>(range_begin) >> 16;
+    const std::uint32_t last_key = static_cast<std::uint32_t>(range_end - 1) >> 16;
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), first_key,
+                               [](const Container& container, std::uint32_t key) {
+                                   return container.key < key;
+                               });
+    for (; it != containers_.end() && it->key <= last_key; ++it) {
+        const std::size_t base = static_cast<std::size_t>(it->key) * kContainerWords;
+        const std::size_t word_begin = std::max(base, static_cast<std::size_t>(range_begin) / 64);
+        const std::size_t word_end = std::min(base + kContainerWords, static_cast<std::size_t>(range_end - 1) / 64 + 1);
+        if (!it->bits.empty()) {
+            for (std::size_t word = word_begin; word < word_end; ++word) {
+                if (it->bits[word - base] != 0) {
+                    function(word, it->bits[word - base]);
+                }
+            }
+            continue;
+        }
+        // Разреженный кусок: значения подряд собираются в слова
+        auto value = std::lower_bound(it->values.begin(), it->values.end(),
+                                      static_cast<std::uint16_t>((word_begin - base) * 64));
+        while (value != it->values.end() && base + *value / 64 < word_end) {
+            const std::size_t word = base + *value / 64;
+            std::uint64_t bits = 0;
+            for (; value != it->values.end() && base + *value / 64 == word; ++value) {
+                bits |= std::uint64_t{1} << (*value % 64);
+            }
+            function(word, bits);
+        }
+    }
+}
@@ -0,0 +1,207 @@
+#include "index_segment.h"
+
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+bool TestBit(const std::vector<std::uint64_t>& bits, int document_id) {
+    const std::size_t word = static_cast<std::size_t>(document_id) / 64;
+    return word < bits.size() && (bits[word] >> (document_id % 64) & 1) != 0;
+}
+
+void SetBit(std::vector<std::uint64_t>& bits, int document_id) {
+    bits[static_cast<std::size_t>(document_id) / 64] |= std::uint64_t{1} << (document_id % 64);
+}
+
+}  // namespace
+
+void IndexSegment::AddDocument(int document_id) {
+    const std::size_t word_count = static_cast<std::size_t>(document_id) / 64 + 1;
+    if (documents_.size() < word_count) {
+        documents_.resize(word_count, 0);
+        deleted_.resize(word_count, 0);
+    }
+    if (!TestBit(documents_, document_id)) {
+        SetBit(documents_, document_id);
+        ++document_count_;
+    }
+}
+
+void IndexSegment::Delete(int document_id) {
+    if (Contains(document_id)) {
+        SetBit(deleted_, document_id);
+        ++deleted_count_;
+    }
+}
+
+void IndexSegment::Erase(int document_id) {
+    if (Contains(document_id)) {
+        documents_[static_cast<std::size_t>(document_id) / 64] &= ~(std::uint64_t{1} << (document_id % 64));
+        --document_count_;
+    }
+}
+
+bool IndexSegment::Contains(int document_id) const {
+    return TestBit(documents_, document_id) && !IsDeleted(document_id);
+}
+
+const PostingList* IndexSegment::Find(TermId term) const {
+    const auto it = term_slots_.find(term);
+    if (it == term_slots_.end() || postings_[it->second].empty()) {
+        return nullptr;
+    }
+    return &postings_[it->second];
+}
+
+PostingList& IndexSegment::GetPostings(TermId term) {
+    const auto [it, is_new] = term_slots_.emplace(term, postings_.size());
+    if (is_new) {
+        terms_.push_back(term);
+        postings_.emplace_back();
+    }
+    return postings_[it->second];
+}
+
+std::size_t IndexSegment::GetDocumentCount() const {
+    return document_count_;
+}
+
+std::size_t IndexSegment::GetDeletedCount() const {
+    return deleted_count_;
+}
+
+std::size_t IndexSegment::GetLiveCount() const {
+    return document_count_ - deleted_count_;
+}
+
+const std::vector<std::uint64_t>& IndexSegment::GetDeleted() const {
+    return deleted_;
+}
+
+bool IndexSegment::HasCompressedPostings() const {
+    return std::any_of(postings_.begin(), postings_.end(), [](const PostingList& postings) {
+        return postings.IsCompressed();
+    });
+}
+
+void IndexSegment::Compress(const std::vector<double>& inv_word_counts) {
+    std::for_each(std::execution::par, postings_.begin(), postings_.end(), [&inv_word_counts](PostingList& postings) {
+        postings.Compress(inv_word_counts);
+    });
+}
+
+const std::uint16_t* IndexSegment::FindImpacts(TermId term) const {
+    if (impacts_.empty()) {
+        return nullptr;
+    }
+    const auto it = term_slots_.find(term);
+    return it == term_slots_.end() || it->second >= impacts_.size() ? nullptr : impacts_[it->second].data();
+}
+
+bool IndexSegment::HasImpacts() const {
+    return !impacts_.empty();
+}
+
+void IndexSegment::BuildImpacts(const std::vector<double>& inverse_document_freqs, double impact_step,
+                                const std::vector<double>& inv_word_counts) {
+    std::vector<std::vector<std::uint16_t>> impacts(postings_.size());
+    std::vector<std::size_t> slots(postings_.size());
+    std::iota(slots.begin(), slots.end(), 0);
+    std::for_each(std::execution::par, slots.begin(), slots.end(), [&](std::size_t slot) {
+        const double inverse_document_freq = terms_[slot] < inverse_document_freqs.size()
+                                             ? inverse_document_freqs[terms_[slot]]
+                                             : 0.0;
+        impacts[slot].resize(postings_[slot].size());
+        for (PostingCursor cursor(postings_[slot], inv_word_counts, 0, std::numeric_limits<int>::max());
+             !cursor.IsEnd(); cursor.Next()) {
+            const double impact = std::round(cursor.TermFreq() * inverse_document_freq / impact_step);
+            impacts[slot][cursor.Position()] = static_cast<std::uint16_t>(
+                    std::min(impact, static_cast<double>(std::numeric_limits<std::uint16_t>::max())));
+        }
+    });
+    impacts_ = std::move(impacts);
+}
+
+void IndexSegment::ClearImpacts() {
+    impacts_.clear();
+}
+
+const DocumentBitmap* IndexSegment::FindBitmap(TermId term) const {
+    if (bitmaps_.empty()) {
+        return nullptr;
+    }
+    const auto it = term_slots_.find(term);
+    return it == term_slots_.end() || it->second >= bitmaps_.size() || bitmaps_[it->second].IsEmpty()
+           ? nullptr
+           : &bitmaps_[it->second];
+}
+
+void IndexSegment::BuildBitmaps(const std::vector<double>& inv_word_counts) {
+    std::vector<DocumentBitmap> bitmaps(postings_.size());
+    for (std::size_t slot = 0; slot < postings_.size(); ++slot) {
+        if (postings_[slot].size() < kMinBitmapPostings) {
+            continue;
+        }
+        for (PostingCursor cursor(postings_[slot], inv_word_counts, 0, std::numeric_limits<int>::max());
+             !cursor.IsEnd(); cursor.Next()) {
+            bitmaps[slot].Add(cursor.DocumentId());
+        }
+    }
+    bitmaps_ = std::move(bitmaps);
+}
+
+std::size_t IndexSegment::GetMemoryUsage() const {
+    std::size_t bytes = (documents_.capacity() + deleted_.capacity()) * sizeof(std::uint64_t);
+    for (const PostingList& postings : postings_) {
+        bytes += postings.GetMemoryUsage();
+    }
+    for (const auto& impacts : impacts_) {
+        bytes += impacts.capacity() * sizeof(std::uint16_t);
+    }
+    for (const DocumentBitmap& bitmap : bitmaps_) {
+        bytes += bitmap.GetMemoryUsage();
+    }
+    return bytes;
+}
+
+std::shared_ptr<IndexSegment> BuildMergedSegment(const std::vector<std::shared_ptr<const IndexSegment>>& segments,
+                                                 const std::vector<std::vector<std::uint64_t>>& deleted,
+                                                 const std::vector<double>& inv_word_counts,
+                                                 bool compress,
+                                                 const std::vector<double>* inverse_document_freqs,
+                                                 double impact_step) {
+    auto merged = std::make_shared<IndexSegment>();
+    std::vector<int> document_ids;
+    std::vector<double> term_freqs;
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        segments[i]->ForEachTerm([&](TermId term, const PostingList& postings) {
+            document_ids.clear();
+            term_freqs.clear();
+            for (PostingCursor cursor(postings, inv_word_counts, 0, std::numeric_limits<int>::max());
+                 !cursor.IsEnd(); cursor.Next()) {
+                if (!TestBit(deleted[i], cursor.DocumentId())) {
+                    document_ids.push_back(cursor.DocumentId());
+                    term_freqs.push_back(cursor.TermFreq());
+                }
+            }
+            if (!document_ids.empty()) {
+                // Живой документ есть только в одном источнике, так что списки лишь чередуются
+                merged->GetPostings(term).Merge(document_ids.data(), term_freqs.data(), document_ids.size());
+                for (const int document_id : document_ids) {
+                    merged->AddDocument(document_id);
+                }
+            }
+        });
+    }
+    if (compress) {
+        merged->Compress(inv_word_counts);
+    }
+    merged->BuildBitmaps(inv_word_counts);
+    if (inverse_document_freqs != nullptr) {
+        merged->BuildImpacts(*inverse_document_freqs, impact_step, inv_word_counts);
+    }
+    return merged;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "document_bitmap.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+// Сегмент индекса: списки вхождений слов для части документов. Удалённый документ
+// не вычёркивается из списков, а отмечается в битовой маске надгробий и пропускается
+// при поиске, пока сегмент не перепишет слияние. Запечатанный сегмент больше не
+// меняется, кроме надгробий, поэтому его списки можно читать из фонового слияния
+class IndexSegment {
+public:
+    // Битовые множества документов строятся для слов не реже этого
+    static constexpr std::size_t kMinBitmapPostings = 256;
+
+    // Отмечает, что вхождения документа лежат в этом сегменте
+    void AddDocument(int document_id);
+
+    // Ставит надгробие документу сегмента
+    void Delete(int document_id);
+
+    // Забывает документ, чьи вхождения уже вычеркнуты из списков
+    void Erase(int document_id);
+
+    // Документ есть в сегменте и не удалён
+    bool Contains(int document_id) const;
+
+    // Удалён ли документ; id должен принадлежать сегменту
+    bool IsDeleted(int document_id) const {
+        return (deleted_[static_cast<std::size_t>(document_id) / 64] >> (document_id % 64) & 1) != 0;
+    }
+
+    // Список вхождений слова или nullptr, если слова в сегменте нет
+    const PostingList* Find(TermId term) const;
+
+    // Список слова; заводит пустой, если его не было
+    PostingList& GetPostings(TermId term);
+
+    // Вызывает function(term, postings) для непустых списков по возрастанию номера слова
+    template <typename Function>
+    void ForEachTerm(Function function) const;
+
+    // Все документы сегмента, включая удалённые
+    std::size_t GetDocumentCount() const;
+
+    std::size_t GetDeletedCount() const;
+
+    std::size_t GetLiveCount() const;
+
+    const std::vector<std::uint64_t>& GetDeleted() const;
+
+    bool HasCompressedPostings() const;
+
+    void Compress(const std::vector<double>& inv_word_counts);
+
+    // Вклады tf·idf вхождений слова в порядке списка, делённые на impact_step и округлённые
+    // до uint16; nullptr, если сегмент их не хранит
+    const std::uint16_t* FindImpacts(TermId term) const;
+
+    bool HasImpacts() const;
+
+    // inverse_document_freqs - IDF по номеру слова
+    void BuildImpacts(const std::vector<double>& inverse_document_freqs, double impact_step,
+                      const std::vector<double>& inv_word_counts);
+
+    // Вызывается при изменении списков, после которого вклады уже не соответствуют им
+    void ClearImpacts();
+
+    // Документы слова битовым множеством, включая удалённые; nullptr, если слово
+    // в сегменте редкое или множества не строились
+    const DocumentBitmap* FindBitmap(TermId term) const;
+
+    // Строит множества частых слов; вызывается, когда списки сегмента больше не меняются
+    void BuildBitmaps(const std::vector<double>& inv_word_counts);
+
+    std::size_t GetMemoryUsage() const;
+
+private:
+    std::unordered_map<TermId, std::size_t> term_slots_;
+    std::vector<TermId> terms_;
+    std::vector<PostingList> postings_;
+    std::vector<std::vector<std::uint16_t>> impacts_;
+    std::vector<DocumentBitmap> bitmaps_;
+    std::vector<std::uint64_t> documents_;
+    std::vector<std::uint64_t> deleted_;
+    std::size_t document_count_ = 0;
+    std::size_t deleted_count_ = 0;
+};
+
+// Сливает сегменты в новый, оставляя только документы, не отмеченные в deleted -
+// копиях масок надгробий источников на момент начала слияния. Читает лишь списки
+// источников, поэтому может идти в другом потоке, пока в источники ставятся надгробия.
+// Если передан inverse_document_freqs, новый сегмент сразу получает квантованные вклады
+std::shared_ptr<IndexSegment> BuildMergedSegment(const std::vector<std::shared_ptr<const IndexSegment>>& segments,
+                                                 const std::vector<std::vector<std::uint64_t>>& deleted,
+                                                 const std::vector<double>& inv_word_counts,
+                                                 bool compress,
+                                                 const std::vector<double>* inverse_document_freqs = nullptr,
+                                                 double impact_step = 0.0);
+
+template <typename Function>
+void IndexSegment::ForEachTerm(Function function) const {
+    std::vector<std::size_t> slots;
+    slots.reserve(terms_.size());
+    for (std::size_t slot = 0; slot < terms_.size(); ++slot) {
+        if (!postings_[slot].empty()) {
+            slots.push_back(slot);
+        }
+    }
+    std::sort(slots.begin(), slots.end(), [this](std::size_t lhs, std::size_t rhs) {
+        return terms_[lhs] < terms_[rhs];
+    });
+    for (const std::size_t slot : slots) {
+        function(terms_[slot], postings_[slot]);
+    }
+}
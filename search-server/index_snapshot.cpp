@@ -0,0 +1,524 @@
+#include "index_snapshot.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bit_packing.h"
+
+// Формат снимка: заголовок, затем секции по 8-байтовым границам.
+// Числа пишутся в порядке байт машины, поэтому снимок с другим порядком отвергается.
+//
+//   заголовок
+//   строки      - все тексты стоп-слов и слов подряд
+//   стоп-слова  - StringEntry на каждое
+//   слова       - WordEntry на каждое; позиция слова служит его номером в словах документов
+//   документы   - DocumentEntry на каждый, по возрастанию id
+//   1 / (число слов) для каждого id документа
+//   слова документов - начало слов каждого документа, затем частоты и номера слов
+//   списки вхождений - для каждого слова id и частоты либо блоки и сжатые данные
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Can't open snapshot ") + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string("Can't read snapshot ") + path);
+    }
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error(std::string("Can't map snapshot ") + path);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+    // Отображение остаётся действительным и после закрытия дескриптора
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+const char* MappedFile::data() const {
+    return data_;
+}
+
+std::size_t MappedFile::size() const {
+    return size_;
+}
+
+namespace {
+
+static_assert(std::numeric_limits<double>::is_iec559, "Snapshot stores IEEE 754 doubles");
+static_assert(sizeof(PostingList::BlockInfo) == 16 && std::is_trivially_copyable_v<PostingList::BlockInfo>,
+              "Snapshot stores blocks as is");
+
+constexpr char kSnapshotMagic[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+constexpr std::uint32_t kSnapshotVersion = 1;
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+constexpr std::uint64_t kAlignment = 8;
+
+struct Section {
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order_mark;
+    std::uint64_t file_size;
+    // FNV-1a всего, что идёт после заголовка
+    std::uint64_t checksum;
+    Section strings;
+    Section stop_words;
+    Section words;
+    Section documents;
+    Section inv_word_counts;
+    // count - число документов + 1, последнее начало равно числу всех пар слово-документ
+    Section document_word_offsets;
+    Section document_term_freqs;
+    Section document_words;
+};
+
+struct StringEntry {
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// Список сжат, если block_count > 0
+struct WordEntry {
+    StringEntry text;
+    std::uint64_t size;
+    std::uint64_t block_count;
+    std::uint64_t compressed_data_size;
+    std::uint64_t data_offset;
+    double max_term_freq;
+};
+
+struct DocumentEntry {
+    std::int32_t id;
+    std::int32_t rating;
+    std::int32_t status;
+    std::int32_t reserved;
+};
+
+std::uint64_t Align(std::uint64_t offset) {
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+class Checksum {
+public:
+    void Update(const char* data, std::size_t size) {
+        for (std::size_t i = 0; i < size; ++i) {
+            value_ ^= static_cast<unsigned char>(data[i]);
+            value_ *= 1099511628211ull;
+        }
+    }
+
+    std::uint64_t Get() const {
+        return value_;
+    }
+
+private:
+    std::uint64_t value_ = 14695981039346656037ull;
+};
+
+// Последовательная запись с подсчётом позиции и контрольной суммы
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path)
+            : output_(path, std::ios::binary | std::ios::trunc) {
+        if (!output_) {
+            throw std::runtime_error(std::string("Can't create snapshot ") + path);
+        }
+        const SnapshotHeader header{};
+        output_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        position_ = sizeof(header);
+    }
+
+    void Write(const void* data, std::size_t size) {
+        output_.write(static_cast<const char*>(data), size);
+        checksum_.Update(static_cast<const char*>(data), size);
+        position_ += size;
+    }
+
+    void PadTo(std::uint64_t offset) {
+        static const char zeros[kAlignment] = {};
+        while (position_ < offset) {
+            Write(zeros, std::min<std::uint64_t>(offset - position_, kAlignment));
+        }
+    }
+
+    std::uint64_t GetPosition() const {
+        return position_;
+    }
+
+    void Finish(SnapshotHeader& header) {
+        header.file_size = position_;
+        header.checksum = checksum_.Get();
+        output_.seekp(0);
+        output_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output_.close();
+        if (!output_) {
+            throw std::runtime_error(std::string("Can't write snapshot"));
+        }
+    }
+
+private:
+    std::ofstream output_;
+    Checksum checksum_;
+    std::uint64_t position_ = 0;
+};
+
+std::uint64_t GetPostingsDataSize(const PostingList::Data& data) {
+    if (data.block_count > 0) {
+        return Align(data.block_count * sizeof(PostingList::BlockInfo))
+               + Align(data.compressed_data_size * sizeof(std::uint32_t));
+    }
+    return Align(data.size * sizeof(int)) + data.size * sizeof(double);
+}
+
+[[noreturn]] void ThrowCorrupted() {
+    throw std::invalid_argument(std::string("Snapshot is corrupted"));
+}
+
+void Check(bool condition) {
+    if (!condition) {
+        ThrowCorrupted();
+    }
+}
+
+template <typename T>
+const T* GetArray(const MappedFile& file, std::uint64_t offset, std::uint64_t count) {
+    Check(offset >= sizeof(SnapshotHeader) && offset <= file.size() && offset % alignof(T) == 0);
+    Check(count <= (file.size() - offset) / sizeof(T));
+    return reinterpret_cast<const T*>(file.data() + offset);
+}
+
+std::string_view GetString(std::string_view strings, const StringEntry& entry) {
+    Check(entry.offset <= strings.size() && entry.size <= strings.size() - entry.offset);
+    return strings.substr(entry.offset, entry.size);
+}
+
+std::size_t GetPackedSize(std::size_t count, int bit_width) {
+    return (count * bit_width + 31) / 32;
+}
+
+// Вхождение слова word допустимо, только если документ есть в снимке и среди его слов есть word.
+// document_words_by_id[id] - слова документа id или nullptr, если такого документа нет
+void CheckPosting(const std::vector<const TermFrequencies*>& document_words_by_id, long long document_id,
+                  TermId word) {
+    Check(document_id >= 0 && document_id < static_cast<long long>(document_words_by_id.size()));
+    const TermFrequencies* document_words = document_words_by_id[document_id];
+    Check(document_words != nullptr && ContainsTerm(*document_words, word));
+}
+
+// Проверяет, что id списка идут строго по возрастанию, каждое вхождение подтверждено
+// словами своего документа и сжатые блоки не выходят за свои данные
+void CheckPostings(const PostingList::Data& data, TermId word,
+                   const std::vector<const TermFrequencies*>& document_words_by_id) {
+    const int id_bound = static_cast<int>(document_words_by_id.size());
+    if (data.block_count == 0) {
+        for (std::size_t i = 0; i < data.size; ++i) {
+            CheckPosting(document_words_by_id, data.document_ids[i], word);
+            Check(i == 0 || data.document_ids[i - 1] < data.document_ids[i]);
+        }
+        return;
+    }
+    std::size_t posting_count = 0;
+    int previous_id = -1;
+    std::uint32_t values[PostingList::kBlockSize];
+    for (std::size_t block = 0; block < data.block_count; ++block) {
+        const PostingList::BlockInfo& info = data.blocks[block];
+        // Номер вхождения курсор выводит из номера блока, поэтому неполным может быть только последний
+        Check(info.size > 0 && info.size <= PostingList::kBlockSize);
+        Check(info.size == PostingList::kBlockSize || block + 1 == data.block_count);
+        Check(info.id_bit_width <= 32 && info.count_bit_width <= 32);
+        Check(info.first_document_id > previous_id && info.last_document_id < id_bound);
+        const std::size_t packed_size = GetPackedSize(info.size, info.id_bit_width)
+                                        + GetPackedSize(info.size, info.count_bit_width);
+        Check(info.offset <= data.compressed_data_size && packed_size <= data.compressed_data_size - info.offset);
+
+        // Первая разность всегда 0, остальные - положительные
+        UnpackBits(data.compressed_data + info.offset, info.size, info.id_bit_width, values);
+        long long document_id = info.first_document_id;
+        Check(values[0] == 0);
+        CheckPosting(document_words_by_id, document_id, word);
+        for (std::size_t i = 1; i < info.size; ++i) {
+            Check(values[i] > 0);
+            document_id += values[i];
+            CheckPosting(document_words_by_id, document_id, word);
+        }
+        Check(document_id == info.last_document_id);
+        previous_id = info.last_document_id;
+        posting_count += info.size;
+    }
+    Check(posting_count == data.size);
+}
+
+}  // namespace
+
+void WriteIndexSnapshot(const std::string& path,
+                        const std::vector<std::string_view>& stop_words,
+                        const std::vector<SnapshotDocument>& documents,
+                        const TermDictionary& dictionary,
+                        const InvertedIndex& index) {
+    // Раскладка известна заранее, поэтому файл пишется за один проход
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.version = kSnapshotVersion;
+    header.byte_order_mark = kByteOrderMark;
+
+    std::vector<std::string_view> words;
+    std::vector<PostingList::Data> postings;
+    std::vector<double> max_term_freqs;
+    // Номера слов могут идти с пропусками, в снимке они нумеруются подряд
+    std::vector<std::uint32_t> term_positions(dictionary.GetTermIdBound(), 0);
+    words.reserve(dictionary.size());
+    postings.reserve(dictionary.size());
+    max_term_freqs.reserve(dictionary.size());
+    std::uint64_t strings_size = 0;
+    for (const std::string_view stop_word : stop_words) {
+        strings_size += stop_word.size();
+    }
+    index.ForEachTerm([&](TermId term, const PostingList& word_postings) {
+        const std::string_view word = dictionary.GetWord(term);
+        term_positions[term] = static_cast<std::uint32_t>(words.size());
+        words.push_back(word);
+        postings.push_back(word_postings.GetData());
+        max_term_freqs.push_back(word_postings.GetMaxTermFreq());
+        strings_size += word.size();
+    });
+    const std::vector<double>& inv_word_counts = index.GetInvWordCounts();
+
+    // Слова документов собираются из списков вхождений: слова обходятся по
+    // возрастанию номера, поэтому у каждого документа номера сразу упорядочены
+    std::vector<std::uint32_t> document_positions(inv_word_counts.size());
+    for (std::size_t i = 0; i < documents.size(); ++i) {
+        document_positions[documents[i].id] = static_cast<std::uint32_t>(i);
+    }
+    std::vector<std::uint64_t> document_word_offsets(documents.size() + 1, 0);
+    index.ForEachTerm([&](TermId, const PostingList& word_postings) {
+        for (PostingCursor cursor = index.GetCursor(word_postings, 0, std::numeric_limits<int>::max());
+             !cursor.IsEnd(); cursor.Next()) {
+            ++document_word_offsets[document_positions[cursor.DocumentId()] + 1];
+        }
+    });
+    for (std::size_t i = 0; i < documents.size(); ++i) {
+        document_word_offsets[i + 1] += document_word_offsets[i];
+    }
+    const std::uint64_t document_word_count = document_word_offsets.back();
+    std::vector<std::uint32_t> document_words(document_word_count);
+    std::vector<double> document_term_freqs(document_word_count);
+    {
+        std::vector<std::uint64_t> next_positions(document_word_offsets.begin(), document_word_offsets.end() - 1);
+        index.ForEachTerm([&](TermId term, const PostingList& word_postings) {
+            for (PostingCursor cursor = index.GetCursor(word_postings, 0, std::numeric_limits<int>::max());
+                 !cursor.IsEnd(); cursor.Next()) {
+                const std::uint64_t position = next_positions[document_positions[cursor.DocumentId()]]++;
+                document_words[position] = term_positions[term];
+                document_term_freqs[position] = cursor.TermFreq();
+            }
+        });
+    }
+
+    header.strings = {sizeof(SnapshotHeader), strings_size};
+    header.stop_words = {Align(header.strings.offset + strings_size), stop_words.size()};
+    header.words = {header.stop_words.offset + stop_words.size() * sizeof(StringEntry), words.size()};
+    header.documents = {header.words.offset + words.size() * sizeof(WordEntry), documents.size()};
+    header.inv_word_counts = {Align(header.documents.offset + documents.size() * sizeof(DocumentEntry)),
+                              inv_word_counts.size()};
+    header.document_word_offsets = {header.inv_word_counts.offset + inv_word_counts.size() * sizeof(double),
+                                    document_word_offsets.size()};
+    header.document_term_freqs = {header.document_word_offsets.offset
+                                  + document_word_offsets.size() * sizeof(std::uint64_t), document_word_count};
+    header.document_words = {header.document_term_freqs.offset + document_word_count * sizeof(double),
+                             document_word_count};
+    const std::uint64_t postings_offset = Align(header.document_words.offset
+                                                + document_word_count * sizeof(std::uint32_t));
+
+    const std::string temp_path = path + ".tmp";
+    SnapshotWriter writer(temp_path);
+    for (const std::string_view stop_word : stop_words) {
+        writer.Write(stop_word.data(), stop_word.size());
+    }
+    for (const std::string_view word : words) {
+        writer.Write(word.data(), word.size());
+    }
+
+    writer.PadTo(header.stop_words.offset);
+    std::uint64_t string_offset = 0;
+    for (const std::string_view stop_word : stop_words) {
+        const StringEntry entry{string_offset, stop_word.size()};
+        writer.Write(&entry, sizeof(entry));
+        string_offset += stop_word.size();
+    }
+
+    std::uint64_t data_offset = postings_offset;
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        const WordEntry entry{{string_offset, words[i].size()}, postings[i].size, postings[i].block_count,
+                              postings[i].compressed_data_size, data_offset, max_term_freqs[i]};
+        writer.Write(&entry, sizeof(entry));
+        string_offset += words[i].size();
+        data_offset += GetPostingsDataSize(postings[i]);
+    }
+
+    for (const SnapshotDocument& document : documents) {
+        const DocumentEntry entry{document.id, document.rating, static_cast<std::int32_t>(document.status), 0};
+        writer.Write(&entry, sizeof(entry));
+    }
+
+    writer.PadTo(header.inv_word_counts.offset);
+    writer.Write(inv_word_counts.data(), inv_word_counts.size() * sizeof(double));
+    writer.Write(document_word_offsets.data(), document_word_offsets.size() * sizeof(std::uint64_t));
+    writer.Write(document_term_freqs.data(), document_term_freqs.size() * sizeof(double));
+    writer.Write(document_words.data(), document_words.size() * sizeof(std::uint32_t));
+    writer.PadTo(postings_offset);
+
+    for (const PostingList::Data& data : postings) {
+        if (data.block_count > 0) {
+            writer.Write(data.blocks, data.block_count * sizeof(PostingList::BlockInfo));
+            writer.PadTo(Align(writer.GetPosition()));
+            writer.Write(data.compressed_data, data.compressed_data_size * sizeof(std::uint32_t));
+        } else {
+            writer.Write(data.document_ids, data.size * sizeof(int));
+            writer.PadTo(Align(writer.GetPosition()));
+            writer.Write(data.term_freqs, data.size * sizeof(double));
+        }
+        writer.PadTo(Align(writer.GetPosition()));
+    }
+    writer.Finish(header);
+
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error(std::string("Can't replace snapshot ") + path);
+    }
+}
+
+IndexSnapshot ReadIndexSnapshot(const std::string& path) {
+    IndexSnapshot snapshot;
+    const auto file = std::make_shared<const MappedFile>(path);
+    snapshot.file = file;
+
+    Check(file->size() >= sizeof(SnapshotHeader));
+    SnapshotHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        throw std::invalid_argument(std::string("File is not a search server snapshot"));
+    }
+    if (header.version != kSnapshotVersion || header.byte_order_mark != kByteOrderMark) {
+        throw std::invalid_argument(std::string("Unsupported snapshot version"));
+    }
+    Check(header.file_size == file->size());
+    Checksum checksum;
+    checksum.Update(file->data() + sizeof(header), file->size() - sizeof(header));
+    Check(checksum.Get() == header.checksum);
+
+    const std::string_view strings(GetArray<char>(*file, header.strings.offset, header.strings.count),
+                                   header.strings.count);
+
+    const StringEntry* stop_words = GetArray<StringEntry>(*file, header.stop_words.offset, header.stop_words.count);
+    snapshot.stop_words.reserve(header.stop_words.count);
+    for (std::uint64_t i = 0; i < header.stop_words.count; ++i) {
+        snapshot.stop_words.push_back(GetString(strings, stop_words[i]));
+    }
+
+    const double* inv_word_counts = GetArray<double>(*file, header.inv_word_counts.offset,
+                                                     header.inv_word_counts.count);
+    Check(header.inv_word_counts.count <= static_cast<std::uint64_t>(std::numeric_limits<int>::max()));
+    snapshot.inv_word_counts.assign(inv_word_counts, inv_word_counts + header.inv_word_counts.count);
+    const int id_bound = static_cast<int>(header.inv_word_counts.count);
+
+    const DocumentEntry* documents = GetArray<DocumentEntry>(*file, header.documents.offset,
+                                                             header.documents.count);
+    snapshot.documents.reserve(header.documents.count);
+    for (std::uint64_t i = 0; i < header.documents.count; ++i) {
+        const DocumentEntry& entry = documents[i];
+        Check(entry.id >= 0 && entry.id < id_bound && (i == 0 || documents[i - 1].id < entry.id));
+        Check(entry.status >= static_cast<std::int32_t>(DocumentStatus::ACTUAL)
+              && entry.status <= static_cast<std::int32_t>(DocumentStatus::REMOVED));
+        snapshot.documents.push_back({entry.id, entry.rating, static_cast<DocumentStatus>(entry.status)});
+    }
+
+    const std::uint64_t* document_word_offsets = GetArray<std::uint64_t>(
+            *file, header.document_word_offsets.offset, header.document_word_offsets.count);
+    const double* document_term_freqs = GetArray<double>(*file, header.document_term_freqs.offset,
+                                                         header.document_term_freqs.count);
+    const std::uint32_t* document_words = GetArray<std::uint32_t>(*file, header.document_words.offset,
+                                                                  header.document_words.count);
+    Check(header.document_word_offsets.count == header.documents.count + 1
+          && header.document_term_freqs.count == header.document_words.count
+          && document_word_offsets[0] == 0
+          && document_word_offsets[header.documents.count] == header.document_words.count);
+    snapshot.document_words.reserve(header.documents.count);
+    // Сколько документов называет каждое слово: столько же вхождений должно быть в его списке
+    std::vector<std::uint64_t> word_document_counts(header.words.count, 0);
+    for (std::uint64_t i = 0; i < header.documents.count; ++i) {
+        const std::uint64_t begin = document_word_offsets[i];
+        const std::uint64_t end = document_word_offsets[i + 1];
+        Check(begin <= end && end <= header.document_words.count);
+        for (std::uint64_t j = begin; j < end; ++j) {
+            Check(document_words[j] < header.words.count && (j == begin || document_words[j - 1] < document_words[j]));
+            ++word_document_counts[document_words[j]];
+        }
+        snapshot.document_words.push_back({document_words + begin, document_term_freqs + begin, end - begin});
+    }
+    std::vector<const TermFrequencies*> document_words_by_id(id_bound, nullptr);
+    for (std::size_t i = 0; i < snapshot.documents.size(); ++i) {
+        document_words_by_id[snapshot.documents[i].id] = &snapshot.document_words[i];
+    }
+
+    const WordEntry* words = GetArray<WordEntry>(*file, header.words.offset, header.words.count);
+    snapshot.words.reserve(header.words.count);
+    for (std::uint64_t i = 0; i < header.words.count; ++i) {
+        const WordEntry& entry = words[i];
+        IndexSnapshot::Word word{GetString(strings, entry.text), {}, entry.max_term_freq};
+        Check(!word.text.empty());
+        PostingList::Data& data = word.postings;
+        data.size = entry.size;
+        if (entry.block_count > 0) {
+            data.block_count = entry.block_count;
+            data.blocks = GetArray<PostingList::BlockInfo>(*file, entry.data_offset, entry.block_count);
+            data.compressed_data_size = entry.compressed_data_size;
+            data.compressed_data = GetArray<std::uint32_t>(
+                    *file, Align(entry.data_offset + entry.block_count * sizeof(PostingList::BlockInfo)),
+                    entry.compressed_data_size);
+        } else {
+            data.document_ids = GetArray<int>(*file, entry.data_offset, entry.size);
+            data.term_freqs = GetArray<double>(*file, Align(entry.data_offset + entry.size * sizeof(int)),
+                                               entry.size);
+        }
+        Check(data.size > 0 && data.size == word_document_counts[i]);
+        CheckPostings(data, static_cast<TermId>(i), document_words_by_id);
+        snapshot.words.push_back(word);
+    }
+    return snapshot;
+}
+
+const TermFrequencies* IndexSnapshot::FindDocumentWords(int document_id) const {
+    const auto it = std::lower_bound(documents.begin(), documents.end(), document_id,
+                                     [](const SnapshotDocument& document, int id) {
+        return document.id < id;
+    });
+    if (it == documents.end() || it->id != document_id) {
+        return nullptr;
+    }
+    return &document_words[it - documents.begin()];
+}
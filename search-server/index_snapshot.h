@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document.h"
+#include "inverted_index.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char* data() const;
+
+    std::size_t size() const;
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+struct SnapshotDocument {
+    int id;
+    int rating;
+    DocumentStatus status;
+};
+
+// Снимок поверх отображённого файла: строки слов, списки вхождений и слова
+// документов указывают прямо в него, поэтому живут, пока жив file
+struct IndexSnapshot {
+    struct Word {
+        std::string_view text;
+        PostingList::Data postings;
+        double max_term_freq;
+    };
+
+    std::shared_ptr<const MappedFile> file;
+    std::vector<std::string_view> stop_words;
+    std::vector<Word> words;
+    // Документы по возрастанию id и их слова в том же порядке; номер слова - его позиция в words
+    std::vector<SnapshotDocument> documents;
+    std::vector<TermFrequencies> document_words;
+    std::vector<double> inv_word_counts;
+
+    // Слова документа или nullptr, если документа в снимке нет
+    const TermFrequencies* FindDocumentWords(int document_id) const;
+};
+
+// Пишет снимок во временный файл и переименовывает его в path, так что
+// прерванная запись не портит предыдущий снимок
+void WriteIndexSnapshot(const std::string& path,
+                        const std::vector<std::string_view>& stop_words,
+                        const std::vector<SnapshotDocument>& documents,
+                        const TermDictionary& dictionary,
+                        const InvertedIndex& index);
+
+// Проверяет сигнатуру, версию, контрольную сумму, границы всех массивов и то, что
+// списки вхождений в точности совпадают со словами документов;
+// повреждённый снимок отвергается исключением
+IndexSnapshot ReadIndexSnapshot(const std::string& path);
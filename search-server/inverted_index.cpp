@@ -0,0 +1,410 @@
+#include "inverted_index.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "sorted_intersection.h"
+
+std::ostream& operator<<(std::ostream& output, const IndexMemoryUsage& usage) {
+    output << "{ words = " << usage.word_count << ", postings = " << usage.posting_count
+           << ", compressed postings = " << usage.compressed_posting_count
+           << ", flat bytes = " << usage.flat_bytes << ", bytes = " << usage.bytes
+           << ", segments = " << usage.segment_count << ", deleted documents = " << usage.deleted_document_count
+           << " }";
+    return output;
+}
+
+InvertedIndex::InvertedIndex()
+        : segments_{std::make_shared<IndexSegment>()} {
+}
+
+void InvertedIndex::AddDocument(int document_id, const TermFrequencies& term_freqs, double inv_word_count) {
+    SetInvWordCount(document_id, inv_word_count);
+    IndexSegment& segment = GetMutableSegment();
+    segment.ClearImpacts();
+    segment.AddDocument(document_id);
+    ++document_count_;
+    for (std::size_t i = 0; i < term_freqs.size; ++i) {
+        PostingList& postings = segment.GetPostings(term_freqs.terms[i]);
+        postings.Decompress(inv_word_counts_);
+        postings.Add(document_id, term_freqs.term_freqs[i]);
+        IncreaseDocumentFreq(term_freqs.terms[i], 1);
+    }
+    MaintainSegments();
+}
+
+std::vector<TermId> InvertedIndex::RemoveDocument(int document_id, const TermFrequencies& term_freqs) {
+    IndexSegment& mutable_segment = GetMutableSegment();
+    if (mutable_segment.Contains(document_id)) {
+        mutable_segment.ClearImpacts();
+        // Изменяемый сегмент невелик, и из него вхождения вычёркиваются сразу:
+        // иначе документ с тем же id нельзя было бы снова добавить в этот сегмент
+        for (std::size_t i = 0; i < term_freqs.size; ++i) {
+            PostingList& postings = mutable_segment.GetPostings(term_freqs.terms[i]);
+            postings.Decompress(inv_word_counts_);
+            postings.Remove(document_id);
+        }
+        mutable_segment.Erase(document_id);
+    } else {
+        // Живой документ лежит ровно в одном сегменте, чаще всего в одном из новых
+        for (auto it = segments_.rbegin() + 1; it != segments_.rend(); ++it) {
+            if ((*it)->Contains(document_id)) {
+                (*it)->Delete(document_id);
+                break;
+            }
+        }
+    }
+    --document_count_;
+    std::vector<TermId> released_terms;
+    for (std::size_t i = 0; i < term_freqs.size; ++i) {
+        const TermId term = term_freqs.terms[i];
+        if (GetDocumentFreq(term) == 0) {
+            continue;
+        }
+        DecreaseDocumentFreq(term);
+        if (GetDocumentFreq(term) == 0) {
+            // Вхождения слова в удалённых документах ещё лежат в сегментах, но поиск их
+            // пропускает, поэтому номер можно отдать другому слову сразу
+            released_terms.push_back(term);
+        }
+    }
+    MaintainSegments();
+    return released_terms;
+}
+
+std::size_t InvertedIndex::GetDocumentFreq(TermId term) const {
+    return term < document_freqs_.size() ? document_freqs_[term] : 0;
+}
+
+std::size_t InvertedIndex::GetDocumentCount() const {
+    return document_count_;
+}
+
+double InvertedIndex::GetInverseDocumentFreq(TermId term) const {
+    if (idf_document_count_ == document_count_ && term < inverse_document_freqs_.size()
+        && inverse_document_freqs_[term] >= 0.0) {
+        return inverse_document_freqs_[term];
+    }
+    return std::log(document_count_ * 1.0 / GetDocumentFreq(term));
+}
+
+void InvertedIndex::RefreshInverseDocumentFreqs() {
+    inverse_document_freqs_ = ComputeInverseDocumentFreqs();
+    idf_document_count_ = document_count_;
+}
+
+void InvertedIndex::QuantizeImpacts() {
+    // Фоновое слияние строит сегмент со старыми вкладами или без них
+    if (pending_merge_) {
+        InstallMerge();
+    }
+    RefreshInverseDocumentFreqs();
+    // Шаг выбран так, чтобы без переполнения уместить наибольший возможный вклад
+    // (слово из одного документа, tf = 1), пока документов меньше чем вдвое больше
+    impact_step_ = std::log(2.0 * (document_count_ + 1)) / std::numeric_limits<std::uint16_t>::max();
+    for (const auto& segment : segments_) {
+        segment->BuildImpacts(inverse_document_freqs_, impact_step_, inv_word_counts_);
+    }
+    is_quantized_ = true;
+}
+
+bool InvertedIndex::IsQuantized() const {
+    return is_quantized_;
+}
+
+double InvertedIndex::GetImpactStep() const {
+    return impact_step_;
+}
+
+bool InvertedIndex::IsCompact() const {
+    std::size_t non_empty_count = 0;
+    for (const auto& segment : segments_) {
+        if (segment->GetDeletedCount() > 0) {
+            return false;
+        }
+        non_empty_count += segment->GetDocumentCount() > 0;
+    }
+    return non_empty_count <= 1;
+}
+
+InvertedIndex InvertedIndex::Compact() const {
+    std::vector<std::shared_ptr<const IndexSegment>> sources(segments_.begin(), segments_.end());
+    std::vector<std::vector<std::uint64_t>> deleted;
+    deleted.reserve(sources.size());
+    for (const auto& segment : segments_) {
+        deleted.push_back(segment->GetDeleted());
+    }
+    InvertedIndex compacted;
+    compacted.document_freqs_ = document_freqs_;
+    compacted.document_count_ = document_count_;
+    compacted.inverse_document_freqs_ = ComputeInverseDocumentFreqs();
+    compacted.idf_document_count_ = document_count_;
+    compacted.inv_word_counts_ = inv_word_counts_;
+    compacted.is_compressed_ = is_compressed_;
+    compacted.is_quantized_ = is_quantized_;
+    compacted.impact_step_ = impact_step_;
+    compacted.segments_.insert(compacted.segments_.begin(),
+                               BuildMergedSegment(sources, deleted, inv_word_counts_, is_compressed_,
+                                                  is_quantized_ ? &compacted.inverse_document_freqs_ : nullptr,
+                                                  impact_step_));
+    return compacted;
+}
+
+void InvertedIndex::AddSegment(std::vector<std::pair<TermId, PostingList>> postings,
+                               const std::vector<int>& document_ids) {
+    auto segment = std::make_shared<IndexSegment>();
+    for (const int document_id : document_ids) {
+        segment->AddDocument(document_id);
+    }
+    for (auto& [term, term_postings] : postings) {
+        IncreaseDocumentFreq(term, term_postings.size());
+        segment->GetPostings(term) = std::move(term_postings);
+    }
+    document_count_ += document_ids.size();
+    RefreshInverseDocumentFreqs();
+    if (is_quantized_) {
+        segment->BuildImpacts(inverse_document_freqs_, impact_step_, inv_word_counts_);
+    }
+    segment->BuildBitmaps(inv_word_counts_);
+    segments_.insert(segments_.end() - 1, std::move(segment));
+}
+
+void InvertedIndex::MergeSegments() {
+    if (pending_merge_) {
+        InstallMerge();
+    }
+    if (IsCompact()) {
+        RefreshInverseDocumentFreqs();
+        return;
+    }
+    *this = Compact();
+}
+
+const std::vector<double>& InvertedIndex::GetInvWordCounts() const {
+    return inv_word_counts_;
+}
+
+void InvertedIndex::SetInvWordCounts(std::vector<double> inv_word_counts) {
+    inv_word_counts_ = std::move(inv_word_counts);
+}
+
+PostingCursor InvertedIndex::GetCursor(const PostingList& postings, int begin_id, int end_id) const {
+    return PostingCursor(postings, inv_word_counts_, begin_id, end_id);
+}
+
+void InvertedIndex::IntersectPostings(const PostingList& postings, const int* document_ids,
+                                      std::size_t document_count, std::vector<std::size_t>& matches) const {
+    const PostingList::Data data = postings.GetData();
+    if (data.block_count == 0) {
+        IntersectSorted(document_ids, document_count, data.document_ids, data.size, matches);
+        return;
+    }
+    int block_document_ids[PostingList::kBlockSize];
+    double block_term_freqs[PostingList::kBlockSize];
+    const PostingList::BlockInfo* block = data.blocks;
+    const PostingList::BlockInfo* blocks_end = data.blocks + data.block_count;
+    std::size_t begin = 0;
+    while (begin < document_count) {
+        const int document_id = document_ids[begin];
+        block = std::partition_point(block, blocks_end, [document_id](const auto& info) {
+            return info.last_document_id < document_id;
+        });
+        if (block == blocks_end) {
+            return;
+        }
+        const std::size_t end = std::upper_bound(document_ids + begin, document_ids + document_count,
+                                                 block->last_document_id) - document_ids;
+        if (document_ids[end - 1] >= block->first_document_id) {
+            PostingList::DecodeBlock(data, block - data.blocks, inv_word_counts_, block_document_ids,
+                                     block_term_freqs);
+            const std::size_t first_match = matches.size();
+            IntersectSorted(document_ids + begin, end - begin, block_document_ids, block->size, matches);
+            for (std::size_t i = first_match; i < matches.size(); ++i) {
+                matches[i] += begin;
+            }
+        }
+        begin = end;
+        ++block;
+    }
+}
+
+void InvertedIndex::Compress() {
+    // Фоновое слияние читает списки источников, поэтому сжимать их можно только после него
+    if (pending_merge_) {
+        InstallMerge();
+    }
+    for (const auto& segment : segments_) {
+        segment->Compress(inv_word_counts_);
+    }
+    is_compressed_ = true;
+    RefreshInverseDocumentFreqs();
+}
+
+IndexMemoryUsage InvertedIndex::GetMemoryUsage() const {
+    IndexMemoryUsage usage;
+    usage.word_count = document_freqs_.size() - std::count(document_freqs_.begin(), document_freqs_.end(), 0);
+    usage.segment_count = segments_.size();
+    for (const auto& segment : segments_) {
+        usage.deleted_document_count += segment->GetDeletedCount();
+        usage.bytes += segment->GetMemoryUsage();
+        segment->ForEachTerm([&usage](TermId, const PostingList& postings) {
+            usage.posting_count += postings.size();
+            if (postings.IsCompressed()) {
+                usage.compressed_posting_count += postings.size();
+            }
+            usage.flat_bytes += sizeof(PostingList) + postings.size() * (sizeof(int) + sizeof(double));
+        });
+    }
+    return usage;
+}
+
+IndexSegment& InvertedIndex::GetMutableSegment() {
+    return *segments_.back();
+}
+
+void InvertedIndex::IncreaseDocumentFreq(TermId term, std::size_t count) {
+    if (document_freqs_.size() <= term) {
+        document_freqs_.resize(term + 1, 0);
+    }
+    document_freqs_[term] += count;
+    if (term < inverse_document_freqs_.size()) {
+        inverse_document_freqs_[term] = -1.0;
+    }
+}
+
+void InvertedIndex::DecreaseDocumentFreq(TermId term) {
+    --document_freqs_[term];
+    if (term < inverse_document_freqs_.size()) {
+        inverse_document_freqs_[term] = -1.0;
+    }
+}
+
+std::vector<double> InvertedIndex::ComputeInverseDocumentFreqs() const {
+    std::vector<double> inverse_document_freqs(document_freqs_.size(), -1.0);
+    for (std::size_t term = 0; term < document_freqs_.size(); ++term) {
+        if (document_freqs_[term] > 0) {
+            inverse_document_freqs[term] = std::log(document_count_ * 1.0 / document_freqs_[term]);
+        }
+    }
+    return inverse_document_freqs;
+}
+
+void InvertedIndex::SetInvWordCount(int document_id, double inv_word_count) {
+    if (inv_word_counts_.size() <= static_cast<std::size_t>(document_id)) {
+        inv_word_counts_.resize(document_id + 1, 0.0);
+    }
+    inv_word_counts_[document_id] = inv_word_count;
+}
+
+void InvertedIndex::MaintainSegments() {
+    if (pending_merge_ && pending_merge_->merged.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        InstallMerge();
+    }
+    if (GetMutableSegment().GetDocumentCount() >= kMutableSegmentSize) {
+        SealMutableSegment();
+    }
+    if (!pending_merge_) {
+        ScheduleMerge();
+    }
+}
+
+void InvertedIndex::SealMutableSegment() {
+    if (is_compressed_) {
+        GetMutableSegment().Compress(inv_word_counts_);
+    }
+    RefreshInverseDocumentFreqs();
+    if (is_quantized_) {
+        GetMutableSegment().BuildImpacts(inverse_document_freqs_, impact_step_, inv_word_counts_);
+    }
+    GetMutableSegment().BuildBitmaps(inv_word_counts_);
+    segments_.push_back(std::make_shared<IndexSegment>());
+}
+
+void InvertedIndex::ScheduleMerge() {
+    std::vector<std::shared_ptr<IndexSegment>> sources = PickMergeSources();
+    if (sources.empty()) {
+        return;
+    }
+    PendingMerge merge;
+    bool has_compressed_postings = is_compressed_;
+    for (const auto& segment : sources) {
+        merge.sources.push_back(segment);
+        merge.deleted.push_back(segment->GetDeleted());
+        has_compressed_postings = has_compressed_postings || segment->HasCompressedPostings();
+    }
+    // Сжатые списки распаковываются по числу слов документов, а его массив меняет
+    // писатель, поэтому слиянию достаётся копия; несжатым она не нужна
+    std::vector<double> inv_word_counts;
+    if (has_compressed_postings || is_quantized_) {
+        inv_word_counts = inv_word_counts_;
+    }
+    // Вклады слитого сегмента считаются по IDF на момент запуска слияния
+    std::optional<std::vector<double>> inverse_document_freqs;
+    if (is_quantized_) {
+        inverse_document_freqs = ComputeInverseDocumentFreqs();
+    }
+    merge.merged = std::async(std::launch::async, [sources = merge.sources, deleted = merge.deleted,
+                                                   inv_word_counts = std::move(inv_word_counts),
+                                                   inverse_document_freqs = std::move(inverse_document_freqs),
+                                                   compress = is_compressed_, impact_step = impact_step_] {
+        return BuildMergedSegment(sources, deleted, inv_word_counts, compress,
+                                  inverse_document_freqs ? &*inverse_document_freqs : nullptr, impact_step);
+    });
+    pending_merge_ = std::move(merge);
+}
+
+void InvertedIndex::InstallMerge() {
+    PendingMerge merge = std::move(*pending_merge_);
+    pending_merge_.reset();
+    std::shared_ptr<IndexSegment> merged = merge.merged.get();
+    // Надгробия, поставленные источникам во время слияния, переносятся в новый сегмент
+    for (std::size_t i = 0; i < merge.sources.size(); ++i) {
+        const std::vector<std::uint64_t>& deleted = merge.sources[i]->GetDeleted();
+        for (std::size_t word = 0; word < deleted.size(); ++word) {
+            std::uint64_t bits = deleted[word] & ~(word < merge.deleted[i].size() ? merge.deleted[i][word] : 0);
+            for (; bits != 0; bits &= bits - 1) {
+                merged->Delete(static_cast<int>(word * 64 + __builtin_ctzll(bits)));
+            }
+        }
+    }
+    const auto first = std::find(segments_.begin(), segments_.end(), merge.sources.front());
+    *first = std::move(merged);
+    segments_.erase(std::remove_if(segments_.begin(), segments_.end(), [&merge](const auto& segment) {
+        return std::find(merge.sources.begin() + 1, merge.sources.end(), segment) != merge.sources.end();
+    }), segments_.end());
+}
+
+std::vector<std::shared_ptr<IndexSegment>> InvertedIndex::PickMergeSources() const {
+    const auto get_tier = [](const IndexSegment& segment) {
+        std::size_t tier = 0;
+        for (std::size_t size = segment.GetLiveCount() / kMutableSegmentSize; size >= kMergeFactor;
+             size /= kMergeFactor) {
+            ++tier;
+        }
+        return tier;
+    };
+    const std::vector<std::shared_ptr<IndexSegment>> sealed(segments_.begin(), segments_.end() - 1);
+    std::vector<std::size_t> tier_sizes;
+    for (const auto& segment : sealed) {
+        const std::size_t tier = get_tier(*segment);
+        if (tier_sizes.size() <= tier) {
+            tier_sizes.resize(tier + 1, 0);
+        }
+        if (++tier_sizes[tier] == kMergeFactor) {
+            std::vector<std::shared_ptr<IndexSegment>> sources;
+            for (const auto& candidate : sealed) {
+                if (sources.size() < kMergeFactor && get_tier(*candidate) == tier) {
+                    sources.push_back(candidate);
+                }
+            }
+            return sources;
+        }
+    }
+    // Сегмент, где удалена больше чем половина документов, переписывается один
+    for (const auto& segment : sealed) {
+        if (segment->GetDeletedCount() * 2 > segment->GetDocumentCount()) {
+            return {segment};
+        }
+    }
+    return {};
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <vector>
+#include "index_segment.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+// Память, занятая списками вхождений индекса
+struct IndexMemoryUsage {
+    std::size_t word_count = 0;
+    std::size_t posting_count = 0;
+    std::size_t compressed_posting_count = 0;
+    // Сколько списки заняли бы в несжатом виде
+    std::size_t flat_bytes = 0;
+    // Сколько списки занимают сейчас
+    std::size_t bytes = 0;
+    std::size_t segment_count = 0;
+    // Удалённые документы, чьи вхождения ещё не вычистило слияние
+    std::size_t deleted_document_count = 0;
+};
+
+std::ostream& operator<<(std::ostream& output, const IndexMemoryUsage& usage);
+
+// Вхождения пакета новых документов, сгруппированные по словам: у i-го слова
+// вхождения [term_offsets[i], term_offsets[i + 1]) упорядочены по id документа
+struct PostingsBatch {
+    std::vector<TermId> terms;
+    std::vector<std::size_t> term_offsets;
+    std::vector<int> document_ids;
+    std::vector<double> term_freqs;
+    // id документа и 1 / (число его слов)
+    std::vector<std::pair<int, double>> inv_word_counts;
+};
+
+// Обратный индекс из сегментов: новые документы пишутся в изменяемый сегмент, который,
+// набрав kMutableSegmentSize документов, запечатывается. Из изменяемого сегмента
+// документ удаляется сразу, в запечатанном ему ставится надгробие. Запечатанные сегменты одного яруса (по числу живых
+// документов с шагом kMergeFactor) сливаются в фоновом потоке по kMergeFactor штук,
+// а сильно прореженный сегмент переписывается отдельно. Готовое слияние встаёт на
+// место источников при следующем изменении индекса, так что поиск никогда его не ждёт
+class InvertedIndex {
+public:
+    InvertedIndex();
+
+    // inv_word_count - величина 1 / (число слов документа), из которой набраны частоты
+    void AddDocument(int document_id, const TermFrequencies& term_freqs, double inv_word_count);
+
+    // Списки разных слов пакета пополняются независимо
+    template <typename Policy>
+    void AddDocuments(const Policy& policy, const PostingsBatch& batch);
+
+    // Возвращает слова, которые после удаления не встречаются ни в одном документе
+    std::vector<TermId> RemoveDocument(int document_id, const TermFrequencies& term_freqs);
+
+    // В скольких живых документах встречается слово
+    std::size_t GetDocumentFreq(TermId term) const;
+
+    std::size_t GetDocumentCount() const;
+
+    // IDF слова: берётся из таблицы, если с её обновления не менялись ни число документов,
+    // ни частота слова, иначе считается заново
+    double GetInverseDocumentFreq(TermId term) const;
+
+    // Пересчитывает таблицу IDF. Пакетные изменения индекса делают это сами, а после
+    // поштучных таблица устаревает до следующего пакета или запечатывания сегмента
+    void RefreshInverseDocumentFreqs();
+
+    // Сохраняет во всех сегментах квантованные вклады tf·idf для поиска QUANTIZED. Изменяемый
+    // сегмент теряет их при изменении, а запечатанные и слитые сегменты получают сразу,
+    // с IDF на момент запечатывания или слияния
+    void QuantizeImpacts();
+
+    bool IsQuantized() const;
+
+    // Вклад вхождения равен impact * GetImpactStep()
+    double GetImpactStep() const;
+
+    // Вызывает function(segment, postings) для непустых списков слова во всех сегментах.
+    // Вхождения удалённых документов остаются в списках: их отсеивает segment.IsDeleted
+    template <typename Function>
+    void ForEachPostings(TermId term, Function function) const;
+
+    // Индекс из одного сегмента без надгробий, у которого на слово ровно один список
+    bool IsCompact() const;
+
+    // Копия индекса, слитая в один сегмент
+    InvertedIndex Compact() const;
+
+    // Вызывает function(term, postings) по возрастанию номера слова; только для компактного индекса
+    template <typename Function>
+    void ForEachTerm(Function function) const;
+
+    // Добавляет готовый запечатанный сегмент, например прочитанный из снимка
+    void AddSegment(std::vector<std::pair<TermId, PostingList>> postings, const std::vector<int>& document_ids);
+
+    // Дожидается фонового слияния и сливает все сегменты в один
+    void MergeSegments();
+
+    const std::vector<double>& GetInvWordCounts() const;
+
+    void SetInvWordCounts(std::vector<double> inv_word_counts);
+
+    PostingCursor GetCursor(const PostingList& postings, int begin_id, int end_id) const;
+
+    // Дописывает в matches номера id из возрастающего массива document_ids, которые есть в списке.
+    // Блоки сжатого списка, между крайними id которых нет искомых, не распаковываются
+    void IntersectPostings(const PostingList& postings, const int* document_ids, std::size_t document_count,
+                           std::vector<std::size_t>& matches) const;
+
+    // Сжимает все списки; изменённые после этого списки хранятся несжатыми до следующего вызова,
+    // а запечатанные и слитые сегменты сжимаются сразу
+    void Compress();
+
+    IndexMemoryUsage GetMemoryUsage() const;
+
+private:
+    static constexpr std::size_t kMutableSegmentSize = 4096;
+    static constexpr std::size_t kMergeFactor = 4;
+
+    // Слияние, идущее в фоне: источники и их надгробия на момент запуска
+    struct PendingMerge {
+        std::vector<std::shared_ptr<const IndexSegment>> sources;
+        std::vector<std::vector<std::uint64_t>> deleted;
+        std::future<std::shared_ptr<IndexSegment>> merged;
+    };
+
+    // Запечатанные сегменты от старых к новым; последний сегмент - изменяемый
+    std::vector<std::shared_ptr<IndexSegment>> segments_;
+    std::vector<std::size_t> document_freqs_;
+    std::size_t document_count_ = 0;
+    // IDF по номеру слова для idf_document_count_ документов; -1 у слов, чья частота с тех пор менялась
+    std::vector<double> inverse_document_freqs_;
+    std::size_t idf_document_count_ = 0;
+    std::vector<double> inv_word_counts_;
+    bool is_compressed_ = false;
+    bool is_quantized_ = false;
+    double impact_step_ = 0.0;
+    std::optional<PendingMerge> pending_merge_;
+
+    IndexSegment& GetMutableSegment();
+
+    void IncreaseDocumentFreq(TermId term, std::size_t count);
+
+    void DecreaseDocumentFreq(TermId term);
+
+    std::vector<double> ComputeInverseDocumentFreqs() const;
+
+    void SetInvWordCount(int document_id, double inv_word_count);
+
+    // Ставит готовое слияние, запечатывает заполненный сегмент и запускает следующее слияние
+    void MaintainSegments();
+
+    void SealMutableSegment();
+
+    void ScheduleMerge();
+
+    void InstallMerge();
+
+    // Сегменты для следующего слияния или пустой вектор
+    std::vector<std::shared_ptr<IndexSegment>> PickMergeSources() const;
+};
+
+template <typename Policy>
+void InvertedIndex::AddDocuments(const Policy& policy, const PostingsBatch& batch) {
+    IndexSegment& segment = GetMutableSegment();
+    segment.ClearImpacts();
+    for (const auto& [document_id, inv_word_count] : batch.inv_word_counts) {
+        SetInvWordCount(document_id, inv_word_count);
+        segment.AddDocument(document_id);
+    }
+    document_count_ += batch.inv_word_counts.size();
+    // Списки заводятся заранее, чтобы параллельная часть не меняла сам сегмент
+    for (std::size_t i = 0; i < batch.terms.size(); ++i) {
+        segment.GetPostings(batch.terms[i]);
+        IncreaseDocumentFreq(batch.terms[i], batch.term_offsets[i + 1] - batch.term_offsets[i]);
+    }
+    std::vector<PostingList*> postings(batch.terms.size());
+    for (std::size_t i = 0; i < batch.terms.size(); ++i) {
+        postings[i] = &segment.GetPostings(batch.terms[i]);
+    }
+    std::vector<std::size_t> terms(batch.terms.size());
+    std::iota(terms.begin(), terms.end(), 0);
+    std::for_each(policy, terms.begin(), terms.end(), [&](std::size_t i) {
+        const std::size_t begin = batch.term_offsets[i];
+        postings[i]->Decompress(inv_word_counts_);
+        postings[i]->Merge(batch.document_ids.data() + begin, batch.term_freqs.data() + begin,
+                           batch.term_offsets[i + 1] - begin);
+    });
+    MaintainSegments();
+    RefreshInverseDocumentFreqs();
+}
+
+template <typename Function>
+void InvertedIndex::ForEachPostings(TermId term, Function function) const {
+    for (const auto& segment : segments_) {
+        if (const PostingList* postings = segment->Find(term)) {
+            function(*segment, *postings);
+        }
+    }
+}
+
+template <typename Function>
+void InvertedIndex::ForEachTerm(Function function) const {
+    for (const auto& segment : segments_) {
+        segment->ForEachTerm(function);
+    }
+}
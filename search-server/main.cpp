@@ -6,76 +6,75 @@
 #include "document.h"
 #include "log_duration.h"
 #include "remove_duplicates.h"
-#include "test_search_server.h"
+#include "benchmark_functions.h"
+#include "benchmark_suite.h"
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <stdexcept>
 #include <string>
 #include <vector>
-#include <execution>
-#include <random>
 
 using namespace std;
 
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution('a', 'z')(generator));
-    }
-    return word;
+namespace {
+
+atomic<uint64_t> allocation_count{0};
+
+const char* const kUsage = "Usage: search_server [--micro] | [--documents=N] [--dictionary=N] [--word-length=N]\n"
+                           "    [--document-words=N] [--queries=N] [--query-words=N] [--zipf=X] [--duplicates=X]\n"
+                           "    [--warmup=N] [--repetitions=N] [--seed=N] [--format=text|json]\n";
+
+void RunMicroBenchmarks() {
+    BenchmarkSplitIntoWords();
+    BenchmarkProcessQueries();
+    BenchmarkSharedScan();
+    BenchmarkQueryResultCache();
+    BenchmarkQuantizedScores();
+    BenchmarkStatusFilter();
+    BenchmarkMinusWords();
+    BenchmarkMatchDocuments();
+    BenchmarkShardedSearch();
+    BenchmarkFindDuplicates();
+    BenchmarkRequestStatistics();
+    BenchmarkQueryPhases();
 }
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
+
+}  // namespace
+
+// Выделения памяти считаются для отчёта о выделениях на операцию
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    if (void* pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
     }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
+    throw bad_alloc();
 }
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
 }
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
 }
-template <typename ExecutionPolicy>
-void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
-    LOG_DURATION(mark);
-    double total_relevance = 0;
-    for (const string_view query : queries) {
-        for (const auto& document : search_server.FindTopDocuments(policy, query)) {
-            total_relevance += document.relevance;
-        }
+
+int main(int argc, char* argv[]) {
+    const vector<string> arguments(argv + 1, argv + argc);
+    if (arguments == vector<string>{"--micro"s}) {
+        RunMicroBenchmarks();
+        return 0;
     }
-    cout << total_relevance << endl;
-}
-#define TEST(policy) Test(#policy, search_server, queries, execution::policy)
-int main() {
-    mt19937 generator;
-    const auto dictionary = GenerateDictionary(generator, 1000, 10);
-    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
-    SearchServer search_server(dictionary[0]);
-    for (size_t i = 0; i < documents.size(); ++i) {
-        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    BenchmarkConfig config;
+    try {
+        config = ParseBenchmarkConfig(arguments);
+    } catch (const invalid_argument& error) {
+        cerr << error.what() << endl << kUsage;
+        return 1;
     }
-    const auto queries = GenerateQueries(generator, dictionary, 100, 70);
-    TEST(seq);
-    TEST(par);
+    SetAllocationCounter(&allocation_count);
+    PrintBenchmarkResults(cout, config, RunBenchmarkSuite(config));
 }
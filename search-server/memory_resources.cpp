@@ -0,0 +1,192 @@
+#include "memory_resources.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::size_t kInitialQueryScratchSize = 16 * 1024;
+
+AllocationCounter& GetQueryScratchCounter() {
+    static AllocationCounter counter;
+    return counter;
+}
+
+std::atomic<std::size_t> query_scratch_reset_count{0};
+
+// Арена запросов одного потока
+class QueryScratch {
+public:
+    QueryScratch()
+            : upstream_(std::pmr::new_delete_resource(), GetQueryScratchCounter())
+            , overflow_(upstream_, overflow_bytes_) {
+        Rebuild(kInitialQueryScratchSize);
+    }
+
+    std::pmr::memory_resource* GetResource() {
+        return &*arena_;
+    }
+
+    void Enter() {
+        ++depth_;
+    }
+
+    void Leave() {
+        if (--depth_ > 0) {
+            return;
+        }
+        query_scratch_reset_count.fetch_add(1, std::memory_order_relaxed);
+        // Запрос не уместился в буфер: буфер растёт, чтобы следующие обходились без malloc
+        if (overflow_bytes_ > 0) {
+            Rebuild(buffer_size_ + overflow_bytes_);
+        } else {
+            arena_->release();
+        }
+    }
+
+private:
+    // Считает байты, взятые ареной сверх своего буфера
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        OverflowResource(std::pmr::memory_resource& upstream, std::size_t& bytes)
+                : upstream_(upstream)
+                , bytes_(bytes) {
+        }
+
+    private:
+        std::pmr::memory_resource& upstream_;
+        std::size_t& bytes_;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            void* p = upstream_.allocate(bytes, alignment);
+            bytes_ += bytes;
+            return p;
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            upstream_.deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    std::size_t depth_ = 0;
+    std::size_t overflow_bytes_ = 0;
+    CountingResource upstream_;
+    OverflowResource overflow_;
+    std::unique_ptr<std::byte[]> buffer_;
+    std::size_t buffer_size_ = 0;
+    std::optional<std::pmr::monotonic_buffer_resource> arena_;
+
+    void Rebuild(std::size_t buffer_size) {
+        arena_.reset();
+        overflow_bytes_ = 0;
+        buffer_.reset(new std::byte[buffer_size]);
+        buffer_size_ = buffer_size;
+        arena_.emplace(buffer_.get(), buffer_size_, &overflow_);
+    }
+};
+
+QueryScratch& GetThreadQueryScratchArena() {
+    thread_local QueryScratch scratch;
+    return scratch;
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& output, const AllocatorStats& stats) {
+    return output << "allocations: " << stats.allocation_count
+                  << ", deallocations: " << stats.deallocation_count
+                  << ", allocated: " << stats.allocated_bytes
+                  << " B, in use: " << stats.in_use_bytes
+                  << " B, peak: " << stats.peak_in_use_bytes << " B";
+}
+
+void AllocationCounter::OnAllocate(std::size_t bytes) {
+    allocation_count_.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    const std::size_t in_use = in_use_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    std::size_t peak = peak_in_use_bytes_.load(std::memory_order_relaxed);
+    while (peak < in_use && !peak_in_use_bytes_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+    }
+}
+
+void AllocationCounter::OnDeallocate(std::size_t bytes) {
+    deallocation_count_.fetch_add(1, std::memory_order_relaxed);
+    in_use_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+AllocatorStats AllocationCounter::GetStats() const {
+    AllocatorStats stats;
+    stats.allocation_count = allocation_count_.load(std::memory_order_relaxed);
+    stats.deallocation_count = deallocation_count_.load(std::memory_order_relaxed);
+    stats.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+    stats.in_use_bytes = in_use_bytes_.load(std::memory_order_relaxed);
+    stats.peak_in_use_bytes = peak_in_use_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+CountingResource::CountingResource(std::pmr::memory_resource* upstream, AllocationCounter& counter)
+        : upstream_(upstream)
+        , counter_(counter) {
+}
+
+void* CountingResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    void* p = upstream_->allocate(bytes, alignment);
+    counter_.OnAllocate(bytes);
+    return p;
+}
+
+void CountingResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+    upstream_->deallocate(p, bytes, alignment);
+    counter_.OnDeallocate(bytes);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+std::ostream& operator<<(std::ostream& output, const IndexAllocatorStats& stats) {
+    // Доля памяти пула, не занятая контейнерами: свободные блоки и незанятые хвосты кусков
+    const double fragmentation = stats.upstream.in_use_bytes == 0
+            ? 0.0
+            : 1.0 - static_cast<double>(std::min(stats.requested.in_use_bytes, stats.upstream.in_use_bytes))
+                    / stats.upstream.in_use_bytes;
+    return output << "requested: {" << stats.requested << "}, upstream: {" << stats.upstream
+                  << "}, fragmentation: " << fragmentation;
+}
+
+IndexMemory::IndexMemory()
+        : upstream_(std::pmr::new_delete_resource(), upstream_counter_)
+        , pool_(&upstream_)
+        , resource_(&pool_, requested_counter_) {
+}
+
+std::pmr::memory_resource* IndexMemory::GetResource() {
+    return &resource_;
+}
+
+IndexAllocatorStats IndexMemory::GetStats() const {
+    return {requested_counter_.GetStats(), upstream_counter_.GetStats()};
+}
+
+std::ostream& operator<<(std::ostream& output, const QueryScratchStats& stats) {
+    return output << "resets: " << stats.reset_count << ", upstream: {" << stats.upstream << "}";
+}
+
+std::pmr::memory_resource* GetThreadQueryScratch() {
+    return GetThreadQueryScratchArena().GetResource();
+}
+
+QueryScratchScope::QueryScratchScope() {
+    GetThreadQueryScratchArena().Enter();
+}
+
+QueryScratchScope::~QueryScratchScope() {
+    GetThreadQueryScratchArena().Leave();
+}
+
+QueryScratchStats GetQueryScratchStats() {
+    return {query_scratch_reset_count.load(std::memory_order_relaxed), GetQueryScratchCounter().GetStats()};
+}
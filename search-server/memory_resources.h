@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+
+// Счётчики выделений одного ресурса памяти
+struct AllocatorStats {
+    std::size_t allocation_count = 0;
+    std::size_t deallocation_count = 0;
+    std::size_t allocated_bytes = 0;
+    std::size_t in_use_bytes = 0;
+    std::size_t peak_in_use_bytes = 0;
+};
+
+std::ostream& operator<<(std::ostream& output, const AllocatorStats& stats);
+
+// Потокобезопасные счётчики, которые могут разделять несколько ресурсов
+class AllocationCounter {
+public:
+    void OnAllocate(std::size_t bytes);
+
+    void OnDeallocate(std::size_t bytes);
+
+    AllocatorStats GetStats() const;
+
+private:
+    std::atomic<std::size_t> allocation_count_{0};
+    std::atomic<std::size_t> deallocation_count_{0};
+    std::atomic<std::size_t> allocated_bytes_{0};
+    std::atomic<std::size_t> in_use_bytes_{0};
+    std::atomic<std::size_t> peak_in_use_bytes_{0};
+};
+
+// Передаёт запросы вышестоящему ресурсу и считает их
+class CountingResource : public std::pmr::memory_resource {
+public:
+    CountingResource(std::pmr::memory_resource* upstream, AllocationCounter& counter);
+
+private:
+    std::pmr::memory_resource* upstream_;
+    AllocationCounter& counter_;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+// Память индекса: запросы контейнеров и обращения пула к malloc
+struct IndexAllocatorStats {
+    AllocatorStats requested;
+    AllocatorStats upstream;
+};
+
+std::ostream& operator<<(std::ostream& output, const IndexAllocatorStats& stats);
+
+// Пул блоков для узлов и небольших массивов индекса. Освобождённые блоки остаются
+// в пуле и достаются следующим документам, а к malloc пул обращается целыми кусками.
+// Пул не потокобезопасен, как и изменение индекса
+class IndexMemory {
+public:
+    IndexMemory();
+
+    IndexMemory(const IndexMemory&) = delete;
+    IndexMemory& operator=(const IndexMemory&) = delete;
+
+    std::pmr::memory_resource* GetResource();
+
+    IndexAllocatorStats GetStats() const;
+
+private:
+    AllocationCounter requested_counter_;
+    AllocationCounter upstream_counter_;
+    CountingResource upstream_;
+    std::pmr::unsynchronized_pool_resource pool_;
+    CountingResource resource_;
+};
+
+// Временная память запросов по всем потокам
+struct QueryScratchStats {
+    // Сколько раз арены сбрасывались по закрытию внешней области
+    std::size_t reset_count = 0;
+    // Выделения сверх буферов арен; после прогрева их почти нет
+    AllocatorStats upstream;
+};
+
+std::ostream& operator<<(std::ostream& output, const QueryScratchStats& stats);
+
+// Монотонная арена текущего потока для временных массивов запроса. Память из неё
+// не освобождается по одной, а возвращается разом, когда закрывается внешняя
+// QueryScratchScope потока; после этого все выделенные из арены объекты недействительны
+std::pmr::memory_resource* GetThreadQueryScratch();
+
+// Область, внутри которой живут объекты из арены потока. Области вкладываются:
+// например, поток, ждущий параллельный алгоритм, может выполнить чужую задачу
+// с запросом, и арена сбросится только по выходу из самой внешней
+class QueryScratchScope {
+public:
+    QueryScratchScope();
+
+    QueryScratchScope(const QueryScratchScope&) = delete;
+    QueryScratchScope& operator=(const QueryScratchScope&) = delete;
+
+    ~QueryScratchScope();
+};
+
+QueryScratchStats GetQueryScratchStats();
@@ -0,0 +1,347 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include "bit_packing.h"
+
+PostingList::PostingList(const Data& external_data, double max_term_freq)
+        : max_term_freq_(max_term_freq)
+        , is_external_(true)
+        , external_data_(external_data) {
+}
+
+void PostingList::Add(int document_id, double term_freq) {
+    Detach();
+    // Документы обычно добавляются с растущими id, тогда достаточно дописать в конец
+    if (document_ids_.empty() || document_ids_.back() < document_id) {
+        document_ids_.push_back(document_id);
+        term_freqs_.push_back(term_freq);
+        max_term_freq_ = std::max(max_term_freq_, term_freq);
+        return;
+    }
+    // Иначе вливаем вхождение в отсортированные массивы на своё место
+    const auto it = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    const auto pos = std::distance(document_ids_.begin(), it);
+    if (it != document_ids_.end() && *it == document_id) {
+        term_freqs_[pos] += term_freq;
+        max_term_freq_ = std::max(max_term_freq_, term_freqs_[pos]);
+        return;
+    }
+    document_ids_.insert(it, document_id);
+    term_freqs_.insert(std::next(term_freqs_.begin(), pos), term_freq);
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+}
+
+void PostingList::Merge(const int* document_ids, const double* term_freqs, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    Detach();
+    if (document_ids_.empty() || document_ids_.back() < document_ids[0]) {
+        document_ids_.insert(document_ids_.end(), document_ids, document_ids + count);
+        term_freqs_.insert(term_freqs_.end(), term_freqs, term_freqs + count);
+        max_term_freq_ = std::max(max_term_freq_, *std::max_element(term_freqs, term_freqs + count));
+        return;
+    }
+    std::vector<int> merged_document_ids;
+    std::vector<double> merged_term_freqs;
+    merged_document_ids.reserve(document_ids_.size() + count);
+    merged_term_freqs.reserve(document_ids_.size() + count);
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < document_ids_.size() || j < count) {
+        if (j == count || (i < document_ids_.size() && document_ids_[i] < document_ids[j])) {
+            merged_document_ids.push_back(document_ids_[i]);
+            merged_term_freqs.push_back(term_freqs_[i++]);
+        } else if (i == document_ids_.size() || document_ids[j] < document_ids_[i]) {
+            merged_document_ids.push_back(document_ids[j]);
+            merged_term_freqs.push_back(term_freqs[j++]);
+        } else {
+            merged_document_ids.push_back(document_ids[j]);
+            merged_term_freqs.push_back(term_freqs_[i++] + term_freqs[j++]);
+        }
+        max_term_freq_ = std::max(max_term_freq_, merged_term_freqs.back());
+    }
+    document_ids_ = std::move(merged_document_ids);
+    term_freqs_ = std::move(merged_term_freqs);
+}
+
+void PostingList::Remove(int document_id) {
+    Detach();
+    const auto it = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    if (it == document_ids_.end() || *it != document_id) {
+        return;
+    }
+    const auto pos = std::distance(document_ids_.begin(), it);
+    const double term_freq = term_freqs_[pos];
+    document_ids_.erase(it);
+    term_freqs_.erase(std::next(term_freqs_.begin(), pos));
+    if (term_freq == max_term_freq_) {
+        max_term_freq_ = term_freqs_.empty() ? 0.0 : *std::max_element(term_freqs_.begin(), term_freqs_.end());
+    }
+}
+
+std::size_t PostingList::size() const {
+    return GetData().size;
+}
+
+bool PostingList::empty() const {
+    return size() == 0;
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+bool PostingList::IsCompressed() const {
+    return GetData().block_count > 0;
+}
+
+namespace {
+
+// Частота слова, встретившегося count раз, посчитанная так же, как в AddDocument
+double CountToTermFreq(std::uint32_t count, double inv_word_count) {
+    double term_freq = 0.0;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        term_freq += inv_word_count;
+    }
+    return term_freq;
+}
+
+}  // namespace
+
+void PostingList::Compress(const std::vector<double>& inv_word_counts) {
+    if (IsCompressed() || empty()) {
+        return;
+    }
+    Detach();
+    std::vector<std::uint32_t> counts(document_ids_.size());
+    for (std::size_t i = 0; i < document_ids_.size(); ++i) {
+        const double inv_word_count = inv_word_counts[document_ids_[i]];
+        counts[i] = static_cast<std::uint32_t>(std::llround(term_freqs_[i] / inv_word_count));
+        if (counts[i] == 0 || CountToTermFreq(counts[i], inv_word_count) != term_freqs_[i]) {
+            return;
+        }
+    }
+
+    std::vector<BlockInfo> blocks;
+    std::vector<std::uint32_t> data;
+    std::uint32_t values[kBlockSize];
+    for (std::size_t begin = 0; begin < document_ids_.size(); begin += kBlockSize) {
+        const std::size_t block_size = std::min(kBlockSize, document_ids_.size() - begin);
+        BlockInfo block{document_ids_[begin], document_ids_[begin + block_size - 1],
+                        static_cast<std::uint32_t>(data.size()), static_cast<std::uint16_t>(block_size), 0, 0};
+
+        std::uint32_t max_value = 0;
+        for (std::size_t i = 0; i < block_size; ++i) {
+            values[i] = static_cast<std::uint32_t>(document_ids_[begin + i] - block.first_document_id);
+            if (i > 0) {
+                values[i] -= static_cast<std::uint32_t>(document_ids_[begin + i - 1] - block.first_document_id);
+            }
+            max_value = std::max(max_value, values[i]);
+        }
+        block.id_bit_width = static_cast<std::uint8_t>(GetBitWidth(max_value));
+        PackBits(values, block_size, block.id_bit_width, data);
+
+        max_value = 0;
+        for (std::size_t i = 0; i < block_size; ++i) {
+            values[i] = counts[begin + i] - 1;
+            max_value = std::max(max_value, values[i]);
+        }
+        block.count_bit_width = static_cast<std::uint8_t>(GetBitWidth(max_value));
+        PackBits(values, block_size, block.count_bit_width, data);
+
+        blocks.push_back(block);
+    }
+
+    compressed_size_ = document_ids_.size();
+    blocks_ = std::move(blocks);
+    compressed_data_ = std::move(data);
+    compressed_data_.shrink_to_fit();
+    document_ids_ = std::vector<int>{};
+    term_freqs_ = std::vector<double>{};
+}
+
+void PostingList::Decompress(const std::vector<double>& inv_word_counts) {
+    if (!IsCompressed()) {
+        return;
+    }
+    const Data data = GetData();
+    std::vector<int> document_ids(data.size);
+    std::vector<double> term_freqs(data.size);
+    std::size_t pos = 0;
+    for (std::size_t block = 0; block < data.block_count; ++block) {
+        DecodeBlock(data, block, inv_word_counts, document_ids.data() + pos, term_freqs.data() + pos);
+        pos += data.blocks[block].size;
+    }
+    document_ids_ = std::move(document_ids);
+    term_freqs_ = std::move(term_freqs);
+    compressed_size_ = 0;
+    blocks_ = std::vector<BlockInfo>{};
+    compressed_data_ = std::vector<std::uint32_t>{};
+    is_external_ = false;
+    external_data_ = Data{};
+}
+
+PostingList::Data PostingList::GetData() const {
+    if (is_external_) {
+        return external_data_;
+    }
+    if (!blocks_.empty()) {
+        return {compressed_size_, nullptr, nullptr, blocks_.size(), blocks_.data(),
+                compressed_data_.size(), compressed_data_.data()};
+    }
+    return {document_ids_.size(), document_ids_.data(), term_freqs_.data(), 0, nullptr, 0, nullptr};
+}
+
+std::size_t PostingList::GetMemoryUsage() const {
+    // Внешние массивы тоже считаются: они занимают память процесса, хоть и не кучу
+    const Data data = GetData();
+    if (is_external_) {
+        return sizeof(PostingList)
+               + (data.block_count > 0 ? 0 : data.size) * (sizeof(int) + sizeof(double))
+               + data.block_count * sizeof(BlockInfo)
+               + data.compressed_data_size * sizeof(std::uint32_t);
+    }
+    return sizeof(PostingList)
+           + document_ids_.capacity() * sizeof(int)
+           + term_freqs_.capacity() * sizeof(double)
+           + blocks_.capacity() * sizeof(BlockInfo)
+           + compressed_data_.capacity() * sizeof(std::uint32_t);
+}
+
+void PostingList::DecodeBlock(const Data& data, std::size_t block, const std::vector<double>& inv_word_counts,
+                              int* document_ids, double* term_freqs) {
+    const BlockInfo& info = data.blocks[block];
+    std::uint32_t values[kBlockSize];
+    const std::uint32_t* packed = data.compressed_data + info.offset;
+
+    packed = UnpackBits(packed, info.size, info.id_bit_width, values);
+    int document_id = info.first_document_id;
+    for (std::size_t i = 0; i < info.size; ++i) {
+        document_id += static_cast<int>(values[i]);
+        document_ids[i] = document_id;
+    }
+
+    UnpackBits(packed, info.size, info.count_bit_width, values);
+    for (std::size_t i = 0; i < info.size; ++i) {
+        term_freqs[i] = CountToTermFreq(values[i] + 1, inv_word_counts[document_ids[i]]);
+    }
+}
+
+void PostingList::Detach() {
+    if (!is_external_) {
+        return;
+    }
+    const Data data = external_data_;
+    if (data.block_count > 0) {
+        compressed_size_ = data.size;
+        blocks_.assign(data.blocks, data.blocks + data.block_count);
+        compressed_data_.assign(data.compressed_data, data.compressed_data + data.compressed_data_size);
+    } else {
+        document_ids_.assign(data.document_ids, data.document_ids + data.size);
+        term_freqs_.assign(data.term_freqs, data.term_freqs + data.size);
+    }
+    is_external_ = false;
+    external_data_ = Data{};
+}
+
+PostingCursor::PostingCursor(const PostingList& postings, const std::vector<double>& inv_word_counts,
+                             int begin_id, int end_id)
+        : data_(postings.GetData())
+        , inv_word_counts_(&inv_word_counts)
+        , end_id_(end_id) {
+    if (data_.block_count == 0) {
+        const int* document_ids_end = data_.document_ids + data_.size;
+        document_ids_ = data_.document_ids;
+        term_freqs_ = data_.term_freqs;
+        pos_ = std::lower_bound(document_ids_, document_ids_end, begin_id) - document_ids_;
+        end_ = std::lower_bound(document_ids_ + pos_, document_ids_end, end_id) - document_ids_;
+        return;
+    }
+    const PostingList::BlockInfo* blocks_end = data_.blocks + data_.block_count;
+    const auto block = std::partition_point(data_.blocks, blocks_end, [begin_id](const auto& info) {
+        return info.last_document_id < begin_id;
+    });
+    next_block_ = data_.block_count;
+    if (block != blocks_end) {
+        LoadBlock(block - data_.blocks);
+        SeekInWindow(begin_id);
+    }
+}
+
+PostingCursor::PostingCursor(const PostingCursor& other) {
+    *this = other;
+}
+
+PostingCursor& PostingCursor::operator=(const PostingCursor& other) {
+    if (this == &other) {
+        return *this;
+    }
+    data_ = other.data_;
+    inv_word_counts_ = other.inv_word_counts_;
+    end_id_ = other.end_id_;
+    pos_ = other.pos_;
+    end_ = other.end_;
+    next_block_ = other.next_block_;
+    block_begin_ = other.block_begin_;
+    if (other.document_ids_ == other.block_document_ids_) {
+        std::copy(other.block_document_ids_, other.block_document_ids_ + end_, block_document_ids_);
+        std::copy(other.block_term_freqs_, other.block_term_freqs_ + end_, block_term_freqs_);
+        document_ids_ = block_document_ids_;
+        term_freqs_ = block_term_freqs_;
+    } else {
+        document_ids_ = other.document_ids_;
+        term_freqs_ = other.term_freqs_;
+    }
+    return *this;
+}
+
+void PostingCursor::Seek(int document_id) {
+    if (IsEnd() || DocumentId() >= document_id) {
+        return;
+    }
+    // Блоки, где все id меньше искомого, пропускаем по их последнему id
+    if (data_.block_count > 0 && document_ids_[end_ - 1] < document_id) {
+        const PostingList::BlockInfo* blocks_end = data_.blocks + data_.block_count;
+        const auto block = std::partition_point(data_.blocks + next_block_, blocks_end,
+                                                [document_id](const auto& info) {
+            return info.last_document_id < document_id;
+        });
+        if (block == blocks_end) {
+            pos_ = end_;
+            next_block_ = data_.block_count;
+            return;
+        }
+        LoadBlock(block - data_.blocks);
+    }
+    SeekInWindow(document_id);
+}
+
+void PostingCursor::LoadBlock(std::size_t block) {
+    const auto& info = data_.blocks[block];
+    PostingList::DecodeBlock(data_, block, *inv_word_counts_, block_document_ids_, block_term_freqs_);
+    document_ids_ = block_document_ids_;
+    term_freqs_ = block_term_freqs_;
+    pos_ = 0;
+    end_ = info.size;
+    next_block_ = block + 1;
+    block_begin_ = block * PostingList::kBlockSize;
+    if (info.last_document_id >= end_id_) {
+        end_ = std::lower_bound(block_document_ids_, block_document_ids_ + end_, end_id_) - block_document_ids_;
+        next_block_ = data_.block_count;
+    }
+}
+
+void PostingCursor::SeekInWindow(int document_id) {
+    // Галопом находим отрезок с нужным id, затем ищем в нём двоичным поиском
+    std::size_t step = 1;
+    std::size_t low = pos_;
+    while (pos_ + step < end_ && document_ids_[pos_ + step] < document_id) {
+        low = pos_ + step;
+        step *= 2;
+    }
+    const std::size_t high = std::min(pos_ + step + 1, end_);
+    pos_ = std::lower_bound(document_ids_ + low, document_ids_ + high, document_id) - document_ids_;
+}
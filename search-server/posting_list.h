@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Список вхождений слова: id документов по возрастанию и частоты слова в них.
+// Id и частоты лежат в отдельных непрерывных массивах, чтобы обход при поиске
+// шёл по памяти подряд, а не по узлам дерева.
+//
+// Список можно сжать: id хранятся разностями, а частота - числом вхождений
+// слова в документ, и то и другое упаковано блоками по kBlockSize с общей
+// шириной в битах. Для каждого блока хранятся его крайние id, по которым
+// курсор перескакивает блоки, не распаковывая их. Частота восстанавливается
+// тем же сложением 1 / (число слов документа), что и при индексации, поэтому
+// совпадает с исходной бит в бит. Изменение сжатого списка сначала его распаковывает.
+//
+// Массивы списка могут лежать во внешней памяти, например в отображённом файле
+// снимка; в собственные они копируются только при изменении списка
+class PostingList {
+public:
+    static constexpr std::size_t kBlockSize = 128;
+
+    struct BlockInfo {
+        int first_document_id;
+        int last_document_id;
+        std::uint32_t offset;
+        std::uint16_t size;
+        std::uint8_t id_bit_width;
+        std::uint8_t count_bit_width;
+    };
+
+    // Массивы списка: у несжатого заполнены document_ids и term_freqs, у сжатого - блоки
+    struct Data {
+        std::size_t size = 0;
+        const int* document_ids = nullptr;
+        const double* term_freqs = nullptr;
+        std::size_t block_count = 0;
+        const BlockInfo* blocks = nullptr;
+        std::size_t compressed_data_size = 0;
+        const std::uint32_t* compressed_data = nullptr;
+    };
+
+    PostingList() = default;
+
+    // Список поверх чужих массивов, которые должны жить дольше него
+    PostingList(const Data& external_data, double max_term_freq);
+
+    // Изменять можно только несжатый список
+    void Add(int document_id, double term_freq);
+
+    // Вливает вхождения, упорядоченные по id; быстрее поштучного Add для пакета документов
+    void Merge(const int* document_ids, const double* term_freqs, std::size_t count);
+
+    void Remove(int document_id);
+
+    std::size_t size() const;
+
+    bool empty() const;
+
+    // Наибольшая частота слова в документах списка, верхняя граница его вклада
+    double GetMaxTermFreq() const;
+
+    bool IsCompressed() const;
+
+    // Сжимает список, если частоты точно выражаются числом вхождений;
+    // inv_word_counts - величина 1 / (число слов) для каждого id документа
+    void Compress(const std::vector<double>& inv_word_counts);
+
+    void Decompress(const std::vector<double>& inv_word_counts);
+
+    Data GetData() const;
+
+    std::size_t GetMemoryUsage() const;
+
+    static void DecodeBlock(const Data& data, std::size_t block, const std::vector<double>& inv_word_counts,
+                            int* document_ids, double* term_freqs);
+
+private:
+    std::vector<int> document_ids_;
+    std::vector<double> term_freqs_;
+    double max_term_freq_ = 0.0;
+
+    std::size_t compressed_size_ = 0;
+    std::vector<BlockInfo> blocks_;
+    std::vector<std::uint32_t> compressed_data_;
+
+    bool is_external_ = false;
+    Data external_data_;
+
+    // Переносит внешние массивы в собственные перед изменением списка
+    void Detach();
+};
+
+// Курсор по вхождениям списка с id документов из [begin_id, end_id).
+// У несжатого списка идёт прямо по его массивам, сжатый распаковывает по блоку
+class PostingCursor {
+public:
+    PostingCursor(const PostingList& postings, const std::vector<double>& inv_word_counts,
+                  int begin_id, int end_id);
+
+    // Распакованный блок лежит внутри курсора, поэтому копия перенаправляется на свой буфер
+    PostingCursor(const PostingCursor& other);
+
+    PostingCursor& operator=(const PostingCursor& other);
+
+    bool IsEnd() const {
+        return pos_ == end_;
+    }
+
+    int DocumentId() const {
+        return document_ids_[pos_];
+    }
+
+    double TermFreq() const {
+        return term_freqs_[pos_];
+    }
+
+    // Номер текущего вхождения от начала списка
+    std::size_t Position() const {
+        return block_begin_ + pos_;
+    }
+
+    void Next() {
+        if (++pos_ == end_ && next_block_ < data_.block_count) {
+            LoadBlock(next_block_);
+        }
+    }
+
+    // Переходит к первому вхождению с id не меньше document_id
+    void Seek(int document_id);
+
+private:
+    PostingList::Data data_;
+    const std::vector<double>* inv_word_counts_;
+    int end_id_;
+    const int* document_ids_ = nullptr;
+    const double* term_freqs_ = nullptr;
+    std::size_t pos_ = 0;
+    std::size_t end_ = 0;
+    std::size_t next_block_ = 0;
+    // Номер первого вхождения распакованного блока; блоки, кроме последнего, полные
+    std::size_t block_begin_ = 0;
+    int block_document_ids_[PostingList::kBlockSize];
+    double block_term_freqs_[PostingList::kBlockSize];
+
+    void LoadBlock(std::size_t block);
+
+    void SeekInWindow(int document_id);
+};
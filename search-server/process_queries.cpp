@@ -0,0 +1,51 @@
+#include "process_queries.h"
+
+#include <numeric>
+#include <utility>
+#include "work_stealing_pool.h"
+
+namespace {
+
+WorkStealingPool& GetQueryPool() {
+    static WorkStealingPool pool;
+    return pool;
+}
+
+}  // namespace
+
+JoinedDocuments::JoinedDocuments(std::vector<std::vector<Document>> documents)
+        : documents_(std::move(documents))
+        , size_(std::accumulate(documents_.begin(), documents_.end(), std::size_t{0},
+                                [](std::size_t size, const std::vector<Document>& query_documents) {
+                                    return size + query_documents.size();
+                                })) {
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() const {
+    return Iterator(documents_.begin(), documents_.end());
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() const {
+    return Iterator(documents_.end(), documents_.end());
+}
+
+std::size_t JoinedDocuments::size() const {
+    return size_;
+}
+
+bool JoinedDocuments::empty() const {
+    return size_ == 0;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
+                                                  const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> documents(queries.size());
+    GetQueryPool().ParallelFor(queries.size(), [&](std::size_t i) {
+        documents[i] = search_server.FindTopDocuments(std::execution::seq, queries[i]);
+    });
+    return documents;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    return JoinedDocuments(ProcessQueries(search_server, queries));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Результаты пачки запросов одним плоским диапазоном: обход идёт прямо по
+// результатам отдельных запросов, без копирования в общий контейнер
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator() = default;
+
+        reference operator*() const {
+            return (*query_)[position_];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        Iterator& operator++() {
+            if (++position_ == query_->size()) {
+                position_ = 0;
+                ++query_;
+                SkipEmpty();
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return query_ == other.query_ && position_ == other.position_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class JoinedDocuments;
+
+        using QueryIterator = std::vector<std::vector<Document>>::const_iterator;
+
+        Iterator(QueryIterator query, QueryIterator end)
+                : query_(query)
+                , end_(end) {
+            SkipEmpty();
+        }
+
+        void SkipEmpty() {
+            while (query_ != end_ && query_->empty()) {
+                ++query_;
+            }
+        }
+
+        QueryIterator query_;
+        QueryIterator end_;
+        std::size_t position_ = 0;
+    };
+
+    explicit JoinedDocuments(std::vector<std::vector<Document>> documents);
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+    std::size_t size() const;
+
+    bool empty() const;
+
+private:
+    std::vector<std::vector<Document>> documents_;
+    std::size_t size_ = 0;
+};
+
+// Выполняет запросы параллельно на общем пуле потоков с кражей работы; i-й результат
+// отвечает i-му запросу. Каждый запрос идёт последовательно в одном потоке пула и
+// пользуется его рабочей ареной, которая сохраняется между вызовами
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
+                                                  const std::vector<std::string>& queries);
+
+// То же, но результаты всех запросов идут подряд в порядке запросов
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
@@ -0,0 +1,186 @@
+#include "query_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+using PhaseHistograms = std::array<LatencyHistogram, kQueryPhaseCount>;
+
+// Гистограммы живых потоков и сумма гистограмм завершившихся. Реестр не разрушается,
+// потому что потоки пулов могут завершаться уже после статических объектов
+class PhaseHistogramRegistry {
+public:
+    static PhaseHistogramRegistry& Get() {
+        static PhaseHistogramRegistry* registry = new PhaseHistogramRegistry;
+        return *registry;
+    }
+
+    void Register(const PhaseHistograms* histograms) {
+        std::lock_guard guard(mutex_);
+        live_histograms_.push_back(histograms);
+    }
+
+    void Unregister(const PhaseHistograms* histograms) {
+        std::lock_guard guard(mutex_);
+        for (std::size_t phase = 0; phase < kQueryPhaseCount; ++phase) {
+            retired_histograms_[phase].Merge((*histograms)[phase]);
+        }
+        live_histograms_.erase(std::find(live_histograms_.begin(), live_histograms_.end(), histograms));
+    }
+
+    std::unique_ptr<PhaseHistograms> Collect() {
+        std::lock_guard guard(mutex_);
+        auto result = std::make_unique<PhaseHistograms>();
+        for (std::size_t phase = 0; phase < kQueryPhaseCount; ++phase) {
+            (*result)[phase].Merge(retired_histograms_[phase]);
+            for (const PhaseHistograms* histograms : live_histograms_) {
+                (*result)[phase].Merge((*histograms)[phase]);
+            }
+        }
+        return result;
+    }
+
+    void Reset() {
+        std::lock_guard guard(mutex_);
+        for (std::size_t phase = 0; phase < kQueryPhaseCount; ++phase) {
+            retired_histograms_[phase].Reset();
+            for (const PhaseHistograms* histograms : live_histograms_) {
+                // Обнуление чужих счётчиков - такая же запись без сложения, как у владельца
+                const_cast<LatencyHistogram&>((*histograms)[phase]).Reset();
+            }
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<const PhaseHistograms*> live_histograms_;
+    PhaseHistograms retired_histograms_;
+};
+
+// Гистограммы потока лежат в куче: в thread_local они занимали бы место в каждом потоке,
+// даже не выполняющем запросов
+class ThreadPhaseHistograms {
+public:
+    ThreadPhaseHistograms()
+            : histograms_(std::make_unique<PhaseHistograms>()) {
+        PhaseHistogramRegistry::Get().Register(histograms_.get());
+    }
+
+    ~ThreadPhaseHistograms() {
+        PhaseHistogramRegistry::Get().Unregister(histograms_.get());
+    }
+
+    LatencyHistogram& operator[](QueryPhase phase) {
+        return (*histograms_)[static_cast<std::size_t>(phase)];
+    }
+
+private:
+    std::unique_ptr<PhaseHistograms> histograms_;
+};
+
+const char* GetPhaseName(QueryPhase phase) {
+    switch (phase) {
+        case QueryPhase::PARSE:
+            return "parse";
+        case QueryPhase::POSTING_SCAN:
+            return "posting scan";
+        case QueryPhase::SCORING:
+            return "scoring";
+        case QueryPhase::TOP_K:
+            return "top-k";
+        case QueryPhase::RESULT_BUILD:
+            return "result build";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (std::size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+        const std::uint64_t count = other.counts_[bucket].load(std::memory_order_relaxed);
+        if (count != 0) {
+            counts_[bucket].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    count_.fetch_add(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    max_.store(std::max(max_.load(std::memory_order_relaxed), other.max_.load(std::memory_order_relaxed)),
+               std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::GetMax() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::GetValueAtQuantile(double quantile) const {
+    const std::uint64_t total_count = GetCount();
+    if (total_count == 0) {
+        return 0;
+    }
+    const auto rank = std::max<std::uint64_t>(
+            1, static_cast<std::uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * total_count)));
+    std::uint64_t count = 0;
+    for (std::size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+        count += counts_[bucket].load(std::memory_order_relaxed);
+        if (count >= rank) {
+            // Граница корзины не больше наибольшего записанного значения
+            return std::min(GetBucketUpperBound(bucket), GetMax());
+        }
+    }
+    return GetMax();
+}
+
+std::uint64_t LatencyHistogram::GetBucketUpperBound(std::size_t bucket) {
+    if (bucket < kSubBucketCount) {
+        return bucket;
+    }
+    const int exponent = static_cast<int>(bucket / kSubBucketCount) - 1 + kSubBucketBits;
+    const std::uint64_t sub_bucket = bucket % kSubBucketCount + kSubBucketCount;
+    const int shift = exponent - kSubBucketBits;
+    return (sub_bucket << shift) + ((std::uint64_t{1} << shift) - 1);
+}
+
+std::ostream& operator<<(std::ostream& output, const QueryPhaseStats& stats) {
+    return output << GetPhaseName(stats.phase) << ": count " << stats.count << ", p50 " << stats.p50.count()
+                  << " ns, p99 " << stats.p99.count() << " ns, p999 " << stats.p999.count() << " ns, max "
+                  << stats.max.count() << " ns";
+}
+
+void RecordQueryPhase(QueryPhase phase, std::chrono::nanoseconds duration) {
+    thread_local ThreadPhaseHistograms histograms;
+    histograms[phase].Record(static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(duration.count(), 0)));
+}
+
+std::vector<QueryPhaseStats> GetQueryPhaseStats() {
+    // Гистограммы большие, поэтому сумма собирается в куче, а не на стеке
+    const std::unique_ptr<PhaseHistograms> histograms = PhaseHistogramRegistry::Get().Collect();
+    std::vector<QueryPhaseStats> result;
+    for (std::size_t phase = 0; phase < kQueryPhaseCount; ++phase) {
+        const LatencyHistogram& histogram = (*histograms)[phase];
+        result.push_back({static_cast<QueryPhase>(phase), histogram.GetCount(),
+                          std::chrono::nanoseconds(histogram.GetValueAtQuantile(0.5)),
+                          std::chrono::nanoseconds(histogram.GetValueAtQuantile(0.99)),
+                          std::chrono::nanoseconds(histogram.GetValueAtQuantile(0.999)),
+                          std::chrono::nanoseconds(histogram.GetMax())});
+    }
+    return result;
+}
+
+void ResetQueryPhaseStats() {
+    PhaseHistogramRegistry::Get().Reset();
+}
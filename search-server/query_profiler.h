@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "log_duration.h"
+
+// Замер этапов запроса включается при сборке с -DSEARCH_SERVER_PROFILE. Без него
+// PROFILE_QUERY_PHASE ничего не делает, а MeasureQueryPhase просто вызывает функцию
+#ifdef SEARCH_SERVER_PROFILE
+inline constexpr bool kQueryProfilingEnabled = true;
+#define PROFILE_QUERY_PHASE(phase) QueryPhaseTimer UNIQUE_VAR_NAME_PROFILE(phase)
+#else
+inline constexpr bool kQueryProfilingEnabled = false;
+#define PROFILE_QUERY_PHASE(phase)
+#endif
+
+// Этапы выполнения запроса. Гистограмма считает замеры, а не запросы: этап может быть
+// замерен за запрос несколько раз, например в каждой части параллельного запроса
+enum class QueryPhase {
+    // Разбор строки запроса
+    PARSE,
+    // Поиск списков вхождений слов и исключение документов по минус-словам, обязательным словам и статусу
+    POSTING_SCAN,
+    // Подсчёт релевантности; в WAND вместе с отбором лучших документов
+    SCORING,
+    // Отбор лучших документов
+    TOP_K,
+    // Сборка вектора результатов
+    RESULT_BUILD,
+};
+
+inline constexpr std::size_t kQueryPhaseCount = 5;
+
+// Гистограмма длительностей в наносекундах в духе HDR Histogram: каждая октава делится
+// на 32 равные корзины, так что значение восстанавливается с точностью до 1/32.
+// Писать в неё может один поток; читать и сливать её можно одновременно с записью
+class LatencyHistogram {
+public:
+    void Record(std::uint64_t nanoseconds) {
+        Increment(counts_[GetBucket(nanoseconds)]);
+        Increment(count_);
+        if (nanoseconds > max_.load(std::memory_order_relaxed)) {
+            max_.store(nanoseconds, std::memory_order_relaxed);
+        }
+    }
+
+    void Merge(const LatencyHistogram& other);
+
+    void Reset();
+
+    std::uint64_t GetCount() const;
+
+    std::uint64_t GetMax() const;
+
+    // Верхняя граница корзины, в которую попадает доля quantile записанных значений
+    std::uint64_t GetValueAtQuantile(double quantile) const;
+
+private:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr std::size_t kSubBucketCount = std::size_t{1} << kSubBucketBits;
+    static constexpr std::size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+    std::array<std::atomic<std::uint64_t>, kBucketCount> counts_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> max_{0};
+
+    // Писатель один, поэтому хватает загрузки и записи без атомарного сложения
+    static void Increment(std::atomic<std::uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static std::size_t GetBucket(std::uint64_t value) {
+        if (value < kSubBucketCount) {
+            return static_cast<std::size_t>(value);
+        }
+        const int exponent = 63 - __builtin_clzll(value);
+        const std::uint64_t sub_bucket = value >> (exponent - kSubBucketBits);
+        return static_cast<std::size_t>(exponent - kSubBucketBits + 1) * kSubBucketCount
+               + static_cast<std::size_t>(sub_bucket - kSubBucketCount);
+    }
+
+    static std::uint64_t GetBucketUpperBound(std::size_t bucket);
+};
+
+// Длительности этапа по всем потокам
+struct QueryPhaseStats {
+    QueryPhase phase;
+    std::uint64_t count = 0;
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds p999{0};
+    std::chrono::nanoseconds max{0};
+};
+
+std::ostream& operator<<(std::ostream& output, const QueryPhaseStats& stats);
+
+// Записывает длительность этапа в гистограмму текущего потока, не беря блокировок.
+// Гистограммы потоков сливаются только при запросе сводки
+void RecordQueryPhase(QueryPhase phase, std::chrono::nanoseconds duration);
+
+// Сводка по всем этапам, включая потоки, которые уже завершились
+std::vector<QueryPhaseStats> GetQueryPhaseStats();
+
+// Обнуляет гистограммы. Запросы, идущие в это время, могут попасть в сводку частично
+void ResetQueryPhaseStats();
+
+// Замеряет время от создания до разрушения и записывает его как длительность этапа
+class QueryPhaseTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit QueryPhaseTimer(QueryPhase phase)
+            : phase_(phase) {
+    }
+
+    QueryPhaseTimer(const QueryPhaseTimer&) = delete;
+    QueryPhaseTimer& operator=(const QueryPhaseTimer&) = delete;
+
+    ~QueryPhaseTimer() {
+        RecordQueryPhase(phase_, Clock::now() - start_time_);
+    }
+
+private:
+    QueryPhase phase_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+// Вызывает function() и, если замер включён, записывает время вызова как длительность этапа
+template <typename Function>
+decltype(auto) MeasureQueryPhase(QueryPhase phase, Function function) {
+    if constexpr (kQueryProfilingEnabled) {
+        QueryPhaseTimer timer(phase);
+        return function();
+    } else {
+        return function();
+    }
+}
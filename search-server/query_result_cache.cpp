@@ -0,0 +1,250 @@
+#include "query_result_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+std::uint64_t MixHash(std::uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Приближённые частоты запросов (count-min sketch): счётчик в каждой из kDepth строк,
+// оценка - наименьший из них. Когда записей набирается в десять раз больше ёмкости,
+// все счётчики делятся пополам, чтобы давние запросы постепенно забывались
+class FrequencySketch {
+public:
+    explicit FrequencySketch(std::size_t capacity)
+            : sample_size_(std::max<std::size_t>(capacity, 1) * 10) {
+        std::size_t width = 64;
+        while (width < capacity * 4) {
+            width *= 2;
+        }
+        counters_.assign(width * kDepth, 0);
+        mask_ = width - 1;
+    }
+
+    void Increment(std::uint64_t hash) {
+        for (std::size_t row = 0; row < kDepth; ++row) {
+            std::uint8_t& counter = counters_[Index(hash, row)];
+            if (counter < kMaxCount) {
+                ++counter;
+            }
+        }
+        if (++addition_count_ == sample_size_) {
+            for (std::uint8_t& counter : counters_) {
+                counter /= 2;
+            }
+            addition_count_ /= 2;
+        }
+    }
+
+    std::uint8_t Estimate(std::uint64_t hash) const {
+        std::uint8_t count = kMaxCount;
+        for (std::size_t row = 0; row < kDepth; ++row) {
+            count = std::min(count, counters_[Index(hash, row)]);
+        }
+        return count;
+    }
+
+    void Clear() {
+        std::fill(counters_.begin(), counters_.end(), 0);
+        addition_count_ = 0;
+    }
+
+private:
+    static constexpr std::size_t kDepth = 4;
+    static constexpr std::uint8_t kMaxCount = 15;
+
+    std::vector<std::uint8_t> counters_;
+    std::size_t mask_ = 0;
+    std::size_t sample_size_;
+    std::size_t addition_count_ = 0;
+
+    std::size_t Index(std::uint64_t hash, std::size_t row) const {
+        return row * (mask_ + 1) + (MixHash(hash + row * 0x9e3779b97f4a7c15ULL) & mask_);
+    }
+};
+
+}  // namespace
+
+class QueryResultCache::Shard {
+public:
+    explicit Shard(std::size_t capacity)
+            : capacity_(capacity)
+            , sketch_(capacity) {
+    }
+
+    std::optional<std::vector<Document>> Find(const std::string& key, std::uint64_t hash, std::uint64_t version) {
+        std::lock_guard guard(mutex_);
+        sketch_.Increment(hash);
+        const auto it = positions_.find(key);
+        if (it == positions_.end()) {
+            ++stats_.miss_count;
+            return std::nullopt;
+        }
+        if (it->second->version != version) {
+            ++stats_.invalidation_count;
+            ++stats_.miss_count;
+            Erase(it->second);
+            return std::nullopt;
+        }
+        ++stats_.hit_count;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->documents;
+    }
+
+    void Insert(std::string key, std::uint64_t hash, std::uint64_t version, const std::vector<Document>& documents,
+                bool use_frequency_admission) {
+        std::lock_guard guard(mutex_);
+        if (capacity_ == 0) {
+            return;
+        }
+        if (const auto it = positions_.find(key); it != positions_.end()) {
+            // Другой поток успел посчитать тот же запрос; версии только растут
+            if (it->second->version < version) {
+                it->second->version = version;
+                it->second->documents = documents;
+            }
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if (entries_.size() == capacity_) {
+            // Устаревшую запись вытеснить не жалко
+            const Entry& victim = entries_.back();
+            if (use_frequency_admission && victim.version == version
+                && sketch_.Estimate(hash) <= sketch_.Estimate(victim.hash)) {
+                ++stats_.rejection_count;
+                return;
+            }
+            ++stats_.eviction_count;
+            Erase(std::prev(entries_.end()));
+        }
+        entries_.push_front({std::move(key), hash, version, documents});
+        positions_.emplace(entries_.front().key, entries_.begin());
+    }
+
+    void AddStats(QueryCacheStats& stats) const {
+        std::lock_guard guard(mutex_);
+        stats.hit_count += stats_.hit_count;
+        stats.miss_count += stats_.miss_count;
+        stats.eviction_count += stats_.eviction_count;
+        stats.invalidation_count += stats_.invalidation_count;
+        stats.rejection_count += stats_.rejection_count;
+        stats.size += entries_.size();
+    }
+
+    void Clear() {
+        std::lock_guard guard(mutex_);
+        positions_.clear();
+        entries_.clear();
+        sketch_.Clear();
+        stats_ = {};
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        std::uint64_t hash;
+        std::uint64_t version;
+        std::vector<Document> documents;
+    };
+
+    std::size_t capacity_;
+    mutable std::mutex mutex_;
+    // От недавно использованных к давним; ключи индекса ссылаются на строки записей
+    std::list<Entry> entries_;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> positions_;
+    FrequencySketch sketch_;
+    QueryCacheStats stats_;
+
+    void Erase(std::list<Entry>::iterator entry) {
+        positions_.erase(entry->key);
+        entries_.erase(entry);
+    }
+};
+
+std::ostream& operator<<(std::ostream& output, const QueryCacheStats& stats) {
+    const std::size_t request_count = stats.hit_count + stats.miss_count;
+    return output << "hits: " << stats.hit_count << ", misses: " << stats.miss_count
+                  << ", hit rate: " << (request_count == 0 ? 0.0 : static_cast<double>(stats.hit_count) / request_count)
+                  << ", evictions: " << stats.eviction_count << ", invalidations: " << stats.invalidation_count
+                  << ", rejections: " << stats.rejection_count << ", size: " << stats.size;
+}
+
+QueryResultCache::QueryResultCache(const SearchServer& search_server, const QueryCacheOptions& options)
+        : search_server_(search_server)
+        , use_frequency_admission_(options.use_frequency_admission) {
+    const std::size_t shard_count = std::max<std::size_t>(1, std::min(options.shard_count, options.capacity));
+    shards_.reserve(shard_count);
+    for (std::size_t shard = 0; shard < shard_count; ++shard) {
+        // Ёмкость делится между частями так, чтобы в сумме дать ровно options.capacity
+        shards_.push_back(std::make_unique<Shard>(options.capacity * (shard + 1) / shard_count
+                                                  - options.capacity * shard / shard_count));
+    }
+}
+
+QueryResultCache::~QueryResultCache() = default;
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                         const SearchOptions& options) {
+    const char status_key = static_cast<char>('0' + static_cast<int>(status));
+    return FindOrCompute(MakeKey(raw_query, 's', std::string_view(&status_key, 1), options), [&] {
+        return search_server_.FindTopDocuments(std::execution::seq, raw_query, status, options);
+    });
+}
+
+QueryCacheStats QueryResultCache::GetStats() const {
+    QueryCacheStats stats;
+    for (const auto& shard : shards_) {
+        shard->AddStats(stats);
+    }
+    return stats;
+}
+
+void QueryResultCache::Clear() {
+    for (const auto& shard : shards_) {
+        shard->Clear();
+    }
+}
+
+std::string QueryResultCache::MakeKey(std::string_view raw_query, char predicate_kind,
+                                      std::string_view predicate_key, const SearchOptions& options) const {
+    // Канонический запрос заканчивается пробелом, а слова пробелов не содержат,
+    // поэтому части ключа не сливаются
+    std::string key = search_server_.NormalizeQuery(raw_query);
+    key += '\n';
+    key += predicate_kind;
+    key += std::to_string(predicate_key.size());
+    key += ':';
+    key += predicate_key;
+    key += '\n';
+    key += std::to_string(options.max_result_count);
+    key += static_cast<char>('0' + static_cast<int>(options.evaluation));
+    // Внешние IDF меняют релевантность, поэтому входят в ключ побайтно
+    if (options.inverse_document_freqs != nullptr) {
+        key.append(reinterpret_cast<const char*>(options.inverse_document_freqs->data()),
+                   options.inverse_document_freqs->size() * sizeof(double));
+    }
+    return key;
+}
+
+std::optional<std::vector<Document>> QueryResultCache::Find(const std::string& key, std::uint64_t hash,
+                                                            std::uint64_t version) {
+    return shards_[MixHash(hash) % shards_.size()]->Find(key, hash, version);
+}
+
+void QueryResultCache::Insert(std::string key, std::uint64_t hash, std::uint64_t version,
+                              const std::vector<Document>& documents) {
+    shards_[MixHash(hash) % shards_.size()]->Insert(std::move(key), hash, version, documents,
+                                                    use_frequency_admission_);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document.h"
+#include "search_options.h"
+#include "search_server.h"
+
+struct QueryCacheStats {
+    std::size_t hit_count = 0;
+    std::size_t miss_count = 0;
+    // Записи, вытесненные новыми
+    std::size_t eviction_count = 0;
+    // Записи, найденные, но посчитанные для прежней версии сервера
+    std::size_t invalidation_count = 0;
+    // Новые результаты, не принятые в кэш: их запрос встречался реже вытесняемого
+    std::size_t rejection_count = 0;
+    std::size_t size = 0;
+};
+
+std::ostream& operator<<(std::ostream& output, const QueryCacheStats& stats);
+
+struct QueryCacheOptions {
+    std::size_t capacity = 4096;
+    // Кэш делится на части со своими блокировками, чтобы потоки реже ждали друг друга
+    std::size_t shard_count = 16;
+    // Заполненная часть принимает новый результат, только если его запрос встречался
+    // чаще самого давнего (TinyLFU); иначе кэш - обычный LRU
+    bool use_frequency_admission = true;
+};
+
+// Кэш результатов FindTopDocuments перед сервером. Ключ - запрос в каноническом виде
+// (NormalizeQuery), статус или имя предиката и параметры поиска. Каждая запись помнит
+// версию сервера, для которой посчитана, и после изменения сервера не выдаётся.
+// Методы можно вызывать из нескольких потоков, пока сервер не меняется
+class QueryResultCache {
+public:
+    explicit QueryResultCache(const SearchServer& search_server, const QueryCacheOptions& options = {});
+
+    ~QueryResultCache();
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           const SearchOptions& options = {});
+
+    // predicate_key отличает предикат от других: один ключ - всегда один и тот же отбор
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           std::string_view predicate_key,
+                                           DocumentPredicate document_predicate,
+                                           const SearchOptions& options = {});
+
+    QueryCacheStats GetStats() const;
+
+    void Clear();
+
+private:
+    class Shard;
+
+    const SearchServer& search_server_;
+    bool use_frequency_admission_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    std::string MakeKey(std::string_view raw_query, char predicate_kind, std::string_view predicate_key,
+                        const SearchOptions& options) const;
+
+    std::optional<std::vector<Document>> Find(const std::string& key, std::uint64_t hash, std::uint64_t version);
+
+    void Insert(std::string key, std::uint64_t hash, std::uint64_t version, const std::vector<Document>& documents);
+
+    template <typename Function>
+    std::vector<Document> FindOrCompute(std::string key, Function compute);
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query,
+                                                         std::string_view predicate_key,
+                                                         DocumentPredicate document_predicate,
+                                                         const SearchOptions& options) {
+    return FindOrCompute(MakeKey(raw_query, 'p', predicate_key, options), [&] {
+        return search_server_.FindTopDocuments(std::execution::seq, raw_query, document_predicate, options);
+    });
+}
+
+template <typename Function>
+std::vector<Document> QueryResultCache::FindOrCompute(std::string key, Function compute) {
+    // Версия читается до поиска: результат, посчитанный после изменения сервера, не
+    // запишется под старой версией
+    const std::uint64_t version = search_server_.GetIndexVersion();
+    const std::uint64_t hash = std::hash<std::string>{}(key);
+    if (auto documents = Find(key, hash, version)) {
+        return std::move(*documents);
+    }
+    std::vector<Document> documents = compute();
+    Insert(std::move(key), hash, version, documents);
+    return documents;
+}
@@ -0,0 +1,59 @@
+#include "relevance_accumulator.h"
+
+void RelevanceAccumulator::Reset(int document_id_bound, bool use_impacts) {
+    Clear();
+    const std::size_t bound = static_cast<std::size_t>(document_id_bound);
+    if (relevance_.size() < bound) {
+        relevance_.resize(bound, 0.0);
+        touched_mask_.resize((bound + 63) / 64, 0);
+        excluded_.resize((bound + 63) / 64, 0);
+    }
+    if (use_impacts && impacts_.size() < bound) {
+        impacts_.resize(bound, 0);
+    }
+}
+
+void RelevanceAccumulator::Exclude(int document_id) {
+    std::uint64_t& word = excluded_[Word(document_id)];
+    if (word == 0) {
+        excluded_words_.push_back(Word(document_id));
+    }
+    word |= Bit(document_id);
+}
+
+void RelevanceAccumulator::ExcludeMissing(const std::uint64_t* mask, int range_begin, int range_end) {
+    if (range_begin >= range_end) {
+        return;
+    }
+    const std::size_t word_end = Word(range_end - 1) + 1;
+    for (std::size_t word = Word(range_begin); word < word_end; ++word) {
+        if (excluded_[word] == 0) {
+            excluded_words_.push_back(word);
+        }
+        excluded_[word] |= ~mask[word];
+    }
+}
+
+void RelevanceAccumulator::Clear() {
+    for (const int document_id : touched_) {
+        relevance_[document_id] = 0.0;
+        touched_mask_[Word(document_id)] = 0;
+    }
+    if (!impacts_.empty()) {
+        for (const int document_id : touched_) {
+            if (static_cast<std::size_t>(document_id) < impacts_.size()) {
+                impacts_[document_id] = 0;
+            }
+        }
+    }
+    touched_.clear();
+    for (const std::size_t word : excluded_words_) {
+        excluded_[word] = 0;
+    }
+    excluded_words_.clear();
+}
+
+RelevanceAccumulator& GetThreadRelevanceAccumulator() {
+    thread_local RelevanceAccumulator accumulator;
+    return accumulator;
+}
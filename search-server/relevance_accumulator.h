@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Плотный аккумулятор релевантности: ячейка на каждый id документа и список
+// затронутых ячеек, чтобы очищать только их. Минус-слова задаются битовой маской.
+// Квантованные вклады складываются в отдельные целые ячейки.
+// Буферы переживают запрос, поэтому повторные запросы не выделяют память
+class RelevanceAccumulator {
+public:
+    // Готовит аккумулятор к запросу по документам с id в [0, document_id_bound);
+    // use_impacts - будут ли в запросе вызовы AddImpact
+    void Reset(int document_id_bound, bool use_impacts = false);
+
+    void Exclude(int document_id);
+
+    // Исключает документы из [range_begin, range_end), чьи биты в mask не установлены.
+    // Маска накладывается словами, так что лишние биты слов на краях тоже исключаются
+    void ExcludeMissing(const std::uint64_t* mask, int range_begin, int range_end);
+
+    // Исключает документы word * 64 + i для установленных битов i
+    void ExcludeWord(std::size_t word, std::uint64_t bits) {
+        if (bits == 0) {
+            return;
+        }
+        if (excluded_[word] == 0) {
+            excluded_words_.push_back(word);
+        }
+        excluded_[word] |= bits;
+    }
+
+    bool IsExcluded(int document_id) const {
+        return (excluded_[Word(document_id)] & Bit(document_id)) != 0;
+    }
+
+    void Add(int document_id, double relevance) {
+        Touch(document_id);
+        relevance_[document_id] += relevance;
+    }
+
+    void AddImpact(int document_id, std::uint32_t impact) {
+        Touch(document_id);
+        impacts_[document_id] += impact;
+    }
+
+    // Обходит набранные документы, не попавшие под минус-слова
+    template <typename Function>
+    void ForEach(Function function);
+
+    // То же, но к релевантности добавляется сумма квантованных вкладов, умноженная на impact_step
+    template <typename Function>
+    void ForEachQuantized(double impact_step, Function function);
+
+private:
+    std::vector<double> relevance_;
+    std::vector<std::uint32_t> impacts_;
+    std::vector<std::uint64_t> touched_mask_;
+    std::vector<std::uint64_t> excluded_;
+    std::vector<int> touched_;
+    std::vector<std::size_t> excluded_words_;
+
+    static std::size_t Word(int document_id) {
+        return static_cast<std::size_t>(document_id) / 64;
+    }
+
+    static std::uint64_t Bit(int document_id) {
+        return std::uint64_t{1} << (static_cast<std::size_t>(document_id) % 64);
+    }
+
+    void Touch(int document_id) {
+        if ((touched_mask_[Word(document_id)] & Bit(document_id)) == 0) {
+            touched_mask_[Word(document_id)] |= Bit(document_id);
+            touched_.push_back(document_id);
+        }
+    }
+
+    void Clear();
+};
+
+// Аккумулятор текущего потока, переиспользуемый между запросами
+RelevanceAccumulator& GetThreadRelevanceAccumulator();
+
+template <typename Function>
+void RelevanceAccumulator::ForEach(Function function) {
+    for (const int document_id : touched_) {
+        if (!IsExcluded(document_id)) {
+            function(document_id, relevance_[document_id]);
+        }
+    }
+}
+
+template <typename Function>
+void RelevanceAccumulator::ForEachQuantized(double impact_step, Function function) {
+    for (const int document_id : touched_) {
+        if (!IsExcluded(document_id)) {
+            function(document_id, relevance_[document_id] + impacts_[document_id] * impact_step);
+        }
+    }
+}
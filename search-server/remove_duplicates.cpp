@@ -1,24 +1,138 @@
 #include "remove_duplicates.h"
+#include <algorithm>
+#include <cstdint>
+#include <execution>
 #include <iostream>
-#include <set>
-#include <vector>
+#include <numeric>
+#include <utility>
 
-void RemoveDuplicates(SearchServer& server) {
-    std::set<std::string> words_document;
-    std::vector<int> id_documents_remove;
-    for(const int i : server){
-        std::string words;
-        for(auto [word, freq] : server.GetWordFrequencies(i)){
-            words += word;
+namespace {
+
+// Непересекающиеся множества индексов документов; корень множества - его наименьший индекс
+class DisjointSets {
+public:
+    explicit DisjointSets(std::size_t size)
+            : parents_(size) {
+        std::iota(parents_.begin(), parents_.end(), std::size_t{0});
+    }
+
+    std::size_t Find(std::size_t index) {
+        while (parents_[index] != index) {
+            parents_[index] = parents_[parents_[index]];
+            index = parents_[index];
+        }
+        return index;
+    }
+
+    void Unite(std::size_t lhs, std::size_t rhs) {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        if (lhs > rhs) {
+            std::swap(lhs, rhs);
+        }
+        parents_[rhs] = lhs;
+    }
+
+private:
+    std::vector<std::size_t> parents_;
+};
+
+std::uint64_t HashBand(const std::uint64_t* values, std::size_t size) {
+    std::uint64_t hash = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ values[i]) * 0x100000001b3ULL + 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+void PrintAndRemove(SearchServer& server, const std::vector<int>& document_ids) {
+    for (const int document_id : document_ids) {
+        std::cout << std::string("Found duplicate document id ") << document_id << '\n';
+    }
+    for (const int document_id : document_ids) {
+        server.RemoveDocument(document_id);
+    }
+}
+
+}  // namespace
+
+std::vector<int> FindDuplicates(const SearchServer& server) {
+    const std::vector<int> document_ids(server.begin(), server.end());
+    std::vector<char> is_duplicate(document_ids.size(), 0);
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), is_duplicate.begin(),
+                   [&server](int document_id) {
+                       const std::optional<int> original_id = server.FindDuplicate(document_id);
+                       return static_cast<char>(original_id && *original_id < document_id);
+                   });
+    std::vector<int> duplicate_ids;
+    for (std::size_t i = 0; i < document_ids.size(); ++i) {
+        if (is_duplicate[i]) {
+            duplicate_ids.push_back(document_ids[i]);
         }
-        if (!words_document.count(words)) {
-            words_document.insert(words);
-        } else {
-            std::cout << std::string("Found duplicate document id ") << i << '\n';
-            id_documents_remove.push_back(i);
+    }
+    return duplicate_ids;
+}
+
+std::vector<int> FindNearDuplicates(const SearchServer& server, const NearDuplicateOptions& options) {
+    const std::vector<int> document_ids(server.begin(), server.end());
+    const std::size_t document_count = document_ids.size();
+    const std::size_t signature_size = options.band_count * options.band_size;
+    if (document_count == 0 || signature_size == 0) {
+        return {};
+    }
+
+    // Подписи и хэши их полос: подпись - самая долгая часть, она и считается параллельно
+    std::vector<std::size_t> indices(document_count);
+    std::iota(indices.begin(), indices.end(), std::size_t{0});
+    std::vector<std::uint64_t> band_hashes(document_count * options.band_count);
+    std::for_each(std::execution::par, indices.begin(), indices.end(), [&](std::size_t index) {
+        thread_local std::vector<std::uint64_t> signature;
+        signature.resize(signature_size);
+        server.ComputeMinHashSignature(document_ids[index], signature);
+        for (std::size_t band = 0; band < options.band_count; ++band) {
+            band_hashes[index * options.band_count + band] = HashBand(&signature[band * options.band_size],
+                                                                      options.band_size);
+        }
+    });
+
+    // В каждой полосе документы с одинаковым хэшем сравниваются с первым из них:
+    // близкие документы почти наверняка попадут в одну корзину хотя бы в одной полосе
+    DisjointSets sets(document_count);
+    std::vector<std::pair<std::uint64_t, std::size_t>> buckets(document_count);
+    for (std::size_t band = 0; band < options.band_count; ++band) {
+        for (std::size_t index = 0; index < document_count; ++index) {
+            buckets[index] = {band_hashes[index * options.band_count + band], index};
+        }
+        std::sort(buckets.begin(), buckets.end());
+        for (std::size_t begin = 0; begin < document_count;) {
+            std::size_t end = begin + 1;
+            for (; end < document_count && buckets[end].first == buckets[begin].first; ++end) {
+                const std::size_t leader = buckets[begin].second;
+                const std::size_t index = buckets[end].second;
+                if (sets.Find(leader) != sets.Find(index)
+                    && server.ComputeWordSetSimilarity(document_ids[leader], document_ids[index])
+                       >= options.min_similarity) {
+                    sets.Unite(leader, index);
+                }
+            }
+            begin = end;
         }
     }
-    for(int i : id_documents_remove){
-        server.RemoveDocument(i);
+
+    std::vector<int> duplicate_ids;
+    for (std::size_t index = 0; index < document_count; ++index) {
+        if (sets.Find(index) != index) {
+            duplicate_ids.push_back(document_ids[index]);
+        }
     }
+    return duplicate_ids;
+}
+
+void RemoveDuplicates(SearchServer& server) {
+    PrintAndRemove(server, FindDuplicates(server));
+}
+
+void RemoveNearDuplicates(SearchServer& server, const NearDuplicateOptions& options) {
+    PrintAndRemove(server, FindNearDuplicates(server, options));
 }
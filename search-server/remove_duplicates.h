@@ -1,5 +1,27 @@
 #pragma once
 
+#include <cstddef>
+#include <vector>
 #include "search_server.h"
 
+// Параметры поиска почти одинаковых документов
+struct NearDuplicateOptions {
+    // Доля общих слов (мера Жаккара), начиная с которой документы считаются почти одинаковыми
+    double min_similarity = 0.8;
+    // MinHash-подпись делится на band_count полос по band_size значений. Документы
+    // сравниваются точно, только если у них совпала хотя бы одна полоса
+    std::size_t band_count = 16;
+    std::size_t band_size = 4;
+};
+
+// Документы, у которых есть документ с меньшим id и тем же набором слов, по возрастанию id
+std::vector<int> FindDuplicates(const SearchServer& server);
+
+// Документы, связанные с документом меньшего id цепочкой почти одинаковых пар, по
+// возрастанию id. Подписи документов считаются параллельно, а пары-кандидаты ищутся
+// по совпавшим полосам подписей (LSH), так что не все пары проверяются
+std::vector<int> FindNearDuplicates(const SearchServer& server, const NearDuplicateOptions& options = {});
+
 void RemoveDuplicates(SearchServer& server);
+
+void RemoveNearDuplicates(SearchServer& server, const NearDuplicateOptions& options = {});
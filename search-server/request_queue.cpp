@@ -1,19 +1,22 @@
 #include "request_queue.h"
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    return AddFindRequest(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-                });
+    return AddFindRequest<DocumentStatus>(raw_query, status);
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
     return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
-    : search_server_(search_server) {
+RequestQueue::RequestQueue(const SearchServer& search_server, std::chrono::minutes window)
+    : search_server_(search_server)
+    , statistics_(window) {
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return no_result_requests;
+    return static_cast<int>(GetStats().no_result_count);
+}
+
+RequestWindowStats RequestQueue::GetStats() const {
+    return statistics_.GetStats(RequestStatistics::Clock::now());
 }
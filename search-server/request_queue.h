@@ -1,13 +1,19 @@
 #pragma once
 
 #include "search_server.h"
+#include <chrono>
 #include <vector>
 #include <string>
 #include "document.h"
+#include "request_statistics.h"
 
+// Выполняет запросы к серверу и ведёт их статистику за скользящее окно (по умолчанию сутки).
+// Запросы можно добавлять из многих потоков сразу: поиск только читает сервер, а запись
+// статистики не берёт блокировок
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    explicit RequestQueue(const SearchServer& search_server,
+                          std::chrono::minutes window = std::chrono::hours(24));
     
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
@@ -16,25 +22,22 @@ public:
     
     std::vector<Document> AddFindRequest(const std::string& raw_query);
     
+    // Число запросов без результатов за окно
     int GetNoResultRequests() const;
+
+    // Число запросов, доля пустых и гистограмма задержек за окно
+    RequestWindowStats GetStats() const;
     
 private:
-    int total_requests = 0;
-    int no_result_requests = 0;
-    const static int min_in_day_ = 1440;
     const SearchServer& search_server_;
+    RequestStatistics statistics_;
 }; 
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const auto start = RequestStatistics::Clock::now();
     std::vector<Document> documents = search_server_.FindTopDocuments(raw_query, document_predicate);
-    if(documents.empty() && (total_requests <= min_in_day_)) {
-        ++no_result_requests;
-    } else {
-        if(no_result_requests > 0 && total_requests >= min_in_day_) {
-            --no_result_requests;
-        }
-    }
-    ++total_requests;
+    const auto finish = RequestStatistics::Clock::now();
+    statistics_.Record(finish, finish - start, !documents.empty());
     return documents;
 }
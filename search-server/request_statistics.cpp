@@ -0,0 +1,92 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+double RequestWindowStats::GetNoResultRate() const {
+    return request_count == 0 ? 0.0 : static_cast<double>(no_result_count) / request_count;
+}
+
+std::chrono::microseconds RequestWindowStats::GetLatencyQuantile(double quantile) const {
+    if (request_count == 0) {
+        return std::chrono::microseconds(0);
+    }
+    const auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * request_count));
+    std::uint64_t count = 0;
+    for (std::size_t bucket = 0; bucket < kLatencyBucketCount; ++bucket) {
+        count += latency_counts[bucket];
+        if (count >= std::max<std::uint64_t>(rank, 1)) {
+            return std::chrono::microseconds(std::int64_t{1} << bucket);
+        }
+    }
+    return std::chrono::microseconds(std::int64_t{1} << (kLatencyBucketCount - 1));
+}
+
+RequestStatistics::RequestStatistics(std::chrono::minutes window)
+        : window_minutes_(window.count()) {
+    if (window_minutes_ <= 0) {
+        throw std::invalid_argument(std::string("Window must be positive"));
+    }
+    // Лишняя корзина отделяет текущую минуту от самой старой в окне
+    bucket_count_ = static_cast<std::size_t>(window_minutes_) + 1;
+    buckets_ = std::make_unique<Bucket[]>(bucket_count_);
+}
+
+void RequestStatistics::Record(Clock::time_point time, Clock::duration latency, bool has_results) {
+    const std::int64_t minute = GetMinute(time);
+    Bucket& bucket = buckets_[static_cast<std::size_t>(minute) % bucket_count_];
+    const std::uint64_t tag = static_cast<std::uint64_t>(minute) << kCountBits;
+
+    const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    std::size_t latency_bucket = 0;
+    for (std::uint64_t value = static_cast<std::uint64_t>(std::max<std::int64_t>(microseconds, 0)); value > 0;
+         value >>= 1) {
+        ++latency_bucket;
+    }
+    Increment(bucket.latency_counts[std::min(latency_bucket, RequestWindowStats::kLatencyBucketCount - 1)], tag);
+    if (!has_results) {
+        Increment(bucket.no_result_count, tag);
+    }
+}
+
+RequestWindowStats RequestStatistics::GetStats(Clock::time_point now) const {
+    RequestWindowStats stats;
+    const std::int64_t last_minute = GetMinute(now);
+    for (std::int64_t minute = std::max<std::int64_t>(last_minute - window_minutes_ + 1, 0); minute <= last_minute;
+         ++minute) {
+        const Bucket& bucket = buckets_[static_cast<std::size_t>(minute) % bucket_count_];
+        const std::uint64_t tag = static_cast<std::uint64_t>(minute) << kCountBits;
+        for (std::size_t i = 0; i < RequestWindowStats::kLatencyBucketCount; ++i) {
+            const std::uint64_t count = Load(bucket.latency_counts[i], tag);
+            stats.latency_counts[i] += count;
+            stats.request_count += count;
+        }
+        stats.no_result_count += Load(bucket.no_result_count, tag);
+    }
+    return stats;
+}
+
+std::int64_t RequestStatistics::GetMinute(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::minutes>(time.time_since_epoch()).count();
+}
+
+void RequestStatistics::Increment(std::atomic<std::uint64_t>& counter, std::uint64_t tag) {
+    std::uint64_t value = counter.load(std::memory_order_relaxed);
+    while ((value & ~kCountMask) != tag) {
+        // Корзина осталась от старой минуты: счёт начинается заново. Если другой поток
+        // успел раньше, повторяем с его значением
+        if (counter.compare_exchange_weak(value, tag | 1, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+    // Счётчик уже этой минуты. Сменить минуту в нём может лишь поток, пришедший на целое
+    // окно позже, так что прибавление без сравнения не попадёт в чужую минуту
+    counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t RequestStatistics::Load(const std::atomic<std::uint64_t>& counter, std::uint64_t tag) {
+    const std::uint64_t value = counter.load(std::memory_order_relaxed);
+    return (value & ~kCountMask) == tag ? value & kCountMask : 0;
+}
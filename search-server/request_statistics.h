@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Сводка запросов за окно
+struct RequestWindowStats {
+    // Корзины задержек по степеням двойки: в корзине i запросы с задержкой
+    // [2^(i-1), 2^i) мкс, в нулевой - быстрее микросекунды
+    static constexpr std::size_t kLatencyBucketCount = 32;
+
+    std::uint64_t request_count = 0;
+    std::uint64_t no_result_count = 0;
+    std::array<std::uint64_t, kLatencyBucketCount> latency_counts{};
+
+    double GetNoResultRate() const;
+
+    // Верхняя граница корзины, в которую попадает доля quantile запросов
+    std::chrono::microseconds GetLatencyQuantile(double quantile) const;
+};
+
+// Статистика запросов за скользящее окно из минутных корзин. Корзины лежат в кольце,
+// и каждый счётчик хранит рядом со значением номер своей минуты: запись в корзину,
+// оставшуюся от минуты, вышедшей из окна, начинает счёт заново. Поэтому запись не
+// берёт блокировок и не ждёт других потоков - это одна-две атомарные операции
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestStatistics(std::chrono::minutes window = std::chrono::hours(24));
+
+    void Record(Clock::time_point time, Clock::duration latency, bool has_results);
+
+    // Сводка за окно, которое заканчивается минутой now. Запись идёт параллельно,
+    // поэтому сводка может не учесть запросы, записанные во время её сбора
+    RequestWindowStats GetStats(Clock::time_point now) const;
+
+private:
+    // Старшие 24 бита счётчика - номер минуты по модулю 2^24, младшие 40 - значение
+    static constexpr int kCountBits = 40;
+    static constexpr std::uint64_t kCountMask = (std::uint64_t{1} << kCountBits) - 1;
+
+    struct alignas(64) Bucket {
+        std::atomic<std::uint64_t> no_result_count{0};
+        std::array<std::atomic<std::uint64_t>, RequestWindowStats::kLatencyBucketCount> latency_counts{};
+    };
+
+    std::int64_t window_minutes_;
+    std::size_t bucket_count_;
+    std::unique_ptr<Bucket[]> buckets_;
+
+    static std::int64_t GetMinute(Clock::time_point time);
+
+    static void Increment(std::atomic<std::uint64_t>& counter, std::uint64_t tag);
+
+    static std::uint64_t Load(const std::atomic<std::uint64_t>& counter, std::uint64_t tag);
+};
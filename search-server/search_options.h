@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Способ вычисления запроса
+enum class QueryEvaluation {
+    // Суммируются все вхождения всех плюс-слов
+    EXHAUSTIVE,
+    // Документы обходятся по возрастанию id, и пропускаются те, что по верхней
+    // границе релевантности не могут попасть в топ (WAND)
+    WAND,
+    // Как EXHAUSTIVE, но вклады вхождений берутся готовыми из индекса, квантованными
+    // до uint16 (SearchServer::QuantizeIndex), и складываются в целых. Релевантность
+    // приближённая; сегменты без квантованных вкладов считаются точно
+    QUANTIZED,
+};
+
+// Параметры выполнения отдельного поискового запроса
+struct SearchOptions {
+    // Сколько лучших документов вернуть
+    std::size_t max_result_count = 5;
+    QueryEvaluation evaluation = QueryEvaluation::EXHAUSTIVE;
+    // IDF плюс-слов запроса в порядке возрастания слов, посчитанные не по этому серверу, а по
+    // всему корпусу (SearchServer::GetTermStatistics). Квантованные вклады с ними не
+    // используются; FindTopDocumentsBatch их не учитывает
+    const std::vector<double>* inverse_document_freqs = nullptr;
+};
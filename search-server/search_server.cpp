@@ -1,6 +1,11 @@
 #include "search_server.h"
+#include "word_set_hash.h"
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 
 SearchServer::SearchServer(const std::string& stop_words_text)
         : SearchServer(SplitIntoWords(stop_words_text)) {
@@ -12,64 +17,293 @@ SearchServer::SearchServer(std::string_view stop_words_text)
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
                                const std::vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || (attributes_.Contains(document_id))) {
         throw std::invalid_argument(std::string("Invalid document_id"));
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    thread_local std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(document, words);
 
     const double inv_word_count = 1.0 / words.size();
+    thread_local std::vector<TermId> terms;
+    terms.clear();
     for (const std::string_view& word : words) {
-        auto [iter_word, b] = words_documents_.insert(std::string (word));
-        word_to_document_freqs_[*iter_word][document_id] += inv_word_count;
-        word_frequency_by_document_id_[document_id][*iter_word] += inv_word_count;
+        terms.push_back(dictionary_.Intern(word));
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+    const DocumentTerms& document_terms = document_terms_.emplace(document_id, CountTerms(terms, inv_word_count))
+            .first->second;
+    index_.AddDocument(document_id, {document_terms.terms.data(), document_terms.term_freqs.data(),
+                                     document_terms.terms.size()}, inv_word_count);
+    attributes_.Add(document_id, status, ComputeAverageRating(ratings),
+                    HashWordSet({document_terms.terms.data(), nullptr, document_terms.terms.size()}));
     documents_id_.insert(document_id);
+    index_version_ = GetNextIndexVersion();
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq, raw_query,
-                            [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
+void SearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::sequenced_policy& policy,
+                                const std::vector<DocumentToAdd>& documents) {
+    AddDocumentsBatch(policy, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::parallel_policy& policy,
+                                const std::vector<DocumentToAdd>& documents) {
+    AddDocumentsBatch(policy, documents);
+}
+
+template <typename Policy>
+void SearchServer::AddDocumentsBatch(const Policy& policy, const std::vector<DocumentToAdd>& documents) {
+    // Пакет проверяется целиком до первого изменения
+    std::vector<const DocumentToAdd*> sorted_documents;
+    sorted_documents.reserve(documents.size());
+    for (const DocumentToAdd& document : documents) {
+        if ((document.id < 0) || (attributes_.Contains(document.id))) {
+            throw std::invalid_argument(std::string("Invalid document_id"));
+        }
+        sorted_documents.push_back(&document);
+    }
+    const auto by_id = [](const DocumentToAdd* lhs, const DocumentToAdd* rhs) {
+        return lhs->id < rhs->id;
+    };
+    std::sort(policy, sorted_documents.begin(), sorted_documents.end(), by_id);
+    if (std::adjacent_find(sorted_documents.begin(), sorted_documents.end(), [](const auto* lhs, const auto* rhs) {
+        return lhs->id == rhs->id;
+    }) != sorted_documents.end()) {
+        throw std::invalid_argument(std::string("Invalid document_id"));
+    }
+
+    // Исключение в параллельном алгоритме завершило бы программу, поэтому ошибки разбора
+    // запоминаются и бросаются уже после него
+    const std::size_t document_count = sorted_documents.size();
+    std::vector<ParsedDocument> parsed_documents(document_count);
+    std::vector<std::size_t> positions(document_count);
+    std::iota(positions.begin(), positions.end(), 0);
+    std::for_each(policy, positions.begin(), positions.end(), [&](std::size_t i) {
+        try {
+            parsed_documents[i] = ParseDocument(sorted_documents[i]->text);
+        } catch (...) {
+            parsed_documents[i].error = std::current_exception();
+        }
+    });
+    std::size_t posting_count = 0;
+    for (const ParsedDocument& document : parsed_documents) {
+        if (document.error) {
+            std::rethrow_exception(document.error);
+        }
+        posting_count += document.word_freqs.size();
+    }
+
+    // Частичные индексы строятся по диапазонам документов независимо: у каждого свой
+    // словарь слов, а вхождения затем пишутся на заранее отведённые места в общем пакете
+    const std::size_t range_count = std::is_same_v<Policy, std::execution::parallel_policy>
+            ? std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(),
+                                                             document_count / kMinBatchRangeSize))
+            : 1;
+    std::vector<std::size_t> ranges(range_count);
+    std::iota(ranges.begin(), ranges.end(), 0);
+    const auto get_range_begin = [document_count, range_count](std::size_t range) {
+        return document_count * range / range_count;
+    };
+    std::vector<std::vector<std::string_view>> range_words(range_count);
+    std::for_each(policy, ranges.begin(), ranges.end(), [&](std::size_t range) {
+        std::unordered_map<std::string_view, std::size_t> range_dictionary;
+        for (std::size_t i = get_range_begin(range); i < get_range_begin(range + 1); ++i) {
+            ParsedDocument& document = parsed_documents[i];
+            document.batch_words.reserve(document.word_freqs.size());
+            for (const auto& [word, _] : document.word_freqs) {
+                const auto [it, is_new] = range_dictionary.emplace(word, range_words[range].size());
+                if (is_new) {
+                    range_words[range].push_back(word);
+                }
+                document.batch_words.push_back(it->second);
+            }
+        }
     });
+
+    // Слово ищется в словаре один раз на пакет, а не на каждое вхождение
+    PostingsBatch batch;
+    std::unordered_map<std::string_view, std::size_t> batch_dictionary;
+    std::vector<std::vector<std::size_t>> range_to_batch_words(range_count);
+    for (std::size_t range = 0; range < range_count; ++range) {
+        range_to_batch_words[range].reserve(range_words[range].size());
+        for (const std::string_view word : range_words[range]) {
+            const auto [it, is_new] = batch_dictionary.emplace(word, batch.terms.size());
+            if (is_new) {
+                batch.terms.push_back(dictionary_.Intern(word));
+            }
+            range_to_batch_words[range].push_back(it->second);
+        }
+    }
+
+    // Слова документов по возрастанию номера собираются в общий массив пакета: i-му
+    // документу отведены позиции [document_offsets[i], document_offsets[i + 1])
+    std::vector<std::size_t> document_offsets(document_count + 1);
+    for (std::size_t i = 0; i < document_count; ++i) {
+        document_offsets[i + 1] = document_offsets[i] + parsed_documents[i].word_freqs.size();
+    }
+    std::vector<std::pair<TermId, double>> document_term_freqs(posting_count);
+    std::vector<std::vector<std::size_t>> range_offsets(range_count, std::vector<std::size_t>(batch.terms.size()));
+    std::for_each(policy, ranges.begin(), ranges.end(), [&](std::size_t range) {
+        for (std::size_t i = get_range_begin(range); i < get_range_begin(range + 1); ++i) {
+            ParsedDocument& document = parsed_documents[i];
+            const auto term_freqs = document_term_freqs.begin() + document_offsets[i];
+            for (std::size_t j = 0; j < document.batch_words.size(); ++j) {
+                const std::size_t batch_word = range_to_batch_words[range][document.batch_words[j]];
+                document.batch_words[j] = batch_word;
+                term_freqs[j] = {batch.terms[batch_word], document.word_freqs[j].second};
+                ++range_offsets[range][batch_word];
+            }
+            std::sort(term_freqs, term_freqs + document.batch_words.size());
+        }
+    });
+    batch.term_offsets.resize(batch.terms.size() + 1);
+    std::size_t offset = 0;
+    for (std::size_t batch_word = 0; batch_word < batch.terms.size(); ++batch_word) {
+        batch.term_offsets[batch_word] = offset;
+        for (std::vector<std::size_t>& offsets : range_offsets) {
+            offset += std::exchange(offsets[batch_word], offset);
+        }
+    }
+    batch.term_offsets.back() = offset;
+    batch.document_ids.resize(posting_count);
+    batch.term_freqs.resize(posting_count);
+    std::for_each(policy, ranges.begin(), ranges.end(), [&](std::size_t range) {
+        std::vector<std::size_t>& offsets = range_offsets[range];
+        for (std::size_t i = get_range_begin(range); i < get_range_begin(range + 1); ++i) {
+            const ParsedDocument& document = parsed_documents[i];
+            for (std::size_t j = 0; j < document.batch_words.size(); ++j) {
+                const std::size_t position = offsets[document.batch_words[j]]++;
+                batch.document_ids[position] = sorted_documents[i]->id;
+                batch.term_freqs[position] = document.word_freqs[j].second;
+            }
+        }
+    });
+
+    batch.inv_word_counts.reserve(document_count);
+    for (std::size_t i = 0; i < document_count; ++i) {
+        batch.inv_word_counts.emplace_back(sorted_documents[i]->id, parsed_documents[i].inv_word_count);
+    }
+    index_.AddDocuments(policy, batch);
+
+    // Массивы документов заводятся уже здесь: пул индекса не потокобезопасен
+    for (std::size_t i = 0; i < document_count; ++i) {
+        const DocumentToAdd& document = *sorted_documents[i];
+        DocumentTerms document_terms{std::pmr::vector<TermId>(memory_->GetResource()),
+                                     std::pmr::vector<double>(memory_->GetResource())};
+        document_terms.terms.reserve(document_offsets[i + 1] - document_offsets[i]);
+        document_terms.term_freqs.reserve(document_offsets[i + 1] - document_offsets[i]);
+        for (std::size_t j = document_offsets[i]; j < document_offsets[i + 1]; ++j) {
+            document_terms.terms.push_back(document_term_freqs[j].first);
+            document_terms.term_freqs.push_back(document_term_freqs[j].second);
+        }
+        const std::uint64_t word_set_hash = HashWordSet({document_terms.terms.data(), nullptr,
+                                                         document_terms.terms.size()});
+        document_terms_.emplace(document.id, std::move(document_terms));
+        attributes_.Add(document.id, document.status, ComputeAverageRating(document.ratings), word_set_hash);
+        documents_id_.insert(document.id);
+    }
+    index_version_ = GetNextIndexVersion();
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatusPredicate{status});
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                                       DocumentStatus status,
+                                                                       const SearchOptions& options) const {
+    return FindTopDocumentsBatch(raw_queries, DocumentStatusPredicate{status}, options);
+}
+
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return attributes_.GetCount();
+}
+
+std::uint64_t SearchServer::GetIndexVersion() const {
+    return index_version_;
+}
+
+std::string SearchServer::NormalizeQuery(std::string_view raw_query) const {
+    QueryScratchScope scratch_scope;
+    const Query query = ParseQuery(raw_query);
+    std::string normalized_query;
+    for (const std::string_view word : query.plus_words) {
+        if (std::binary_search(query.required_words.begin(), query.required_words.end(), word)) {
+            normalized_query += '+';
+        }
+        normalized_query += word;
+        normalized_query += ' ';
+    }
+    for (const std::string_view word : query.minus_words) {
+        normalized_query += '-';
+        normalized_query += word;
+        normalized_query += ' ';
+    }
+    return normalized_query;
+}
+
+SearchServer::TermStatistics SearchServer::GetTermStatistics(std::string_view raw_query) const {
+    QueryScratchScope scratch_scope;
+    const Query query = ParseQuery(raw_query);
+    TermStatistics statistics;
+    statistics.document_count = index_.GetDocumentCount();
+    statistics.document_freqs.reserve(query.plus_words.size());
+    for (const std::string_view word : query.plus_words) {
+        statistics.document_freqs.push_back(index_.GetDocumentFreq(dictionary_.Find(word)));
+    }
+    return statistics;
+}
+
+std::uint64_t SearchServer::GetNextIndexVersion() {
+    static std::atomic<std::uint64_t> next_version{0};
+    return next_version.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+int SearchServer::GetDocumentIdBound() const {
+    return attributes_.GetIdBound();
 }
 
-std::set<int>::iterator SearchServer::begin() {
+std::set<int>::const_iterator SearchServer::begin() const {
     return documents_id_.begin();
 }
 
-std::set<int>::iterator SearchServer::end() {
+std::set<int>::const_iterator SearchServer::end() const {
     return documents_id_.end();
 }
 
 SearchServer::MatchedDocuments SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    QueryScratchScope scratch_scope;
     const auto query = ParseQuery(raw_query);
+    const TermFrequencies term_freqs = GetDocumentTerms(document_id);
 
     std::vector<std::string_view> matched_words;
 
     for (auto word : query.minus_words) {
-        if (word_frequency_by_document_id_.at(document_id).count(word)) {
-            return {std::vector<std::string_view>{}, documents_.at(document_id).status};
+        if (HasWord(term_freqs, word)) {
+            return {std::vector<std::string_view>{}, attributes_.GetStatus(document_id)};
+        }
+    }
+    for (auto word : query.required_words) {
+        if (!HasWord(term_freqs, word)) {
+            return {std::vector<std::string_view>{}, attributes_.GetStatus(document_id)};
         }
     }
 
     for (auto word : query.plus_words) {
-        if (word_frequency_by_document_id_.at(document_id).count(word)) {
+        if (HasWord(term_freqs, word)) {
             matched_words.push_back(word);
         }
     }
 
     std::sort(matched_words.begin(), matched_words.end());
 
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, attributes_.GetStatus(document_id)};
 }
 
 SearchServer::MatchedDocuments SearchServer::MatchDocument(const std::execution::sequenced_policy&,
@@ -81,106 +315,270 @@ SearchServer::MatchedDocuments SearchServer::MatchDocument(const std::execution:
 SearchServer::MatchedDocuments SearchServer::MatchDocument(const std::execution::parallel_policy&,
                                                                                       std::string_view raw_query,
                                                                                       int document_id) const {
+    QueryScratchScope scratch_scope;
     auto query = ParseQuery(raw_query, true);
+    const TermFrequencies term_freqs = GetDocumentTerms(document_id);
 
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [this, document_id] (const std::string_view& word) {
-        return word_frequency_by_document_id_.at(document_id).count(word);
+    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [this, &term_freqs] (const std::string_view& word) {
+        return HasWord(term_freqs, word);
+    }) || !std::all_of(std::execution::par, query.required_words.begin(), query.required_words.end(), [this, &term_freqs] (const std::string_view& word) {
+        return HasWord(term_freqs, word);
     })) {
-        return {std::vector<std::string_view>{}, documents_.at(document_id).status};
+        return {std::vector<std::string_view>{}, attributes_.GetStatus(document_id)};
     }
 
     std::vector<std::string_view> matched_words(query.plus_words.size());
-    std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-                 matched_words.begin(), [this, document_id](const auto& word) {
-                     return word_frequency_by_document_id_.at(document_id).count(word);
-                 });
+    matched_words.erase(std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
+                                     matched_words.begin(), [this, &term_freqs](const auto& word) {
+                                         return HasWord(term_freqs, word);
+                                     }),
+                        matched_words.end());
+    // Параллельный разбор запроса не убирает повторы слов
     std::sort(std::execution::par, matched_words.begin(), matched_words.end());
     matched_words.erase(std::unique(std::execution::par, matched_words.begin(), matched_words.end()), matched_words.end());
 
-    if (matched_words[0].empty()) { matched_words.erase(matched_words.begin()); }
+    return {matched_words, attributes_.GetStatus(document_id)};
+}
+
+std::vector<SearchServer::MatchedDocuments> SearchServer::MatchDocuments(std::string_view raw_query,
+                                                                         const std::vector<int>& document_ids) const {
+    QueryScratchScope scratch_scope;
+    const Query query = ParseQuery(raw_query);
+    std::pmr::memory_resource* scratch = GetThreadQueryScratch();
+
+    std::pmr::vector<int> sorted_ids(document_ids.begin(), document_ids.end(), scratch);
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+    for (const int document_id : sorted_ids) {
+        if (!attributes_.Contains(document_id)) {
+            throw std::out_of_range(std::string("Invalid document_id"));
+        }
+    }
+
+    std::vector<std::vector<std::string_view>> matched_words(sorted_ids.size());
+    std::pmr::vector<char> is_excluded(sorted_ids.size(), false, scratch);
+    std::pmr::vector<std::size_t> required_counts(sorted_ids.size(), 0, scratch);
+    thread_local std::vector<std::size_t> matches;
+    // Вызывает function(i) для документов sorted_ids[i], где есть слово
+    const auto for_each_match = [&](std::string_view word, auto function) {
+        const TermId term = dictionary_.Find(word);
+        if (index_.GetDocumentFreq(term) == 0) {
+            return;
+        }
+        index_.ForEachPostings(term, [&](const IndexSegment& segment, const PostingList& postings) {
+            matches.clear();
+            index_.IntersectPostings(postings, sorted_ids.data(), sorted_ids.size(), matches);
+            for (const std::size_t i : matches) {
+                if (!segment.IsDeleted(sorted_ids[i])) {
+                    function(i);
+                }
+            }
+        });
+    };
+    for (const std::string_view word : query.minus_words) {
+        for_each_match(word, [&is_excluded](std::size_t i) {
+            is_excluded[i] = true;
+        });
+    }
+    // Плюс-слова идут по возрастанию, поэтому и списки совпавших слов получаются упорядоченными
+    for (const std::string_view word : query.plus_words) {
+        const bool is_required = std::binary_search(query.required_words.begin(), query.required_words.end(), word);
+        for_each_match(word, [&](std::size_t i) {
+            matched_words[i].push_back(word);
+            required_counts[i] += is_required;
+        });
+    }
 
-    return {matched_words, documents_.at(document_id).status};
+    std::vector<MatchedDocuments> result;
+    result.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        const std::size_t i = std::lower_bound(sorted_ids.begin(), sorted_ids.end(), document_id) - sorted_ids.begin();
+        if (is_excluded[i] || required_counts[i] < query.required_words.size()) {
+            result.emplace_back(std::vector<std::string_view>{}, attributes_.GetStatus(document_id));
+        } else {
+            result.emplace_back(matched_words[i], attributes_.GetStatus(document_id));
+        }
+    }
+    return result;
 }
 
 const std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    const TermFrequencies term_freqs = GetDocumentTerms(document_id);
     std::map<std::string_view, double> result;
-    for (auto [first, second] : word_frequency_by_document_id_.at(document_id)) {
-        result[first] = second;
+    for (std::size_t i = 0; i < term_freqs.size; ++i) {
+        result.emplace(dictionary_.GetWord(term_freqs.terms[i]), term_freqs.term_freqs[i]);
     }
     return result;
 }
 
-
-void SearchServer::RemoveDocument(int document_id) {
-    for(auto [word, freq] : word_frequency_by_document_id_[document_id]){
-        word_to_document_freqs_[word].erase(document_id);
-        if(word_to_document_freqs_[word].empty()){
-            word_to_document_freqs_.erase(word);
-            words_documents_.erase(std::string(word));
+std::optional<int> SearchServer::FindDuplicate(int document_id) const {
+    const TermFrequencies term_freqs = GetDocumentTerms(document_id);
+    for (const int other_id : attributes_.GetDocumentsWithWordSet(attributes_.GetWordSetHash(document_id))) {
+        // Совпадение отпечатков разных наборов маловероятно, но возможно
+        if (other_id != document_id && ComputeJaccardSimilarity(term_freqs, GetDocumentTerms(other_id)) == 1.0) {
+            return other_id;
         }
     }
+    return std::nullopt;
+}
 
-    word_frequency_by_document_id_.erase(document_id);
-    documents_.erase(document_id);
+void SearchServer::ComputeMinHashSignature(int document_id, std::vector<std::uint64_t>& signature) const {
+    ::ComputeMinHashSignature(GetDocumentTerms(document_id), signature);
+}
 
-    std::vector<int> documents_id_copy;
-    documents_id_copy.reserve((documents_id_.size() - 1));
+double SearchServer::ComputeWordSetSimilarity(int lhs_document_id, int rhs_document_id) const {
+    return ComputeJaccardSimilarity(GetDocumentTerms(lhs_document_id), GetDocumentTerms(rhs_document_id));
+}
 
-    auto it(std::find(documents_id_.begin(), documents_id_.end(), document_id));
-    if (it != documents_id_.end()) {
-        documents_id_.erase(it);
-    }
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
-    RemoveDocument(document_id);
+    if (attributes_.Contains(document_id)) {
+        ReleaseTerms(index_.RemoveDocument(document_id, GetDocumentTerms(document_id)));
+        document_terms_.erase(document_id);
+        index_version_ = GetNextIndexVersion();
+    }
+    attributes_.Remove(document_id);
+    documents_id_.erase(document_id);
 }
 
 // -------------------- par ------------------
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
-    std::vector<std::string_view> words(word_frequency_by_document_id_[document_id].size());
+    if (attributes_.Contains(document_id)) {
+        // Индекс только ставит надгробие, так что делить работу между потоками незачем
+        ReleaseTerms(index_.RemoveDocument(document_id, GetDocumentTerms(document_id)));
+        document_terms_.erase(document_id);
+        index_version_ = GetNextIndexVersion();
+    }
+    attributes_.Remove(document_id);
+    documents_id_.erase(document_id);
+}
 
-    std::transform(std::execution::par, word_frequency_by_document_id_[document_id].begin(),
-                   word_frequency_by_document_id_[document_id].end(), words.begin(),
-                   [](const std::pair<std::string_view, double>& p) {
-        return p.first;
-    });
+void SearchServer::CompressIndex() {
+    index_.Compress();
+}
 
-    std::for_each(std::execution::par, words.begin(), words.end(), [document_id, this](std::string_view word){
-        word_to_document_freqs_[word].erase(document_id);
-        words_documents_.erase(std::string(word));
-    });
+void SearchServer::QuantizeIndex() {
+    index_.QuantizeImpacts();
+}
 
-    word_frequency_by_document_id_.erase(document_id);
-    documents_.erase(document_id);
+void SearchServer::MergeIndexSegments() {
+    index_.MergeSegments();
+}
+
+IndexMemoryUsage SearchServer::GetIndexMemoryUsage() const {
+    return index_.GetMemoryUsage();
+}
+
+IndexAllocatorStats SearchServer::GetIndexAllocatorStats() const {
+    return memory_->GetStats();
+}
 
-    auto it(std::find(std::execution::par, documents_id_.begin(), documents_id_.end(), document_id));
-    if (it != documents_id_.end()) {
-        documents_id_.erase(it);
+void SearchServer::SaveSnapshot(const std::string& path) const {
+    std::vector<SnapshotDocument> documents;
+    documents.reserve(documents_id_.size());
+    for (const int document_id : documents_id_) {
+        documents.push_back({document_id, attributes_.GetRating(document_id), attributes_.GetStatus(document_id)});
+    }
+    // В снимке у слова один список, поэтому сегменты сливаются в копию индекса
+    const std::vector<std::string_view> stop_words(stop_words_.begin(), stop_words_.end());
+    if (index_.IsCompact()) {
+        WriteIndexSnapshot(path, stop_words, documents, dictionary_, index_);
+    } else {
+        WriteIndexSnapshot(path, stop_words, documents, dictionary_, index_.Compact());
     }
 }
 
+SearchServer SearchServer::OpenSnapshot(const std::string& path) {
+    auto snapshot = std::make_shared<IndexSnapshot>(ReadIndexSnapshot(path));
+
+    SearchServer search_server(snapshot->stop_words);
+    search_server.index_.SetInvWordCounts(snapshot->inv_word_counts);
+    // Строки слов остаются в снимке, а номера совпадают с позициями слов в нём
+    std::vector<std::pair<TermId, PostingList>> postings;
+    postings.reserve(snapshot->words.size());
+    for (std::size_t i = 0; i < snapshot->words.size(); ++i) {
+        const IndexSnapshot::Word& word = snapshot->words[i];
+        if (search_server.dictionary_.InternExternal(word.text) != i) {
+            throw std::invalid_argument(std::string("Snapshot is corrupted"));
+        }
+        postings.emplace_back(static_cast<TermId>(i), PostingList(word.postings, word.max_term_freq));
+    }
+    std::vector<int> document_ids;
+    document_ids.reserve(snapshot->documents.size());
+    for (const SnapshotDocument& document : snapshot->documents) {
+        const TermFrequencies* term_freqs = snapshot->FindDocumentWords(document.id);
+        search_server.attributes_.Add(document.id, document.status, document.rating,
+                                      HashWordSet(term_freqs != nullptr ? *term_freqs : TermFrequencies{}));
+        search_server.documents_id_.insert(search_server.documents_id_.end(), document.id);
+        document_ids.push_back(document.id);
+    }
+    search_server.index_.AddSegment(std::move(postings), document_ids);
+    search_server.snapshot_ = std::move(snapshot);
+    return search_server;
+}
+
+void SearchServer::ReleaseTerms(const std::vector<TermId>& terms) {
+    for (const TermId term : terms) {
+        dictionary_.Release(term);
+    }
+}
+
+TermFrequencies SearchServer::GetDocumentTerms(int document_id) const {
+    const auto it = document_terms_.find(document_id);
+    if (it != document_terms_.end()) {
+        return {it->second.terms.data(), it->second.term_freqs.data(), it->second.terms.size()};
+    }
+    if (snapshot_ && attributes_.Contains(document_id)) {
+        if (const TermFrequencies* term_freqs = snapshot_->FindDocumentWords(document_id)) {
+            return *term_freqs;
+        }
+    }
+    throw std::out_of_range(std::string("Invalid document_id"));
+}
+
+bool SearchServer::HasWord(const TermFrequencies& term_freqs, std::string_view word) const {
+    const TermId term = dictionary_.Find(word);
+    return term != TermDictionary::kNoTerm && ContainsTerm(term_freqs, term);
+}
+
 bool SearchServer::IsStopWord(const std::string_view word) const {
     return stop_words_.count(word);
 }
 
 bool SearchServer::IsValidWord(const std::string_view word) {
-    return std::none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-    });
+    return !HasControlChars(word);
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument(std::string("Word is invalid"));
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+// Слова разделяются только пробелами, поэтому управляющий символ в тексте
+// всегда попадает в какое-то слово, и текст можно проверить целиком
+void SearchServer::SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const {
+    if (!IsValidWord(text)) {
+        throw std::invalid_argument(std::string("Word is invalid"));
+    }
+    SplitIntoWords(text, words);
+    words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) {
+        return IsStopWord(word);
+    }), words.end());
+}
+
+SearchServer::DocumentTerms SearchServer::CountTerms(std::vector<TermId>& terms, double inv_word_count) {
+    std::sort(terms.begin(), terms.end());
+    DocumentTerms result{std::pmr::vector<TermId>(memory_->GetResource()),
+                         std::pmr::vector<double>(memory_->GetResource())};
+    for (std::size_t begin = 0; begin < terms.size();) {
+        double term_freq = 0.0;
+        std::size_t end = begin;
+        for (; end < terms.size() && terms[end] == terms[begin]; ++end) {
+            term_freq += inv_word_count;
         }
+        result.terms.push_back(terms[begin]);
+        result.term_freqs.push_back(term_freq);
+        begin = end;
     }
-    return words;
+    return result;
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -194,31 +592,59 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
+SearchServer::ParsedDocument SearchServer::ParseDocument(std::string_view text) const {
+    thread_local std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(text, words);
+    ParsedDocument document;
+    document.inv_word_count = 1.0 / words.size();
+    std::sort(words.begin(), words.end());
+    for (std::size_t begin = 0; begin < words.size();) {
+        // Частота набирается тем же сложением, что и в AddDocument
+        double term_freq = 0.0;
+        std::size_t end = begin;
+        for (; end < words.size() && words[end] == words[begin]; ++end) {
+            term_freq += document.inv_word_count;
+        }
+        document.word_freqs.emplace_back(words[begin], term_freq);
+        begin = end;
+    }
+    return document;
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word) const {
     if (word.empty()) {
         throw std::invalid_argument(std::string("Query word is empty"));
     }
     bool is_minus = false;
+    bool is_required = false;
     if (word[0] == '-') {
         is_minus = true;
         word = word.substr(1);
+    } else if (word[0] == '+') {
+        is_required = true;
+        word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(std::string(word))) {
+    if (word.empty() || word[0] == '-' || word[0] == '+' || !IsValidWord(word)) {
         throw std::invalid_argument(std::string("Query word is invalid"));
     }
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus, is_required, IsStopWord(word)};
 }
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool is_parallel_policy) const {
-    Query result;
+    Query result(GetThreadQueryScratch());
 
-    for (std::string_view& word : SplitIntoWords(text)) {
+    thread_local std::vector<std::string_view> words;
+    SplitIntoWords(text, words);
+    for (const std::string_view word : words) {
         auto query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 result.minus_words.push_back(query_word.word);
             } else {
                 result.plus_words.push_back(query_word.word);
+                if (query_word.is_required) {
+                    result.required_words.push_back(query_word.word);
+                }
             }
         }
     }
@@ -232,12 +658,168 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool is_para
         result.plus_words.erase(
                 std::unique(result.plus_words.begin(), result.plus_words.end()),
                 result.plus_words.end());
+        std::sort(result.required_words.begin(), result.required_words.end());
+        result.required_words.erase(
+                std::unique(result.required_words.begin(), result.required_words.end()),
+                result.required_words.end());
     }
 
     return result;
 }
 
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+SearchServer::SharedScanPostings SearchServer::FindSharedScanPostings(const std::string* raw_queries,
+                                                                      std::size_t query_count) const {
+    struct QueryTerm {
+        bool is_minus;
+        bool is_required;
+        std::string_view word;
+        std::size_t query;
+    };
+    SharedScanPostings scan_postings(GetThreadQueryScratch());
+    std::pmr::vector<QueryTerm> query_terms(GetThreadQueryScratch());
+    for (std::size_t i = 0; i < query_count; ++i) {
+        const Query query = ParseQuery(raw_queries[i]);
+        for (const std::string_view word : query.plus_words) {
+            query_terms.push_back({false, false, word, i});
+        }
+        for (const std::string_view word : query.minus_words) {
+            query_terms.push_back({true, false, word, i});
+        }
+        for (const std::string_view word : query.required_words) {
+            query_terms.push_back({false, true, word, i});
+        }
+        if (!query.required_words.empty()) {
+            scan_postings.required_counts[i] = static_cast<std::uint16_t>(query.required_words.size());
+            scan_postings.required_queries |= std::uint64_t{1} << i;
+        }
+    }
+    std::sort(query_terms.begin(), query_terms.end(), [](const QueryTerm& lhs, const QueryTerm& rhs) {
+        return std::tie(lhs.is_minus, lhs.is_required, lhs.word) < std::tie(rhs.is_minus, rhs.is_required, rhs.word);
+    });
+
+    for (auto it = query_terms.begin(); it != query_terms.end();) {
+        const auto group_end = std::find_if(it, query_terms.end(), [it](const QueryTerm& query_term) {
+            return query_term.is_minus != it->is_minus || query_term.is_required != it->is_required
+                   || query_term.word != it->word;
+        });
+        std::uint64_t query_mask = 0;
+        for (auto query_term = it; query_term != group_end; ++query_term) {
+            query_mask |= std::uint64_t{1} << query_term->query;
+        }
+        const TermId term = dictionary_.Find(it->word);
+        const std::size_t document_freq = index_.GetDocumentFreq(term);
+        if (document_freq > 0) {
+            auto& postings = it->is_minus ? scan_postings.minus
+                                          : it->is_required ? scan_postings.required : scan_postings.plus;
+            const double inverse_document_freq = it->is_minus || it->is_required
+                                                 ? 0.0
+                                                 : index_.GetInverseDocumentFreq(term);
+            index_.ForEachPostings(term, [&](const IndexSegment& segment, const PostingList& segment_postings) {
+                postings.push_back({&segment_postings, &segment, inverse_document_freq, query_mask});
+            });
+        }
+        it = group_end;
+    }
+    return scan_postings;
+}
+
+SearchServer::QueryPostings SearchServer::FindQueryPostings(const Query& query,
+                                                            const std::vector<double>* inverse_document_freqs) const {
+    if (inverse_document_freqs != nullptr && inverse_document_freqs->size() != query.plus_words.size()) {
+        throw std::invalid_argument(std::string("Inverse document frequencies do not match query"));
+    }
+    QueryPostings query_postings(GetThreadQueryScratch());
+    for (std::size_t i = 0; i < query.plus_words.size(); ++i) {
+        const TermId term = dictionary_.Find(query.plus_words[i]);
+        const std::size_t document_freq = index_.GetDocumentFreq(term);
+        if (document_freq == 0) {
+            continue;
+        }
+        const double inverse_document_freq = inverse_document_freqs != nullptr
+                                             ? (*inverse_document_freqs)[i]
+                                             : index_.GetInverseDocumentFreq(term);
+        // Квантованные вклады посчитаны с IDF этого сервера
+        const bool use_impacts = inverse_document_freqs == nullptr;
+        index_.ForEachPostings(term, [&](const IndexSegment& segment, const PostingList& postings) {
+            query_postings.plus.push_back({&postings, &segment, query_postings.plus_word_count, inverse_document_freq,
+                                           use_impacts ? segment.FindImpacts(term) : nullptr, nullptr});
+        });
+        ++query_postings.plus_word_count;
+    }
+    for (const std::string_view& word : query.minus_words) {
+        const TermId term = dictionary_.Find(word);
+        if (index_.GetDocumentFreq(term) == 0) {
+            continue;
+        }
+        index_.ForEachPostings(term, [&](const IndexSegment& segment, const PostingList& postings) {
+            query_postings.minus.push_back({&postings, &segment, 0, 0.0, nullptr, segment.FindBitmap(term)});
+        });
+    }
+    // Обязательное слово без документов тоже считается: под него не подходит ни один документ
+    for (const std::string_view& word : query.required_words) {
+        const TermId term = dictionary_.Find(word);
+        if (index_.GetDocumentFreq(term) > 0) {
+            index_.ForEachPostings(term, [&](const IndexSegment& segment, const PostingList& postings) {
+                query_postings.required.push_back({&postings, &segment, query_postings.required_word_count, 0.0,
+                                                   nullptr, segment.FindBitmap(term)});
+            });
+        }
+        ++query_postings.required_word_count;
+    }
+    return query_postings;
+}
+
+void SearchServer::ExcludeDocuments(const QueryPostings& query_postings, int range_begin, int range_end,
+                                    RelevanceAccumulator& accumulator) const {
+    if (range_begin >= range_end) {
+        return;
+    }
+    // Вызывает function(word, bits) для живых документов списка, задевающих диапазон
+    const auto for_each_word = [&](const SegmentPostings& segment_postings, auto function) {
+        const std::vector<std::uint64_t>& deleted = segment_postings.segment->GetDeleted();
+        if (segment_postings.bitmap != nullptr) {
+            segment_postings.bitmap->ForEachWord(range_begin, range_end, [&](std::size_t word, std::uint64_t bits) {
+                function(word, bits & ~(word < deleted.size() ? deleted[word] : 0));
+            });
+            return;
+        }
+        for (PostingCursor cursor = index_.GetCursor(*segment_postings.postings, range_begin, range_end);
+             !cursor.IsEnd(); cursor.Next()) {
+            const int document_id = cursor.DocumentId();
+            if (!segment_postings.segment->IsDeleted(document_id)) {
+                function(static_cast<std::size_t>(document_id) / 64, std::uint64_t{1} << (document_id % 64));
+            }
+        }
+    };
+    for (const SegmentPostings& minus : query_postings.minus) {
+        for_each_word(minus, [&accumulator](std::size_t word, std::uint64_t bits) {
+            accumulator.ExcludeWord(word, bits);
+        });
+    }
+    if (query_postings.required_word_count == 0) {
+        return;
+    }
+    // Кандидаты - пересечение документов всех обязательных слов
+    const std::size_t word_begin = static_cast<std::size_t>(range_begin) / 64;
+    const std::size_t word_end = static_cast<std::size_t>(range_end - 1) / 64 + 1;
+    std::pmr::vector<std::uint64_t> candidates(word_end - word_begin, ~std::uint64_t{0}, GetThreadQueryScratch());
+    std::pmr::vector<std::uint64_t> word_documents(word_end - word_begin, 0, GetThreadQueryScratch());
+    auto required = query_postings.required.begin();
+    for (std::size_t i = 0; i < query_postings.required_word_count; ++i) {
+        std::fill(word_documents.begin(), word_documents.end(), 0);
+        for (; required != query_postings.required.end() && required->word == i; ++required) {
+            for_each_word(*required, [&](std::size_t word, std::uint64_t bits) {
+                if (word >= word_begin && word < word_end) {
+                    word_documents[word - word_begin] |= bits;
+                }
+            });
+        }
+        for (std::size_t j = 0; j < candidates.size(); ++j) {
+            candidates[j] &= word_documents[j];
+        }
+    }
+    for (std::size_t j = 0; j < candidates.size(); ++j) {
+        accumulator.ExcludeWord(word_begin + j, ~candidates[j]);
+    }
 }
@@ -2,17 +2,33 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <string_view>
 #include <vector>
-#include <unordered_set>
 #include <utility>
+#include <exception>
 #include <execution>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <type_traits>
 #include "document.h"
+#include "document_attributes.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "index_snapshot.h"
+#include "inverted_index.h"
+#include "memory_resources.h"
+#include "query_profiler.h"
+#include "relevance_accumulator.h"
+#include "search_options.h"
+#include "top_documents_collector.h"
 
 class SearchServer {
 public:
@@ -29,6 +45,13 @@ public:
     void AddDocument(int document_id, std::string_view document, DocumentStatus status,
                      const std::vector<int>& ratings);
 
+    // Добавляет пакет документов: разбор текстов и пополнение списков вхождений идут
+    // параллельно, а словарь пополняется один раз на пакет. При ошибке в любом
+    // документе не добавляется ни один
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+    void AddDocuments(const std::execution::sequenced_policy&, const std::vector<DocumentToAdd>& documents);
+    void AddDocuments(const std::execution::parallel_policy&, const std::vector<DocumentToAdd>& documents);
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
@@ -46,11 +69,50 @@ public:
     std::vector<Document> FindTopDocuments(const Policy& policy,
                                            std::string_view raw_query) const;
 
+    template <typename DocumentPredicate, typename Policy>
+    std::vector<Document> FindTopDocuments(const Policy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           const SearchOptions& options) const;
+    template <typename Policy>
+    std::vector<Document> FindTopDocuments(const Policy& policy,
+                                           std::string_view raw_query,
+                                           DocumentStatus status,
+                                           const SearchOptions& options) const;
+
+    // Выполняет пачку запросов общим проходом: список вхождений каждого слова читается
+    // один раз на пачку, а вклад вхождения раздаётся всем запросам с этим словом. Результат
+    // i-го запроса тот же, что у FindTopDocuments; options.evaluation не учитывается
+    template <typename DocumentPredicate>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                             DocumentPredicate document_predicate,
+                                                             const SearchOptions& options) const;
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                             DocumentStatus status = DocumentStatus::ACTUAL,
+                                                             const SearchOptions& options = {}) const;
+
     int GetDocumentCount() const;
 
-    std::set<int>::iterator begin();
+    // Версия содержимого сервера: меняется при каждом добавлении и удалении документов.
+    // Версии берутся из общего счётчика, поэтому у разных серверов они не совпадают
+    std::uint64_t GetIndexVersion() const;
 
-    std::set<int>::iterator end();
+    // Запрос в каноническом виде: плюс-слова по возрастанию без повторов и стоп-слов,
+    // затем так же минус-слова с '-'. У запросов с одним видом одинаковые результаты
+    std::string NormalizeQuery(std::string_view raw_query) const;
+
+    // Число документов и документная частота каждого плюс-слова запроса в порядке возрастания
+    // слов. По сумме таких данных нескольких серверов считается общий IDF (SearchOptions)
+    struct TermStatistics {
+        std::size_t document_count = 0;
+        std::vector<std::size_t> document_freqs;
+    };
+
+    TermStatistics GetTermStatistics(std::string_view raw_query) const;
+
+    std::set<int>::const_iterator begin() const;
+
+    std::set<int>::const_iterator end() const;
 
     MatchedDocuments MatchDocument(std::string_view raw_query, int document_id) const;
     MatchedDocuments MatchDocument(const std::execution::sequenced_policy&,
@@ -60,62 +122,269 @@ public:
                                    std::string_view raw_query,
                                    int document_id) const;
 
+    // То же, что MatchDocument для каждого id, но за один проход по запросу: списки вхождений
+    // слов пересекаются с отсортированными id документов. Результат идёт в порядке document_ids;
+    // для неизвестного id бросает std::out_of_range
+    std::vector<MatchedDocuments> MatchDocuments(std::string_view raw_query,
+                                                 const std::vector<int>& document_ids) const;
+
     const std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
+    // Наименьший id другого документа с тем же набором слов. Отпечаток набора считается
+    // при добавлении документа, поэтому документы не перебираются
+    std::optional<int> FindDuplicate(int document_id) const;
+
+    // MinHash-подпись набора слов документа длиной signature.size()
+    void ComputeMinHashSignature(int document_id, std::vector<std::uint64_t>& signature) const;
+
+    // Доля общих слов двух документов в объединении их наборов (мера Жаккара)
+    double ComputeWordSetSimilarity(int lhs_document_id, int rhs_document_id) const;
+
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
-private:
-    const double kEpsilon = 1e-6;
-    const int kMaxResultDocumentCount = 5;
-    const std::size_t kMaxBucket = 10;
+    // Сжимает списки вхождений; поиск по сжатому индексу распаковывает их на лету
+    void CompressIndex();
 
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    // Запоминает в индексе вклады tf·idf вхождений, округлённые до uint16, для поиска
+    // с QueryEvaluation::QUANTIZED. Новые сегменты получают вклады при запечатывании
+    void QuantizeIndex();
+
+    // Сливает сегменты индекса в один и вычищает вхождения удалённых документов.
+    // Обычно это делает фоновое слияние; вызов нужен, чтобы сразу получить компактный индекс
+    void MergeIndexSegments();
+
+    IndexMemoryUsage GetIndexMemoryUsage() const;
+
+    // Выделения памяти под данные документов
+    IndexAllocatorStats GetIndexAllocatorStats() const;
+
+    // Сохраняет стоп-слова, словарь, списки вхождений и данные документов в двоичный снимок
+    void SaveSnapshot(const std::string& path) const;
+
+    // Открывает снимок через mmap: строки слов, списки вхождений и слова документов
+    // используются прямо из файла и копируются, только когда слово меняется
+    static SearchServer OpenSnapshot(const std::string& path);
+
+private:
+    // Параллельный поиск делит диапазон id на части не мельче этой
+    const int kMinParallelRangeSize = 1024;
+    // Пакет документов делится на части не мельче этой
+    static constexpr std::size_t kMinBatchRangeSize = 256;
+    // Запросов в одном общем проходе не больше, чем бит в маске запросов документа
+    static constexpr std::size_t kMaxSharedScanQueries = 64;
+    // Общий проход набирает вклады блоками id, чтобы ячейки блока оставались в кэше
+    static constexpr int kSharedScanBlockSize = 512;
+
+    // Слова документа по возрастанию номера и их частоты
+    struct DocumentTerms {
+        std::pmr::vector<TermId> terms;
+        std::pmr::vector<double> term_freqs;
     };
+    // Пул лежит в куче, чтобы контейнеры, ссылающиеся на него, можно было перемещать вместе с сервером
+    std::unique_ptr<IndexMemory> memory_ = std::make_unique<IndexMemory>();
+    // Снимок, из которого открыт сервер: на него ссылаются строки словаря и списки
+    // индекса, а слова документов из снимка берутся прямо из него. Объявлен раньше
+    // индекса, чтобы пережить фоновое слияние, которое индекс дожидается при разрушении
+    std::shared_ptr<const IndexSnapshot> snapshot_;
     const std::set<std::string, std::less<>> stop_words_;
-    std::unordered_set<std::string> words_documents_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> word_frequency_by_document_id_;
-    std::map<int, DocumentData> documents_;
+    TermDictionary dictionary_;
+    InvertedIndex index_;
+    std::pmr::map<int, DocumentTerms> document_terms_{memory_->GetResource()};
+    DocumentAttributes attributes_;
     std::set<int> documents_id_;
+    std::uint64_t index_version_ = GetNextIndexVersion();
+
+    static std::uint64_t GetNextIndexVersion();
 
     bool IsStopWord(const std::string_view word) const;
 
     static bool IsValidWord(const std::string_view word);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    // Сортирует номера слов документа и считает частоты тем же сложением, что и раньше
+    DocumentTerms CountTerms(std::vector<TermId>& terms, double inv_word_count);
+
+    struct ParsedDocument {
+        // Слова документа по возрастанию и их частоты
+        std::vector<std::pair<std::string_view, double>> word_freqs;
+        // Номера слов: сначала в словаре своего диапазона, затем в словаре пакета
+        std::vector<std::size_t> batch_words;
+        double inv_word_count = 0.0;
+        std::exception_ptr error;
+    };
+
+    ParsedDocument ParseDocument(std::string_view text) const;
+
+    template <typename Policy>
+    void AddDocumentsBatch(const Policy& policy, const std::vector<DocumentToAdd>& documents);
+
+    void ReleaseTerms(const std::vector<TermId>& terms);
+
+    // Слова документа: свои или из снимка; для неизвестного id бросает std::out_of_range
+    TermFrequencies GetDocumentTerms(int document_id) const;
+
+    bool HasWord(const TermFrequencies& term_freqs, std::string_view word) const;
+
+    int GetDocumentIdBound() const;
+
+    // Предикат перегрузок со статусом. Отдельный тип позволяет поиску не вызывать его
+    // на каждое вхождение, а наложить маску статуса на кандидатов
+    struct DocumentStatusPredicate {
+        DocumentStatus status;
+
+        bool operator()(int, DocumentStatus document_status, int) const {
+            return document_status == status;
+        }
+    };
+
+    template <typename DocumentPredicate>
+    bool IsAccepted(const DocumentPredicate& document_predicate, int document_id) const {
+        return document_predicate(document_id, attributes_.GetStatus(document_id), attributes_.GetRating(document_id));
+    }
+
+    bool IsAccepted(const DocumentStatusPredicate& document_predicate, int document_id) const {
+        return attributes_.HasStatus(document_id, document_predicate.status);
+    }
+
     struct QueryWord {
         std::string_view word;
         bool is_minus;
+        bool is_required;
         bool is_stop;
     };
 
     QueryWord ParseQueryWord(std::string_view text) const;
 
+    // Запрос и всё временное при его обработке живёт в арене потока (GetThreadQueryScratch),
+    // поэтому обработка запроса должна идти внутри QueryScratchScope
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        explicit Query(std::pmr::memory_resource* resource)
+                : plus_words(resource)
+                , minus_words(resource)
+                , required_words(resource) {
+        }
+
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
+        // Слова с '+': документ должен содержать их все. Они же есть и среди плюс-слов
+        std::pmr::vector<std::string_view> required_words;
     };
 
     Query ParseQuery(std::string_view text, bool is_parallel_policy = false) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    // Список вхождений слова запроса в одном сегменте индекса
+    struct SegmentPostings {
+        const PostingList* postings;
+        const IndexSegment* segment;
+        // Номер слова среди плюс-слов и его IDF
+        std::size_t word;
+        double inverse_document_freq;
+        // Квантованные вклады вхождений или nullptr
+        const std::uint16_t* impacts;
+        // Документы списка битовым множеством или nullptr, если слово в сегменте редкое
+        const DocumentBitmap* bitmap;
+    };
+
+    // Списки вхождений слов запроса по всем сегментам; списки плюс-слов идут в порядке слов,
+    // у обязательных слов word - номер среди обязательных
+    struct QueryPostings {
+        explicit QueryPostings(std::pmr::memory_resource* resource)
+                : plus(resource)
+                , minus(resource)
+                , required(resource) {
+        }
+
+        std::pmr::vector<SegmentPostings> plus;
+        std::pmr::vector<SegmentPostings> minus;
+        std::pmr::vector<SegmentPostings> required;
+        std::size_t plus_word_count = 0;
+        std::size_t required_word_count = 0;
+    };
+
+    // inverse_document_freqs - IDF плюс-слов из SearchOptions или nullptr
+    QueryPostings FindQueryPostings(const Query& query,
+                                    const std::vector<double>* inverse_document_freqs = nullptr) const;
+
+    // Исключает из аккумулятора документы диапазона с минус-словами и без какого-либо
+    // обязательного слова. Частые слова накладываются битовыми множествами целыми словами
+    void ExcludeDocuments(const QueryPostings& query_postings, int range_begin, int range_end,
+                          RelevanceAccumulator& accumulator) const;
+
+    // Список вхождений слова пачки запросов в одном сегменте и маска запросов с этим словом
+    struct SharedPostings {
+        const PostingList* postings;
+        const IndexSegment* segment;
+        double inverse_document_freq;
+        std::uint64_t query_mask;
+    };
+
+    // Списки слов пачки до kMaxSharedScanQueries запросов; плюс-слова идут по возрастанию,
+    // то есть в том же порядке, что и в каждом запросе
+    struct SharedScanPostings {
+        explicit SharedScanPostings(std::pmr::memory_resource* resource)
+                : plus(resource)
+                , minus(resource)
+                , required(resource)
+                , required_counts(kMaxSharedScanQueries, 0, resource) {
+        }
+
+        std::pmr::vector<SharedPostings> plus;
+        std::pmr::vector<SharedPostings> minus;
+        std::pmr::vector<SharedPostings> required;
+        // Число обязательных слов каждого запроса и маска запросов, где они есть
+        std::pmr::vector<std::uint16_t> required_counts;
+        std::uint64_t required_queries = 0;
+    };
+
+    SharedScanPostings FindSharedScanPostings(const std::string* raw_queries, std::size_t query_count) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&,
-                                           const Query& query,
-                                           DocumentPredicate document_predicate) const;
+    void ScoreSharedScan(const SharedScanPostings& scan_postings,
+                         DocumentPredicate document_predicate,
+                         TopDocumentsCollector* collectors) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&,
-                                           const Query& query,
-                                           DocumentPredicate document_predicate) const;
+    void FindAllDocuments(const std::execution::sequenced_policy&,
+                          const Query& query,
+                          DocumentPredicate document_predicate,
+                          const SearchOptions& options,
+                          TopDocumentsCollector& collector) const;
+
+    template <typename DocumentPredicate>
+    void FindAllDocuments(const std::execution::parallel_policy&,
+                          const Query& query,
+                          DocumentPredicate document_predicate,
+                          const SearchOptions& options,
+                          TopDocumentsCollector& collector) const;
+
+    template <typename DocumentPredicate>
+    void FindDocumentsInRange(const QueryPostings& query_postings, int range_begin, int range_end,
+                              DocumentPredicate document_predicate,
+                              QueryEvaluation evaluation,
+                              TopDocumentsCollector& collector) const;
+
+    template <typename DocumentPredicate>
+    void ScoreAllPostings(const QueryPostings& query_postings, int range_begin, int range_end,
+                          DocumentPredicate document_predicate,
+                          RelevanceAccumulator& accumulator,
+                          TopDocumentsCollector& collector) const;
+
+    template <typename DocumentPredicate>
+    void ScoreQuantized(const QueryPostings& query_postings, int range_begin, int range_end,
+                        DocumentPredicate document_predicate,
+                        RelevanceAccumulator& accumulator,
+                        TopDocumentsCollector& collector) const;
+
+    template <typename DocumentPredicate>
+    void ScoreWand(const QueryPostings& query_postings, int range_begin, int range_end,
+                   DocumentPredicate document_predicate,
+                   const RelevanceAccumulator& accumulator,
+                   TopDocumentsCollector& collector) const;
 };
 
 template <typename StringContainer>
@@ -136,9 +405,7 @@ template <typename Policy>
 std::vector<Document> SearchServer::FindTopDocuments(const Policy& policy,
                                                      std::string_view raw_query,
                                                      DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+    return FindTopDocuments(policy, raw_query, status, SearchOptions{});
 }
 
 template <typename Policy>
@@ -151,102 +418,420 @@ template <typename DocumentPredicate, typename Policy>
 std::vector<Document> SearchServer::FindTopDocuments(const Policy& policy,
                                        std::string_view raw_query,
                                        DocumentPredicate document_predicate) const {
-    Query query = ParseQuery(raw_query);
+    return FindTopDocuments(policy, raw_query, document_predicate, SearchOptions{});
+}
 
-    std::vector<Document> matched_documents = FindAllDocuments(policy, query, document_predicate);
+template <typename Policy>
+std::vector<Document> SearchServer::FindTopDocuments(const Policy& policy,
+                                                     std::string_view raw_query,
+                                                     DocumentStatus status,
+                                                     const SearchOptions& options) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatusPredicate{status}, options);
+}
 
-    auto it = next(matched_documents.begin(), (matched_documents.size() > kMaxResultDocumentCount) ? kMaxResultDocumentCount : matched_documents.size());
+// Найденные документы не складываются в общий вектор, а сразу проходят через
+// ограниченную кучу, поэтому память запроса зависит от K, а не от числа совпадений
+template <typename DocumentPredicate, typename Policy>
+std::vector<Document> SearchServer::FindTopDocuments(const Policy& policy,
+                                                     std::string_view raw_query,
+                                                     DocumentPredicate document_predicate,
+                                                     const SearchOptions& options) const {
+    QueryScratchScope scratch_scope;
+    Query query = MeasureQueryPhase(QueryPhase::PARSE, [&] {
+        return ParseQuery(raw_query);
+    });
 
-    std::partial_sort(policy, matched_documents.begin(), it, matched_documents.end(),
-                      [&](const Document& lhs, const Document& rhs) {
-                          if (std::abs(lhs.relevance - rhs.relevance) < kEpsilon) {
-                              return lhs.rating > rhs.rating;
-                          }
+    TopDocumentsCollector collector(options.max_result_count, GetThreadQueryScratch());
+    FindAllDocuments(policy, query, document_predicate, options, collector);
 
-                          return lhs.relevance > rhs.relevance;
-                      });
+    return MeasureQueryPhase(QueryPhase::RESULT_BUILD, [&] {
+        return collector.Extract();
+    });
+}
 
-    if (matched_documents.size() > kMaxResultDocumentCount) {
-        matched_documents.resize(kMaxResultDocumentCount);
+template <typename DocumentPredicate>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                                       DocumentPredicate document_predicate,
+                                                                       const SearchOptions& options) const {
+    std::vector<std::vector<Document>> documents;
+    documents.reserve(raw_queries.size());
+    for (std::size_t first = 0; first < raw_queries.size(); first += kMaxSharedScanQueries) {
+        QueryScratchScope scratch_scope;
+        const std::size_t query_count = std::min(kMaxSharedScanQueries, raw_queries.size() - first);
+        const SharedScanPostings scan_postings = FindSharedScanPostings(raw_queries.data() + first, query_count);
+
+        std::pmr::vector<TopDocumentsCollector> collectors(GetThreadQueryScratch());
+        collectors.reserve(query_count);
+        for (std::size_t i = 0; i < query_count; ++i) {
+            collectors.emplace_back(options.max_result_count, GetThreadQueryScratch());
+        }
+        ScoreSharedScan(scan_postings, document_predicate, collectors.data());
+        for (TopDocumentsCollector& collector : collectors) {
+            documents.push_back(collector.Extract());
+        }
     }
-
-    return matched_documents;
+    return documents;
 }
 
+// Документы обходятся блоками по возрастанию id. В блоке у документа есть маски
+// запросов, где он набрал вклад и где исключён минус-словом, и по ячейке на запрос.
+// Предикат проверяется один раз на документ, а не на каждое вхождение каждого запроса.
+// Для запросов с обязательными словами ещё считается, сколько из них нашлось в документе
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&,
-                                                     const Query& query,
-                                                     DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string_view &word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+void SearchServer::ScoreSharedScan(const SharedScanPostings& scan_postings,
+                                   DocumentPredicate document_predicate,
+                                   TopDocumentsCollector* collectors) const {
+    constexpr int kBlockSize = kSharedScanBlockSize;
+    constexpr std::size_t kQueryCount = kMaxSharedScanQueries;
+    const int id_bound = GetDocumentIdBound();
+    std::pmr::memory_resource* scratch = GetThreadQueryScratch();
+
+    std::pmr::vector<PostingCursor> minus_cursors(scratch);
+    minus_cursors.reserve(scan_postings.minus.size());
+    for (const SharedPostings& minus : scan_postings.minus) {
+        minus_cursors.push_back(index_.GetCursor(*minus.postings, 0, id_bound));
+    }
+    std::pmr::vector<PostingCursor> plus_cursors(scratch);
+    plus_cursors.reserve(scan_postings.plus.size());
+    for (const SharedPostings& plus : scan_postings.plus) {
+        plus_cursors.push_back(index_.GetCursor(*plus.postings, 0, id_bound));
+    }
+    std::pmr::vector<PostingCursor> required_cursors(scratch);
+    required_cursors.reserve(scan_postings.required.size());
+    for (const SharedPostings& required : scan_postings.required) {
+        required_cursors.push_back(index_.GetCursor(*required.postings, 0, id_bound));
+    }
+
+    // Проверен ли документ блока предикатом и прошёл ли его
+    std::pmr::vector<char> is_checked(kBlockSize, false, scratch);
+    std::pmr::vector<char> is_accepted(kBlockSize, false, scratch);
+    std::pmr::vector<std::uint64_t> touched(kBlockSize, 0, scratch);
+    std::pmr::vector<std::uint64_t> excluded(kBlockSize, 0, scratch);
+    std::pmr::vector<double> relevance(kBlockSize * kQueryCount, 0.0, scratch);
+    const bool has_required = scan_postings.required_queries != 0;
+    std::pmr::vector<std::uint64_t> required_touched(has_required ? kBlockSize : 0, 0, scratch);
+    std::pmr::vector<std::uint16_t> required_matches(has_required ? kBlockSize * kQueryCount : 0, 0, scratch);
+
+    for (int block_begin = 0; block_begin < id_bound; block_begin += kBlockSize) {
+        const int block_end = std::min(id_bound, block_begin + kBlockSize);
+        for (std::size_t i = 0; i < minus_cursors.size(); ++i) {
+            PostingCursor& cursor = minus_cursors[i];
+            for (; !cursor.IsEnd() && cursor.DocumentId() < block_end; cursor.Next()) {
+                if (!scan_postings.minus[i].segment->IsDeleted(cursor.DocumentId())) {
+                    excluded[cursor.DocumentId() - block_begin] |= scan_postings.minus[i].query_mask;
+                }
             }
         }
-    }
-    for (const std::string_view& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+        for (std::size_t i = 0; i < required_cursors.size(); ++i) {
+            const auto [postings, segment, inverse_document_freq, query_mask] = scan_postings.required[i];
+            PostingCursor& cursor = required_cursors[i];
+            for (; !cursor.IsEnd() && cursor.DocumentId() < block_end; cursor.Next()) {
+                const int offset = cursor.DocumentId() - block_begin;
+                if (segment->IsDeleted(cursor.DocumentId())) {
+                    continue;
+                }
+                required_touched[offset] |= query_mask;
+                for (std::uint64_t queries = query_mask; queries != 0; queries &= queries - 1) {
+                    ++required_matches[offset * kQueryCount + __builtin_ctzll(queries)];
+                }
+            }
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        for (std::size_t i = 0; i < plus_cursors.size(); ++i) {
+            const auto [postings, segment, inverse_document_freq, query_mask] = scan_postings.plus[i];
+            PostingCursor& cursor = plus_cursors[i];
+            for (; !cursor.IsEnd() && cursor.DocumentId() < block_end; cursor.Next()) {
+                const int document_id = cursor.DocumentId();
+                const int offset = document_id - block_begin;
+                std::uint64_t queries = query_mask & ~excluded[offset];
+                if (queries == 0 || segment->IsDeleted(document_id)) {
+                    continue;
+                }
+                if (!is_checked[offset]) {
+                    is_checked[offset] = true;
+                    is_accepted[offset] = IsAccepted(document_predicate, document_id);
+                }
+                if (!is_accepted[offset]) {
+                    continue;
+                }
+                const double term_relevance = cursor.TermFreq() * inverse_document_freq;
+                touched[offset] |= queries;
+                for (; queries != 0; queries &= queries - 1) {
+                    relevance[offset * kQueryCount + __builtin_ctzll(queries)] += term_relevance;
+                }
+            }
+        }
+        for (int offset = 0; offset < block_end - block_begin; ++offset) {
+            for (std::uint64_t queries = touched[offset]; queries != 0; queries &= queries - 1) {
+                const std::size_t query = __builtin_ctzll(queries);
+                double& document_relevance = relevance[offset * kQueryCount + query];
+                if ((scan_postings.required_queries >> query & 1) == 0
+                    || required_matches[offset * kQueryCount + query] == scan_postings.required_counts[query]) {
+                    collectors[query].Add({block_begin + offset, document_relevance,
+                                           attributes_.GetRating(block_begin + offset)});
+                }
+                document_relevance = 0.0;
+            }
+            if (has_required) {
+                for (std::uint64_t queries = required_touched[offset]; queries != 0; queries &= queries - 1) {
+                    required_matches[offset * kQueryCount + __builtin_ctzll(queries)] = 0;
+                }
+                required_touched[offset] = 0;
+            }
+            touched[offset] = 0;
+            excluded[offset] = 0;
+            is_checked[offset] = false;
+        }
+    }
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocuments(const std::execution::sequenced_policy&,
+                                    const Query& query,
+                                    DocumentPredicate document_predicate,
+                                    const SearchOptions& options,
+                                    TopDocumentsCollector& collector) const {
+    const QueryPostings query_postings = MeasureQueryPhase(QueryPhase::POSTING_SCAN, [&] {
+        return FindQueryPostings(query, options.inverse_document_freqs);
+    });
+    FindDocumentsInRange(query_postings, 0, GetDocumentIdBound(), document_predicate, options.evaluation, collector);
+}
+
+// Диапазон id делится на части, и каждая часть считается целиком в аккумуляторе
+// своего потока: ни одно вхождение не пишется в общую память, блокировки не нужны
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocuments(const std::execution::parallel_policy&,
+                                    const Query& query,
+                                    DocumentPredicate document_predicate,
+                                    const SearchOptions& options,
+                                    TopDocumentsCollector& collector) const {
+    const QueryPostings query_postings = MeasureQueryPhase(QueryPhase::POSTING_SCAN, [&] {
+        return FindQueryPostings(query, options.inverse_document_freqs);
+    });
+
+    const int id_bound = GetDocumentIdBound();
+    const int max_range_count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) * 4;
+    const int range_count = std::max(1, std::min(max_range_count, id_bound / kMinParallelRangeSize));
+    std::pmr::vector<int> ranges(range_count, GetThreadQueryScratch());
+    std::iota(ranges.begin(), ranges.end(), 0);
+    // Кучи сборщиков резервируются здесь, в арене вызывающего потока, и в задачах не растут
+    std::pmr::vector<TopDocumentsCollector> range_collectors(GetThreadQueryScratch());
+    range_collectors.reserve(range_count);
+    for (int range = 0; range < range_count; ++range) {
+        range_collectors.emplace_back(collector.GetMaxCount(), GetThreadQueryScratch());
+    }
+
+    std::for_each(std::execution::par, ranges.begin(), ranges.end(), [&](int range) {
+        const int range_begin = static_cast<int>(static_cast<long long>(id_bound) * range / range_count);
+        const int range_end = static_cast<int>(static_cast<long long>(id_bound) * (range + 1) / range_count);
+        FindDocumentsInRange(query_postings, range_begin, range_end, document_predicate, options.evaluation,
+                             range_collectors[range]);
+    });
+
+    PROFILE_QUERY_PHASE(QueryPhase::TOP_K);
+    for (const TopDocumentsCollector& range_collector : range_collectors) {
+        collector.Merge(range_collector);
+    }
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindDocumentsInRange(const QueryPostings& query_postings, int range_begin, int range_end,
+                                        DocumentPredicate document_predicate,
+                                        QueryEvaluation evaluation,
+                                        TopDocumentsCollector& collector) const {
+    // Часть диапазона может считаться в другом потоке со своей ареной
+    QueryScratchScope scratch_scope;
+    RelevanceAccumulator& accumulator = GetThreadRelevanceAccumulator();
+    accumulator.Reset(range_end, evaluation == QueryEvaluation::QUANTIZED);
+    {
+        PROFILE_QUERY_PHASE(QueryPhase::POSTING_SCAN);
+        ExcludeDocuments(query_postings, range_begin, range_end, accumulator);
+        // Документы с другим статусом отсекаются словами маски, и дальше предикат не нужен
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+            accumulator.ExcludeMissing(attributes_.GetStatusMask(document_predicate.status), range_begin, range_end);
         }
     }
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    if (evaluation == QueryEvaluation::WAND) {
+        ScoreWand(query_postings, range_begin, range_end, document_predicate, accumulator, collector);
+    } else if (evaluation == QueryEvaluation::QUANTIZED) {
+        ScoreQuantized(query_postings, range_begin, range_end, document_predicate, accumulator, collector);
+    } else {
+        ScoreAllPostings(query_postings, range_begin, range_end, document_predicate, accumulator, collector);
     }
-    return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&,
-                                       const Query& query,
-                                       DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> concurrent_document_to_relevance(kMaxBucket);
-
-    std::for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-                  [&](const std::string_view &word) {
-        if (word_to_document_freqs_.count(word)) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            std::for_each(std::execution::par,
-                          word_to_document_freqs_.at(word).begin(),
-                          word_to_document_freqs_.at(word).end(),
-                          [&](const std::pair<int, double> &pair) {
-                const auto &document_data = documents_.at(pair.first);
-                if (document_predicate(pair.first, document_data.status,
-                                       document_data.rating)) {
-                    concurrent_document_to_relevance[pair.first].ref_to_value +=
-                            pair.second * inverse_document_freq;
-                }
-            });
+void SearchServer::ScoreAllPostings(const QueryPostings& query_postings, int range_begin, int range_end,
+                                    DocumentPredicate document_predicate,
+                                    RelevanceAccumulator& accumulator,
+                                    TopDocumentsCollector& collector) const {
+    // Документ живёт в одном сегменте, поэтому вклады слова по-прежнему приходят по одному
+    {
+        PROFILE_QUERY_PHASE(QueryPhase::SCORING);
+        for (const auto [postings, segment, word, inverse_document_freq, impacts, bitmap] : query_postings.plus) {
+            for (PostingCursor cursor = index_.GetCursor(*postings, range_begin, range_end); !cursor.IsEnd();
+                 cursor.Next()) {
+                const int document_id = cursor.DocumentId();
+                if (segment->IsDeleted(document_id) || accumulator.IsExcluded(document_id)) {
+                    continue;
+                }
+                if constexpr (!std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+                    if (!IsAccepted(document_predicate, document_id)) {
+                        continue;
+                    }
+                }
+                accumulator.Add(document_id, cursor.TermFreq() * inverse_document_freq);
+            }
         }
+    }
+    PROFILE_QUERY_PHASE(QueryPhase::TOP_K);
+    accumulator.ForEach([&](int document_id, double relevance) {
+        collector.Add({document_id, relevance, attributes_.GetRating(document_id)});
     });
+}
 
-    std::for_each(std::execution::par, query.minus_words.begin(), query.minus_words.end(),
-                  [&](const std::string_view &word) {
-        if (word_to_document_freqs_.count(word)) {
-            std::for_each(std::execution::par, word_to_document_freqs_.at(word).begin(),
-                          word_to_document_freqs_.at(word).end(),
-                          [&](const std::pair<int, double> &pair) {
-                concurrent_document_to_relevance.Erase(pair.first);
-            });
+template <typename DocumentPredicate>
+void SearchServer::ScoreQuantized(const QueryPostings& query_postings, int range_begin, int range_end,
+                                  DocumentPredicate document_predicate,
+                                  RelevanceAccumulator& accumulator,
+                                  TopDocumentsCollector& collector) const {
+    {
+        PROFILE_QUERY_PHASE(QueryPhase::SCORING);
+        for (const auto [postings, segment, word, inverse_document_freq, impacts, bitmap] : query_postings.plus) {
+            for (PostingCursor cursor = index_.GetCursor(*postings, range_begin, range_end); !cursor.IsEnd();
+                 cursor.Next()) {
+                const int document_id = cursor.DocumentId();
+                if (segment->IsDeleted(document_id) || accumulator.IsExcluded(document_id)) {
+                    continue;
+                }
+                if constexpr (!std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+                    if (!IsAccepted(document_predicate, document_id)) {
+                        continue;
+                    }
+                }
+                if (impacts != nullptr) {
+                    accumulator.AddImpact(document_id, impacts[cursor.Position()]);
+                } else {
+                    accumulator.Add(document_id, cursor.TermFreq() * inverse_document_freq);
+                }
+            }
         }
+    }
+    PROFILE_QUERY_PHASE(QueryPhase::TOP_K);
+    accumulator.ForEachQuantized(index_.GetImpactStep(), [&](int document_id, double relevance) {
+        collector.Add({document_id, relevance, attributes_.GetRating(document_id)});
     });
+}
 
-    std::map<int, double> document_to_relevance = std::move(concurrent_document_to_relevance.BuildOrdinaryMap());
-
-    std::vector<Document> matched_documents(document_to_relevance.size());
+// Курсоры плюс-слов держатся отсортированными по текущему id. Опорный документ -
+// первый, на котором сумма верхних границ вкладов превышает порог входа в топ;
+// все документы до него пропускаются без подсчёта
+template <typename DocumentPredicate>
+void SearchServer::ScoreWand(const QueryPostings& query_postings, int range_begin, int range_end,
+                             DocumentPredicate document_predicate,
+                             const RelevanceAccumulator& accumulator,
+                             TopDocumentsCollector& collector) const {
+    if (collector.GetMaxCount() == 0) {
+        return;
+    }
+    PROFILE_QUERY_PHASE(QueryPhase::SCORING);
+    // Курсор на каждый список слова в каждом сегменте; term - номер плюс-слова
+    struct TermCursor {
+        // Текущий id курсора, чтобы сравнения при сортировке не обращались к самому курсору
+        int document_id;
+        double inverse_document_freq;
+        double max_relevance;
+        std::size_t term;
+        const IndexSegment* segment;
+        PostingCursor cursor;
+
+        void Update() {
+            document_id = cursor.IsEnd() ? std::numeric_limits<int>::max() : cursor.DocumentId();
+        }
+    };
+    // Курсоры переставляются по указателям: сам курсор хранит распакованный блок
+    std::pmr::memory_resource* scratch = GetThreadQueryScratch();
+    std::pmr::vector<TermCursor> term_cursors(scratch);
+    term_cursors.reserve(query_postings.plus.size());
+    for (const auto [postings, segment, word, inverse_document_freq, impacts, bitmap] : query_postings.plus) {
+        term_cursors.push_back({0, inverse_document_freq, postings->GetMaxTermFreq() * inverse_document_freq, word,
+                                segment, index_.GetCursor(*postings, range_begin, range_end)});
+        term_cursors.back().Update();
+    }
+    std::pmr::vector<TermCursor*> cursors(scratch);
+    std::pmr::vector<TermCursor*> merged_cursors(scratch);
+    for (TermCursor& term_cursor : term_cursors) {
+        if (!term_cursor.cursor.IsEnd()) {
+            cursors.push_back(&term_cursor);
+        }
+    }
+    const auto by_document_id = [](const TermCursor* lhs, const TermCursor* rhs) {
+        return lhs->document_id < rhs->document_id;
+    };
+    std::sort(cursors.begin(), cursors.end(), by_document_id);
+
+    std::pmr::vector<double> term_relevance(query_postings.plus_word_count, scratch);
+    std::pmr::vector<std::size_t> matched_terms(scratch);
+    while (!cursors.empty()) {
+        // Документ, не превышающий худший в топе хотя бы на kEpsilon, в топ не попадёт
+        const double threshold = collector.IsFull()
+                                 ? collector.GetWorst().relevance - TopDocumentsCollector::kEpsilon
+                                 : -std::numeric_limits<double>::infinity();
+        double max_relevance = 0.0;
+        std::size_t pivot = 0;
+        for (; pivot < cursors.size(); ++pivot) {
+            max_relevance += cursors[pivot]->max_relevance;
+            if (max_relevance > threshold) {
+                break;
+            }
+        }
+        if (pivot == cursors.size()) {
+            break;
+        }
 
-    std::transform(std::execution::par, document_to_relevance.begin(), document_to_relevance.end(), matched_documents.begin(),
-                   [&] (const std::pair<int, double>& pair) {
-                       return Document{pair.first, pair.second, documents_.at(pair.first).rating};});
+        const int pivot_id = cursors[pivot]->document_id;
+        std::size_t moved = 0;
+        if (cursors.front()->document_id == pivot_id) {
+            while (moved < cursors.size() && cursors[moved]->document_id == pivot_id) {
+                ++moved;
+            }
+            // Вхождения удалённого документа остаются в сегменте, пока его не перепишет слияние
+            matched_terms.clear();
+            for (std::size_t i = 0; i < moved; ++i) {
+                if (!cursors[i]->segment->IsDeleted(pivot_id)) {
+                    term_relevance[cursors[i]->term] = cursors[i]->cursor.TermFreq() * cursors[i]->inverse_document_freq;
+                    matched_terms.push_back(cursors[i]->term);
+                }
+            }
+            if (!matched_terms.empty() && attributes_.Contains(pivot_id) && !accumulator.IsExcluded(pivot_id)
+                && IsAccepted(document_predicate, pivot_id)) {
+                // Вклады складываются в порядке слов запроса, как при полном подсчёте
+                std::sort(matched_terms.begin(), matched_terms.end());
+                double relevance = 0.0;
+                for (const std::size_t term : matched_terms) {
+                    relevance += term_relevance[term];
+                }
+                collector.Add({pivot_id, relevance, attributes_.GetRating(pivot_id)});
+            }
+            for (std::size_t i = 0; i < moved; ++i) {
+                cursors[i]->cursor.Next();
+                cursors[i]->Update();
+            }
+        } else {
+            moved = pivot;
+            for (std::size_t i = 0; i < moved; ++i) {
+                cursors[i]->cursor.Seek(pivot_id);
+                cursors[i]->Update();
+            }
+        }
 
-    return matched_documents;
+        // Сдвинулись только первые moved курсоров: сливаем их с отсортированным хвостом
+        std::sort(cursors.begin(), cursors.begin() + moved, by_document_id);
+        merged_cursors.clear();
+        std::merge(cursors.begin(), cursors.begin() + moved, cursors.begin() + moved, cursors.end(),
+                   std::back_inserter(merged_cursors), by_document_id);
+        cursors.swap(merged_cursors);
+        while (!cursors.empty() && cursors.back()->document_id == std::numeric_limits<int>::max()) {
+            cursors.pop_back();
+        }
+    }
 }
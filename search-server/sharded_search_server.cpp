@@ -0,0 +1,136 @@
+#include "sharded_search_server.h"
+
+#include <cmath>
+#include <exception>
+#include <mutex>
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words_text, std::size_t shard_count)
+        : ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count) {
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument(std::string("Invalid document_id"));
+    }
+    Shard& shard = *shards_[GetShardIndex(document_id)];
+    std::unique_lock lock(shard.mutex);
+    shard.server.AddDocument(GetLocalId(document_id), document, status, ratings);
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    std::vector<std::vector<DocumentToAdd>> shard_documents(shards_.size());
+    for (const DocumentToAdd& document : documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument(std::string("Invalid document_id"));
+        }
+        shard_documents[GetShardIndex(document.id)].push_back(
+                {GetLocalId(document.id), document.text, document.status, document.ratings});
+    }
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    for (std::size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (!shard_documents[shard].empty()) {
+            locks.emplace_back(shards_[shard]->mutex);
+        }
+    }
+
+    std::vector<std::exception_ptr> errors(shards_.size());
+    pool_->ParallelFor(shards_.size(), [&](std::size_t shard) {
+        if (shard_documents[shard].empty()) {
+            return;
+        }
+        try {
+            shards_[shard]->server.AddDocuments(shard_documents[shard]);
+        } catch (...) {
+            errors[shard] = std::current_exception();
+        }
+    });
+    const auto error = std::find_if(errors.begin(), errors.end(), [](const std::exception_ptr& shard_error) {
+        return shard_error != nullptr;
+    });
+    if (error == errors.end()) {
+        return;
+    }
+    // Шард с ошибкой не изменился, а остальные возвращаются к прежнему состоянию
+    for (std::size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (errors[shard] == nullptr) {
+            for (const DocumentToAdd& document : shard_documents[shard]) {
+                shards_[shard]->server.RemoveDocument(document.id);
+            }
+        }
+    }
+    std::rethrow_exception(*error);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    Shard& shard = *shards_[GetShardIndex(document_id)];
+    std::unique_lock lock(shard.mutex);
+    shard.server.RemoveDocument(GetLocalId(document_id));
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                            const SearchOptions& options) const {
+    return ScatterGather(raw_query, options, [&raw_query, status](
+            const SearchServer& server, std::size_t, const SearchOptions& shard_options) {
+        return server.FindTopDocuments(std::execution::seq, raw_query, status, shard_options);
+    });
+}
+
+SearchServer::MatchedDocuments ShardedSearchServer::MatchDocument(std::string_view raw_query,
+                                                                  int document_id) const {
+    if (document_id < 0) {
+        throw std::out_of_range(std::string("Invalid document_id"));
+    }
+    const Shard& shard = *shards_[GetShardIndex(document_id)];
+    std::shared_lock lock(shard.mutex);
+    return shard.server.MatchDocument(raw_query, GetLocalId(document_id));
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock lock(shard->mutex);
+        document_count += shard->server.GetDocumentCount();
+    }
+    return document_count;
+}
+
+std::size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+std::size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    return static_cast<std::size_t>(document_id) % shards_.size();
+}
+
+int ShardedSearchServer::GetLocalId(int document_id) const {
+    return static_cast<int>(static_cast<std::size_t>(document_id) / shards_.size());
+}
+
+int ShardedSearchServer::GetGlobalId(int local_id, std::size_t shard) const {
+    return static_cast<int>(static_cast<std::size_t>(local_id) * shards_.size() + shard);
+}
+
+std::vector<double> ShardedSearchServer::ComputeInverseDocumentFreqs(std::string_view raw_query) const {
+    std::size_t document_count = 0;
+    std::vector<std::size_t> document_freqs;
+    for (const auto& shard : shards_) {
+        const SearchServer::TermStatistics statistics = shard->server.GetTermStatistics(raw_query);
+        document_count += statistics.document_count;
+        document_freqs.resize(statistics.document_freqs.size(), 0);
+        for (std::size_t i = 0; i < document_freqs.size(); ++i) {
+            document_freqs[i] += statistics.document_freqs[i];
+        }
+    }
+    // Так же, как один сервер считает IDF по своим документам
+    std::vector<double> inverse_document_freqs(document_freqs.size(), 0.0);
+    for (std::size_t i = 0; i < document_freqs.size(); ++i) {
+        if (document_freqs[i] > 0) {
+            inverse_document_freqs[i] = std::log(document_count * 1.0 / document_freqs[i]);
+        }
+    }
+    return inverse_document_freqs;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "document.h"
+#include "search_options.h"
+#include "search_server.h"
+#include "top_documents_collector.h"
+#include "work_stealing_pool.h"
+
+// Сервер из независимых шардов: документ id лежит в шарде id % N под местным id id / N,
+// так что id внутри шарда остаются плотными. У каждого шарда своя блокировка, и запись
+// в разные шарды идёт параллельно. Запрос рассылается всем шардам в пуле потоков, и их
+// лучшие K документов сливаются в общий топ. IDF считается по сумме документных частот
+// всех шардов, поэтому релевантность та же, что у одного сервера со всеми документами
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer& stop_words, std::size_t shard_count);
+
+    ShardedSearchServer(const std::string& stop_words_text, std::size_t shard_count);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    // Пакет делится по шардам, и шарды пополняются параллельно. При ошибке в любом
+    // документе не добавляется ни один: уже пополненные шарды откатываются
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    void RemoveDocument(int document_id);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           const SearchOptions& options = {}) const;
+
+    // Предикат получает общий id документа
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           const SearchOptions& options = {}) const;
+
+    SearchServer::MatchedDocuments MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    std::size_t GetShardCount() const;
+
+    std::size_t GetShardIndex(int document_id) const;
+
+private:
+    struct Shard {
+        template <typename StopWords>
+        explicit Shard(const StopWords& stop_words)
+                : server(stop_words) {
+        }
+
+        mutable std::shared_mutex mutex;
+        SearchServer server;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::unique_ptr<WorkStealingPool> pool_;
+
+    int GetLocalId(int document_id) const;
+
+    int GetGlobalId(int local_id, std::size_t shard) const;
+
+    // Блокирует все шарды на чтение, считает общий IDF слов запроса, вызывает
+    // find(shard_server, shard, shard_options) в каждом шарде и сливает результаты
+    template <typename Function>
+    std::vector<Document> ScatterGather(std::string_view raw_query, const SearchOptions& options,
+                                        Function find) const;
+
+    std::vector<double> ComputeInverseDocumentFreqs(std::string_view raw_query) const;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer& stop_words, std::size_t shard_count)
+        : pool_(std::make_unique<WorkStealingPool>(
+                std::max<std::size_t>(1, std::min<std::size_t>(shard_count, std::thread::hardware_concurrency())))) {
+    if (shard_count == 0) {
+        throw std::invalid_argument(std::string("Shard count must be positive"));
+    }
+    shards_.reserve(shard_count);
+    for (std::size_t shard = 0; shard < shard_count; ++shard) {
+        shards_.push_back(std::make_unique<Shard>(stop_words));
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentPredicate document_predicate,
+                                                            const SearchOptions& options) const {
+    return ScatterGather(raw_query, options, [this, &raw_query, &document_predicate](
+            const SearchServer& server, std::size_t shard, const SearchOptions& shard_options) {
+        return server.FindTopDocuments(std::execution::seq, raw_query,
+                                       [this, shard, &document_predicate](int document_id, DocumentStatus status,
+                                                                          int rating) {
+                                           return document_predicate(GetGlobalId(document_id, shard), status, rating);
+                                       },
+                                       shard_options);
+    });
+}
+
+template <typename Function>
+std::vector<Document> ShardedSearchServer::ScatterGather(std::string_view raw_query, const SearchOptions& options,
+                                                         Function find) const {
+    // Шарды блокируются по порядку, как и при пакетной записи, поэтому взаимных блокировок нет
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    const std::vector<double> inverse_document_freqs = ComputeInverseDocumentFreqs(raw_query);
+    SearchOptions shard_options = options;
+    shard_options.inverse_document_freqs = &inverse_document_freqs;
+
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    pool_->ParallelFor(shards_.size(), [&](std::size_t shard) {
+        shard_documents[shard] = find(shards_[shard]->server, shard, shard_options);
+    });
+
+    TopDocumentsCollector collector(options.max_result_count);
+    for (std::size_t shard = 0; shard < shards_.size(); ++shard) {
+        for (Document document : shard_documents[shard]) {
+            document.id = GetGlobalId(document.id, shard);
+            collector.Add(document);
+        }
+    }
+    return collector.Extract();
+}
@@ -0,0 +1,110 @@
+#include "sorted_intersection.h"
+
+#include <algorithm>
+#include <cstdint>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Во сколько раз длинный массив должен быть длиннее, чтобы искать в нём галопом
+constexpr std::size_t kGallopRatio = 32;
+
+#if defined(__AVX2__)
+constexpr std::size_t kLaneCount = 8;
+
+// Номер элемента блока, равного value, или kLaneCount; в маске по 4 бита на элемент
+std::size_t FindInBlock(const int* block, int value) {
+    const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    const std::uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(lanes, _mm256_set1_epi32(value)));
+    return mask == 0 ? kLaneCount : __builtin_ctz(mask) / 4;
+}
+#elif defined(__SSE2__)
+constexpr std::size_t kLaneCount = 4;
+
+std::size_t FindInBlock(const int* block, int value) {
+    const __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    const std::uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi32(lanes, _mm_set1_epi32(value)));
+    return mask == 0 ? kLaneCount : __builtin_ctz(mask) / 4;
+}
+#else
+constexpr std::size_t kLaneCount = 4;
+
+std::size_t FindInBlock(const int* block, int value) {
+    std::size_t lane = 0;
+    while (lane < kLaneCount && block[lane] != value) {
+        ++lane;
+    }
+    return lane;
+}
+#endif
+
+// Первая позиция не меньше pos, где large[i] >= value: шаги удваиваются, затем двоичный поиск
+std::size_t Gallop(const int* large, std::size_t large_size, std::size_t pos, int value) {
+    std::size_t step = 1;
+    std::size_t low = pos;
+    while (pos + step < large_size && large[pos + step] < value) {
+        low = pos + step;
+        step *= 2;
+    }
+    const std::size_t high = std::min(pos + step + 1, large_size);
+    return std::lower_bound(large + low, large + high, value) - large;
+}
+
+// Вызывает on_match(i, j) для пар small[i] == large[j]
+template <typename Function>
+void Intersect(const int* small, std::size_t small_size, const int* large, std::size_t large_size,
+               Function on_match) {
+    std::size_t pos = 0;
+    if (large_size >= small_size * kGallopRatio) {
+        for (std::size_t i = 0; i < small_size && pos < large_size; ++i) {
+            pos = Gallop(large, large_size, pos, small[i]);
+            if (pos < large_size && large[pos] == small[i]) {
+                on_match(i, pos);
+            }
+        }
+        return;
+    }
+    for (std::size_t i = 0; i < small_size; ++i) {
+        const int value = small[i];
+        // Блоки, целиком меньшие value, пропускаются по последнему элементу
+        while (pos + kLaneCount <= large_size && large[pos + kLaneCount - 1] < value) {
+            pos += kLaneCount;
+        }
+        if (pos + kLaneCount <= large_size) {
+            const std::size_t lane = FindInBlock(large + pos, value);
+            if (lane < kLaneCount) {
+                on_match(i, pos + lane);
+            }
+            continue;
+        }
+        while (pos < large_size && large[pos] < value) {
+            ++pos;
+        }
+        if (pos == large_size) {
+            return;
+        }
+        if (large[pos] == value) {
+            on_match(i, pos);
+        }
+    }
+}
+
+}  // namespace
+
+void IntersectSorted(const int* documents, std::size_t document_count,
+                     const int* postings, std::size_t posting_count,
+                     std::vector<std::size_t>& matches) {
+    if (document_count <= posting_count) {
+        Intersect(documents, document_count, postings, posting_count, [&matches](std::size_t i, std::size_t) {
+            matches.push_back(i);
+        });
+    } else {
+        Intersect(postings, posting_count, documents, document_count, [&matches](std::size_t, std::size_t j) {
+            matches.push_back(j);
+        });
+    }
+}
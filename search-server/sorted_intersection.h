@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Дописывает в matches номера элементов documents, которые есть и в postings; оба
+// массива строго возрастают. Каждый элемент короткого массива ищется в длинном: при
+// большой разнице длин галопом, иначе проходом по блокам, где элемент сравнивается
+// со всем блоком одной векторной инструкцией
+void IntersectSorted(const int* documents, std::size_t document_count,
+                     const int* postings, std::size_t posting_count,
+                     std::vector<std::size_t>& matches);
@@ -1,14 +1,132 @@
 #include "string_processing.h"
 
-std::vector<std::string_view> SplitIntoWords(std::string_view str) {
-    std::vector<std::string_view> result;
-    str.remove_prefix(std::min(str.find_first_not_of(" "), str.size()));
+#include <cstdint>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Маски считаются сразу для блока байт: бит i отвечает байту i блока.
+// Управляющие символы - байты 0..31, у них три старших бита нулевые
+#if defined(__AVX2__)
+constexpr std::size_t kChunkSize = 32;
+
+std::uint64_t GetSpaceMask(const char* data) {
+    const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '))));
+}
+
+bool HasControlCharsInChunk(const char* data) {
+    const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i high_bits = _mm256_and_si256(chunk, _mm256_set1_epi8(static_cast<char>(0xE0)));
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(high_bits, _mm256_setzero_si256())) != 0;
+}
+#elif defined(__SSE2__)
+constexpr std::size_t kChunkSize = 16;
+
+std::uint64_t GetSpaceMask(const char* data) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '))));
+}
+
+bool HasControlCharsInChunk(const char* data) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i high_bits = _mm_and_si128(chunk, _mm_set1_epi8(static_cast<char>(0xE0)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(high_bits, _mm_setzero_si128())) != 0;
+}
+#else
+constexpr std::size_t kChunkSize = 8;
+
+std::uint64_t GetSpaceMask(const char* data) {
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < kChunkSize; ++i) {
+        mask |= static_cast<std::uint64_t>(data[i] == ' ') << i;
+    }
+    return mask;
+}
+
+bool HasControlCharsInChunk(const char* data) {
+    bool has_control_chars = false;
+    for (std::size_t i = 0; i < kChunkSize; ++i) {
+        has_control_chars |= (static_cast<unsigned char>(data[i]) & 0xE0) == 0;
+    }
+    return has_control_chars;
+}
+#endif
+
+int CountTrailingZeros(std::uint64_t mask) {
+    return __builtin_ctzll(mask);
+}
 
-    while (str.size() != str.npos && !str.empty()) {
-        result.push_back(str.substr(0u, str.find(' ')));
-        str.remove_prefix(std::min(str.find(" "), str.size()));
-        str.remove_prefix(std::min(str.find_first_not_of(" "), str.size()));
+}  // namespace
+
+void SplitIntoWords(std::string_view text, std::vector<std::string_view>& words) {
+    words.clear();
+    const char* data = text.data();
+    bool is_in_word = false;
+    std::size_t word_begin = 0;
+
+    // Слова ищутся по переходам между пробелами и не пробелами внутри маски блока
+    const auto split_chunk = [&](std::size_t chunk_begin, std::uint64_t spaces, std::uint64_t chunk_mask) {
+        std::uint64_t non_spaces = ~spaces & chunk_mask;
+        while (true) {
+            if (!is_in_word) {
+                if (non_spaces == 0) {
+                    return;
+                }
+                const int i = CountTrailingZeros(non_spaces);
+                word_begin = chunk_begin + i;
+                is_in_word = true;
+                spaces &= ~std::uint64_t{0} << i;
+            } else {
+                if (spaces == 0) {
+                    return;
+                }
+                const int i = CountTrailingZeros(spaces);
+                words.push_back(text.substr(word_begin, chunk_begin + i - word_begin));
+                is_in_word = false;
+                non_spaces &= ~std::uint64_t{0} << i;
+            }
+        }
+    };
+
+    constexpr std::uint64_t kFullChunkMask = kChunkSize == 64 ? ~std::uint64_t{0}
+                                                              : (std::uint64_t{1} << kChunkSize) - 1;
+    std::size_t pos = 0;
+    for (; pos + kChunkSize <= text.size(); pos += kChunkSize) {
+        split_chunk(pos, GetSpaceMask(data + pos), kFullChunkMask);
+    }
+    std::uint64_t spaces = 0;
+    for (std::size_t i = pos; i < text.size(); ++i) {
+        spaces |= static_cast<std::uint64_t>(data[i] == ' ') << (i - pos);
     }
+    split_chunk(pos, spaces, (std::uint64_t{1} << (text.size() - pos)) - 1);
+    if (is_in_word) {
+        words.push_back(text.substr(word_begin));
+    }
+}
 
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    std::vector<std::string_view> result;
+    SplitIntoWords(text, result);
     return result;
 }
+
+bool HasControlChars(std::string_view text) {
+    const char* data = text.data();
+    std::size_t pos = 0;
+    for (; pos + kChunkSize <= text.size(); pos += kChunkSize) {
+        if (HasControlCharsInChunk(data + pos)) {
+            return true;
+        }
+    }
+    for (; pos < text.size(); ++pos) {
+        if ((static_cast<unsigned char>(data[pos]) & 0xE0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -8,6 +8,13 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+// Разбивает текст по пробелам в переданный буфер, сохраняя его ёмкость:
+// при повторном использовании буфера разбор не выделяет память
+void SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
+
+// Есть ли в тексте управляющие символы с кодами от 0 до 31
+bool HasControlChars(std::string_view text);
+
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
     std::set<std::string, std::less<>> non_empty_strings;
@@ -0,0 +1,80 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool ContainsTerm(const TermFrequencies& term_freqs, TermId term) {
+    return std::binary_search(term_freqs.terms, term_freqs.terms + term_freqs.size, term);
+}
+
+TermId TermDictionary::Intern(std::string_view word) {
+    const auto it = term_ids_.find(word);
+    if (it != term_ids_.end()) {
+        return it->second;
+    }
+    return Add(CopyToArena(word));
+}
+
+TermId TermDictionary::InternExternal(std::string_view word) {
+    const auto it = term_ids_.find(word);
+    if (it != term_ids_.end()) {
+        return it->second;
+    }
+    return Add(word);
+}
+
+TermId TermDictionary::Find(std::string_view word) const {
+    const auto it = term_ids_.find(word);
+    return it == term_ids_.end() ? kNoTerm : it->second;
+}
+
+std::string_view TermDictionary::GetWord(TermId term) const {
+    return words_[term];
+}
+
+void TermDictionary::Release(TermId term) {
+    term_ids_.erase(words_[term]);
+    words_[term] = std::string_view{};
+    free_terms_.push_back(term);
+}
+
+std::size_t TermDictionary::GetTermIdBound() const {
+    return words_.size();
+}
+
+std::size_t TermDictionary::size() const {
+    return term_ids_.size();
+}
+
+TermId TermDictionary::Add(std::string_view word) {
+    TermId term;
+    if (free_terms_.empty()) {
+        term = static_cast<TermId>(words_.size());
+        words_.push_back(word);
+    } else {
+        term = free_terms_.back();
+        free_terms_.pop_back();
+        words_[term] = word;
+    }
+    term_ids_.emplace(word, term);
+    return term;
+}
+
+std::string_view TermDictionary::CopyToArena(std::string_view word) {
+    char* data;
+    if (word.size() > kArenaChunkSize / 4) {
+        // Длинное слово получает собственный кусок, а текущий кусок продолжает заполняться
+        arena_chunks_.push_back(std::make_unique<char[]>(word.size()));
+        data = arena_chunks_.back().get();
+    } else {
+        if (word.size() > static_cast<std::size_t>(arena_end_ - arena_position_)) {
+            arena_chunks_.push_back(std::make_unique<char[]>(kArenaChunkSize));
+            arena_position_ = arena_chunks_.back().get();
+            arena_end_ = arena_position_ + kArenaChunkSize;
+        }
+        data = arena_position_;
+        arena_position_ += word.size();
+    }
+    std::memcpy(data, word.data(), word.size());
+    return {data, word.size()};
+}
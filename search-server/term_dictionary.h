@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using TermId = std::uint32_t;
+
+// Слова документа по возрастанию id и их частоты
+struct TermFrequencies {
+    const TermId* terms = nullptr;
+    const double* term_freqs = nullptr;
+    std::size_t size = 0;
+};
+
+// Есть ли слово среди слов документа
+bool ContainsTerm(const TermFrequencies& term_freqs, TermId term);
+
+// Словарь слов: каждому слову сопоставлен плотный номер, по которому ключуются
+// все индексы. Строки слов копируются в арену из больших кусков, поэтому
+// string_view на них остаются действительными, пока жив словарь
+class TermDictionary {
+public:
+    static constexpr TermId kNoTerm = std::numeric_limits<TermId>::max();
+
+    // Возвращает номер слова, заводя новый при первом появлении
+    TermId Intern(std::string_view word);
+
+    // То же без копирования строки: она должна жить дольше словаря
+    TermId InternExternal(std::string_view word);
+
+    // Номер слова или kNoTerm
+    TermId Find(std::string_view word) const;
+
+    std::string_view GetWord(TermId term) const;
+
+    // Освобождает номер слова для повторного использования; байты слова в арене
+    // не возвращаются, так что они копятся только с числом когда-либо виденных слов
+    void Release(TermId term);
+
+    // Все номера меньше этой границы
+    std::size_t GetTermIdBound() const;
+
+    std::size_t size() const;
+
+private:
+    static constexpr std::size_t kArenaChunkSize = 64 * 1024;
+
+    std::unordered_map<std::string_view, TermId> term_ids_;
+    std::vector<std::string_view> words_;
+    std::vector<TermId> free_terms_;
+    std::vector<std::unique_ptr<char[]>> arena_chunks_;
+    char* arena_position_ = nullptr;
+    char* arena_end_ = nullptr;
+
+    TermId Add(std::string_view word);
+
+    std::string_view CopyToArena(std::string_view word);
+};
@@ -3,8 +3,26 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include "benchmark_suite.h"
+#include "document_bitmap.h"
+#include "concurrent_search_server.h"
+#include "process_queries.h"
+#include "query_profiler.h"
+#include "query_result_cache.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
 #include "remove_duplicates.h"
+#include "request_queue.h"
+#include "work_stealing_pool.h"
 
 using namespace std;
 
@@ -46,7 +64,7 @@ void AssertImpl(bool value, const string& expr_str, const string& file, const st
 void TestGetWordFrequencies() {
     SearchServer server("in the"s);
     server.AddDocument(1, "fluffy cat fluffy tail"s,       DocumentStatus::ACTUAL, {1, 2, 3});
-    const map<string, double>& words_freq = server.GetWordFrequencies(1);
+    const map<string_view, double>& words_freq = server.GetWordFrequencies(1);
     const double epsilon = 1e-4;
     ASSERT_HINT(std::abs((words_freq.at("fluffy"s) - 2. / 4.) < epsilon),
                 "Word frequencies is not calculated correctly"s);
@@ -85,10 +103,1432 @@ void TestRemoveDuplicates() {
                       "Duplicate documents are incorrectly deleted"s);
 }
 
+void TestOutOfOrderAddAndRemove() {
+    SearchServer server("in the"s);
+    server.AddDocument(5, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "black cat"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+    server.RemoveDocument(5);
+    const auto documents = server.FindTopDocuments("cat white"s);
+    ASSERT_EQUAL_HINT(documents.size(), 2u, "Documents added out of order are not found"s);
+    ASSERT_EQUAL(documents[0].id, 3);
+    ASSERT_EQUAL(documents[1].id, 1);
+    server.RemoveDocument(execution::par, 1);
+    ASSERT_EQUAL_HINT(server.FindTopDocuments("cat"s).size(), 0u,
+                      "Removed document is still found"s);
+}
+
+void TestMinusWordsExcludeDocuments() {
+    SearchServer server("in the"s);
+    server.AddDocument(0, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(70, "black cat"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(130, "white dog"s, DocumentStatus::ACTUAL, {3});
+    for (int i = 0; i < 2; ++i) {
+        const auto documents = server.FindTopDocuments("cat dog -white"s);
+        ASSERT_EQUAL_HINT(documents.size(), 1u, "Minus words must exclude documents"s);
+        ASSERT_EQUAL(documents[0].id, 70);
+    }
+    ASSERT_EQUAL_HINT(server.FindTopDocuments("cat dog"s).size(), 3u,
+                      "Minus words of previous query must not affect the next one"s);
+}
+
+void TestParallelSearchMatchesSequential() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s};
+    SearchServer server("in the"s);
+    for (int id = 0; id < 5000; ++id) {
+        string text;
+        for (int i = 0; i < 4; ++i) {
+            text += words[(id * 7 + i * (id % 5 + 1)) % words.size()] + " "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+    for (const string& query : {"cat dog"s, "fluffy -white"s, "black tail -dog -cat"s}) {
+        const auto seq_documents = server.FindTopDocuments(execution::seq, query);
+        const auto par_documents = server.FindTopDocuments(execution::par, query);
+        ASSERT_EQUAL_HINT(seq_documents.size(), par_documents.size(),
+                          "Parallel search must find the same documents"s);
+        for (size_t i = 0; i < seq_documents.size(); ++i) {
+            ASSERT_EQUAL(seq_documents[i].id, par_documents[i].id);
+            ASSERT(std::abs(seq_documents[i].relevance - par_documents[i].relevance) < 1e-6);
+        }
+    }
+}
+
+void TestMaxResultCount() {
+    SearchServer server("in the"s);
+    for (int id = 0; id < 20; ++id) {
+        server.AddDocument(id, "cat"s + (id % 2 ? " dog"s : ""s), DocumentStatus::ACTUAL, {id});
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 5u);
+    SearchOptions options;
+    options.max_result_count = 12;
+    const auto documents = server.FindTopDocuments(execution::seq, "cat"s, DocumentStatus::ACTUAL, options);
+    ASSERT_EQUAL_HINT(documents.size(), 12u, "max_result_count must limit the result"s);
+    // Все документы одинаково релевантны, поэтому порядок задаёт рейтинг
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ASSERT_EQUAL(documents[i].rating, 19 - static_cast<int>(i));
+    }
+    options.max_result_count = 0;
+    ASSERT(server.FindTopDocuments(execution::par, "cat"s, DocumentStatus::ACTUAL, options).empty());
+}
+
+void TestWandMatchesExhaustiveSearch() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s,
+                                  "rat"s, "pet"s, "curly"s, "hair"s, "nasty"s};
+    SearchServer server("in the"s);
+    for (int id = 0; id < 3000; ++id) {
+        string text;
+        for (int i = 0; i < 3 + id % 6; ++i) {
+            text += words[(id * 13 + i * i * 7 + i * (id % 11)) % words.size()] + " "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 7});
+    }
+    const auto is_even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+    for (const string& query : {"cat dog white"s, "fluffy tail -white"s, "rat pet curly hair nasty -dog"s,
+                               "collar black cat dog white fluffy tail rat pet curly hair nasty"s}) {
+        for (const size_t max_result_count : {1u, 5u, 40u}) {
+            SearchOptions exhaustive;
+            exhaustive.max_result_count = max_result_count;
+            SearchOptions wand = exhaustive;
+            wand.evaluation = QueryEvaluation::WAND;
+            const auto expected = server.FindTopDocuments(execution::seq, query, is_even, exhaustive);
+            for (const auto& documents : {server.FindTopDocuments(execution::seq, query, is_even, wand),
+                                          server.FindTopDocuments(execution::par, query, is_even, wand)}) {
+                ASSERT_EQUAL_HINT(documents.size(), expected.size(), "WAND must find the same documents"s);
+                for (size_t i = 0; i < documents.size(); ++i) {
+                    ASSERT_EQUAL_HINT(documents[i].id, expected[i].id, query);
+                    ASSERT_EQUAL(documents[i].relevance, expected[i].relevance);
+                }
+            }
+        }
+    }
+}
+
+void TestCompressedIndexMatchesFlat() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s};
+    SearchServer server("in the"s);
+    for (int id = 0; id < 2000; id += 1 + id % 3) {
+        string text;
+        for (int i = 0; i < 2 + id % 5; ++i) {
+            text += words[(id * 5 + i * i * 3) % words.size()] + " "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 4});
+    }
+    const vector<string> queries = {"cat dog"s, "fluffy tail -white"s, "rat collar black -dog"s};
+    SearchOptions wand;
+    wand.max_result_count = 30;
+    wand.evaluation = QueryEvaluation::WAND;
+    const auto find = [&](const string& query) {
+        return vector<vector<Document>>{
+            server.FindTopDocuments(query),
+            server.FindTopDocuments(execution::par, query),
+            server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, wand),
+            server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, wand)};
+    };
+    vector<vector<vector<Document>>> expected;
+    for (const string& query : queries) {
+        expected.push_back(find(query));
+    }
+
+    const IndexMemoryUsage flat_usage = server.GetIndexMemoryUsage();
+    server.CompressIndex();
+    const IndexMemoryUsage compressed_usage = server.GetIndexMemoryUsage();
+    ASSERT_EQUAL(compressed_usage.compressed_posting_count, flat_usage.posting_count);
+    ASSERT_HINT(compressed_usage.bytes < flat_usage.bytes / 2, "Compressed index must be smaller"s);
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const auto results = find(queries[q]);
+        for (size_t i = 0; i < results.size(); ++i) {
+            ASSERT_EQUAL_HINT(results[i].size(), expected[q][i].size(), queries[q]);
+            for (size_t j = 0; j < results[i].size(); ++j) {
+                ASSERT_EQUAL(results[i][j].id, expected[q][i][j].id);
+                ASSERT_EQUAL(results[i][j].relevance, expected[q][i][j].relevance);
+            }
+        }
+    }
+
+    server.RemoveDocument(0);
+    ASSERT(server.FindTopDocuments("cat dog white black"s, [](int document_id, DocumentStatus, int) {
+        return document_id == 0;
+    }).empty());
+    server.AddDocument(0, "white cat"s, DocumentStatus::ACTUAL, {1});
+    const auto documents = server.FindTopDocuments("cat"s, [](int document_id, DocumentStatus, int) {
+        return document_id == 0;
+    });
+    ASSERT_EQUAL_HINT(documents.size(), 1u, "Compressed lists must stay editable"s);
+}
+
+void TestSnapshotRoundTrip() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s};
+    SearchServer server("in the"s);
+    for (int id = 0; id < 1500; id += 1 + id % 3) {
+        string text = "in the "s;
+        for (int i = 0; i < 2 + id % 5; ++i) {
+            text += words[(id * 7 + i * i * 3) % words.size()] + " "s;
+        }
+        server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), {id % 5, -id % 7});
+    }
+    // Часть списков сжата, часть нет
+    server.CompressIndex();
+    server.AddDocument(2000, "white parrot"s, DocumentStatus::ACTUAL, {3});
+
+    const string path = (filesystem::temp_directory_path() / "search_server_snapshot_test.bin"s).string();
+    server.SaveSnapshot(path);
+    SearchServer loaded = SearchServer::OpenSnapshot(path);
+
+    ASSERT_EQUAL(loaded.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT(equal(loaded.begin(), loaded.end(), server.begin(), server.end()));
+    const vector<string> queries = {"cat dog"s, "fluffy tail -white"s, "parrot white"s, "the rat"s};
+    for (const string& query : queries) {
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            const auto expected = server.FindTopDocuments(query, status);
+            const auto documents = loaded.FindTopDocuments(query, status);
+            ASSERT_EQUAL_HINT(documents.size(), expected.size(), query);
+            for (size_t i = 0; i < documents.size(); ++i) {
+                ASSERT_EQUAL(documents[i].id, expected[i].id);
+                ASSERT_EQUAL(documents[i].relevance, expected[i].relevance);
+                ASSERT_EQUAL(documents[i].rating, expected[i].rating);
+            }
+        }
+    }
+    for (const int document_id : {0, 1, 999, 2000}) {
+        ASSERT(loaded.GetWordFrequencies(document_id) == server.GetWordFrequencies(document_id));
+        ASSERT(get<0>(loaded.MatchDocument("cat white parrot"s, document_id))
+               == get<0>(server.MatchDocument("cat white parrot"s, document_id)));
+    }
+
+    // Загруженный сервер остаётся изменяемым
+    loaded.RemoveDocument(2000);
+    ASSERT(loaded.FindTopDocuments("parrot"s).empty());
+    loaded.AddDocument(3000, "in the black parrot"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(loaded.FindTopDocuments("parrot"s).size(), 1u);
+    ASSERT_EQUAL(loaded.GetWordFrequencies(3000).size(), 2u);
+
+    // Снимок, снятый с открытого из снимка сервера, совпадает с ним
+    loaded.SaveSnapshot(path);
+    const SearchServer reloaded = SearchServer::OpenSnapshot(path);
+    ASSERT_EQUAL(reloaded.GetDocumentCount(), loaded.GetDocumentCount());
+    for (const int document_id : {1, 999, 3000}) {
+        ASSERT(reloaded.GetWordFrequencies(document_id) == loaded.GetWordFrequencies(document_id));
+    }
+    ASSERT_EQUAL(reloaded.FindTopDocuments("black parrot"s).size(), loaded.FindTopDocuments("black parrot"s).size());
+
+    // Испорченный снимок не открывается
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.seekg(-1, ios::end);
+        const char last_byte = static_cast<char>(file.get());
+        file.seekp(-1, ios::end);
+        file.put(static_cast<char>(~last_byte));
+    }
+    bool is_rejected = false;
+    try {
+        SearchServer::OpenSnapshot(path);
+    } catch (const invalid_argument&) {
+        is_rejected = true;
+    }
+    ASSERT_HINT(is_rejected, "Corrupted snapshot must be rejected"s);
+    remove(path.c_str());
+}
+
+void TestSnapshotRejectsInconsistentPostings() {
+    SearchServer server("in the"s);
+    server.AddDocument(100, "in the cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(200, "white parrot"s, DocumentStatus::ACTUAL, {2});
+    const string path = (filesystem::temp_directory_path() / "search_server_postings_test.bin"s).string();
+    server.SaveSnapshot(path);
+    string snapshot;
+    {
+        ifstream file(path, ios::binary);
+        snapshot.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+    ASSERT_EQUAL(SearchServer::OpenSnapshot(path).GetDocumentCount(), 2);
+
+    // Заголовок снимка занимает 160 байт, по смещению 24 в нём лежит FNV-1a всего остального.
+    // Списки вхождений идут в конце файла, поэтому последнее вхождение id 200 - из списка вхождений
+    const auto open_with_posting_id = [&](int32_t document_id) {
+        string corrupted = snapshot;
+        const int32_t original_id = 200;
+        size_t position = corrupted.size() - sizeof(original_id);
+        while (memcmp(corrupted.data() + position, &original_id, sizeof(original_id)) != 0) {
+            position -= sizeof(original_id);
+        }
+        memcpy(corrupted.data() + position, &document_id, sizeof(document_id));
+        uint64_t checksum = 14695981039346656037ull;
+        for (size_t i = 160; i < corrupted.size(); ++i) {
+            checksum ^= static_cast<unsigned char>(corrupted[i]);
+            checksum *= 1099511628211ull;
+        }
+        memcpy(corrupted.data() + 24, &checksum, sizeof(checksum));
+        {
+            ofstream file(path, ios::binary | ios::trunc);
+            file.write(corrupted.data(), static_cast<streamsize>(corrupted.size()));
+        }
+        try {
+            SearchServer::OpenSnapshot(path);
+        } catch (const invalid_argument&) {
+            return false;
+        }
+        return true;
+    };
+    ASSERT_HINT(open_with_posting_id(200), "Rewriting the same id must keep the snapshot valid"s);
+    ASSERT_HINT(!open_with_posting_id(150), "Posting of an unlisted document must be rejected"s);
+    ASSERT_HINT(!open_with_posting_id(100), "Posting of a document without the word must be rejected"s);
+    remove(path.c_str());
+}
+
+void TestAddDocumentsMatchesAddDocument() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s};
+    vector<string> texts;
+    for (int i = 0; i < 1200; ++i) {
+        string text = "in the "s;
+        for (int j = 0; j < 1 + i % 6; ++j) {
+            text += words[(i * 3 + j * j * 5) % words.size()] + " "s;
+        }
+        texts.push_back(text);
+    }
+    // Часть документов уже в индексе, остальные приходят пакетом не по порядку id
+    SearchServer expected("in the"s);
+    SearchServer sequential("in the"s);
+    SearchServer parallel("in the"s);
+    vector<DocumentToAdd> batch;
+    for (int i = 0; i < static_cast<int>(texts.size()); ++i) {
+        const int id = (i * 7) % static_cast<int>(texts.size());
+        const DocumentStatus status = static_cast<DocumentStatus>(i % 3);
+        expected.AddDocument(id, texts[i], status, {i % 5, 1});
+        if (i % 4 == 0) {
+            sequential.AddDocument(id, texts[i], status, {i % 5, 1});
+            parallel.AddDocument(id, texts[i], status, {i % 5, 1});
+        } else {
+            batch.push_back({id, texts[i], status, {i % 5, 1}});
+        }
+    }
+    sequential.AddDocuments(batch);
+    parallel.AddDocuments(execution::par, batch);
+
+    for (const SearchServer* server : {&sequential, &parallel}) {
+        ASSERT_EQUAL(server->GetDocumentCount(), expected.GetDocumentCount());
+        for (const int document_id : {0, 7, 13, 1199}) {
+            ASSERT(server->GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id));
+        }
+        for (const string& query : {"cat dog"s, "fluffy tail -white"s, "rat"s}) {
+            const auto documents = server->FindTopDocuments(query, DocumentStatus::IRRELEVANT);
+            const auto expected_documents = expected.FindTopDocuments(query, DocumentStatus::IRRELEVANT);
+            ASSERT_EQUAL_HINT(documents.size(), expected_documents.size(), query);
+            for (size_t i = 0; i < documents.size(); ++i) {
+                ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+                ASSERT_EQUAL(documents[i].relevance, expected_documents[i].relevance);
+                ASSERT_EQUAL(documents[i].rating, expected_documents[i].rating);
+            }
+        }
+    }
+
+    // Пакет с ошибкой не добавляется целиком
+    const auto is_rejected = [&parallel](const vector<DocumentToAdd>& documents) {
+        try {
+            parallel.AddDocuments(execution::par, documents);
+        } catch (const invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT(is_rejected({{5000, "cat"s, DocumentStatus::ACTUAL, {1}}, {5000, "dog"s, DocumentStatus::ACTUAL, {1}}}));
+    ASSERT(is_rejected({{5001, "cat"s, DocumentStatus::ACTUAL, {1}}, {5002, "d\x12og"s, DocumentStatus::ACTUAL, {1}}}));
+    ASSERT(is_rejected({{5003, "cat"s, DocumentStatus::ACTUAL, {1}}, {7, "dog"s, DocumentStatus::ACTUAL, {1}}}));
+    ASSERT_EQUAL(parallel.GetDocumentCount(), expected.GetDocumentCount());
+}
+
+void TestSplitIntoWords() {
+    // Строки разной длины, чтобы слова попадали на границы блоков
+    const auto split_slowly = [](const string& text) {
+        vector<string_view> words;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            const size_t begin = text.find_first_not_of(' ', pos);
+            if (begin == string::npos) {
+                break;
+            }
+            const size_t end = min(text.find(' ', begin), text.size());
+            words.push_back(string_view(text).substr(begin, end - begin));
+            pos = end;
+        }
+        return words;
+    };
+    vector<string_view> words;
+    for (int length = 0; length < 150; ++length) {
+        for (int seed = 0; seed < 7; ++seed) {
+            string text;
+            for (int i = 0; i < length; ++i) {
+                text.push_back((i * 7 + seed * 3 + i * i * seed) % (2 + seed) == 0 ? ' ' : static_cast<char>('a' + i % 26));
+            }
+            SplitIntoWords(text, words);
+            ASSERT_HINT(words == split_slowly(text), text);
+            ASSERT(SplitIntoWords(text) == words);
+            ASSERT(!HasControlChars(text));
+            if (length > 0) {
+                text[(length * 13 + seed) % length] = static_cast<char>(seed * 4);
+                ASSERT_HINT(HasControlChars(text), to_string(length));
+            }
+        }
+    }
+    ASSERT(!HasControlChars("\x7f\x80\xff \xd0\xba\xd0\xbe\xd1\x82"s));
+    ASSERT(HasControlChars("cat\x1f"s));
+}
+
+void TestTermDictionary() {
+    TermDictionary dictionary;
+    const TermId cat = dictionary.Intern("cat"s);
+    const TermId dog = dictionary.Intern(string(5000, 'd'));
+    ASSERT(cat != dog);
+    ASSERT_EQUAL(dictionary.Intern("cat"s), cat);
+    ASSERT_EQUAL(dictionary.Find("cat"s), cat);
+    ASSERT_EQUAL(dictionary.Find("bird"s), TermDictionary::kNoTerm);
+    ASSERT_EQUAL(dictionary.GetWord(dog), string(5000, 'd'));
+    dictionary.Release(cat);
+    ASSERT_EQUAL(dictionary.Find("cat"s), TermDictionary::kNoTerm);
+    // Освобождённый номер достаётся следующему новому слову
+    ASSERT_EQUAL(dictionary.Intern("bird"s), cat);
+    ASSERT_EQUAL(dictionary.size(), 2u);
+
+    // Слова удалённого документа освобождаются, а поиск по новым словам с теми же номерами верен
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "fluffy cat"s, DocumentStatus::ACTUAL, {2});
+    search_server.RemoveDocument(1);
+    search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {3});
+    ASSERT(search_server.FindTopDocuments("white collar"s).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments("expressive"s).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).front().id, 2);
+    const string query = "dog eyes cat"s;
+    const auto [words, status] = search_server.MatchDocument(query, 3);
+    ASSERT((words == vector<string_view>{"dog"sv, "eyes"sv}));
+    const map<string_view, double> expected = {{"dog"sv, 0.25}, {"expressive"sv, 0.25}, {"eyes"sv, 0.25}, {"groomed"sv, 0.25}};
+    ASSERT(search_server.GetWordFrequencies(3) == expected);
+}
+
+void TestAllocatorStats() {
+    SearchServer search_server("and"s);
+    for (int id = 0; id < 200; ++id) {
+        search_server.AddDocument(id, "cat number "s + to_string(id % 17) + " and dog "s + to_string(id % 5),
+                                  DocumentStatus::ACTUAL, {id});
+    }
+    const IndexAllocatorStats added = search_server.GetIndexAllocatorStats();
+    ASSERT(added.requested.allocation_count > 0);
+    // Пул берёт память у malloc кусками, а не на каждый документ
+    ASSERT(added.upstream.allocation_count < added.requested.allocation_count / 10);
+    for (int id = 0; id < 100; ++id) {
+        search_server.RemoveDocument(id);
+    }
+    const IndexAllocatorStats removed = search_server.GetIndexAllocatorStats();
+    ASSERT(removed.requested.in_use_bytes < added.requested.in_use_bytes);
+    // Такие же документы на месте удалённых получают освободившиеся блоки
+    for (int id = 200; id < 300; ++id) {
+        search_server.AddDocument(id, "cat number "s + to_string(id % 17) + " and dog "s + to_string(id % 5),
+                                  DocumentStatus::ACTUAL, {id});
+    }
+    ASSERT_EQUAL(search_server.GetIndexAllocatorStats().upstream.allocation_count, added.upstream.allocation_count);
+
+    // После первого запроса арены потока хватает следующим, и malloc не вызывается
+    const string query = "cat dog -3 number 7 1"s;
+    for (int i = 0; i < 3; ++i) {
+        search_server.FindTopDocuments(query);
+        search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, {5, QueryEvaluation::WAND});
+        search_server.MatchDocument(query, 250);
+    }
+    const QueryScratchStats warmed_up = GetQueryScratchStats();
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQUAL(search_server.FindTopDocuments(query).size(), 5u);
+        ASSERT_EQUAL(search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL,
+                                                    {5, QueryEvaluation::WAND}).size(), 5u);
+        ASSERT_EQUAL(get<0>(search_server.MatchDocument(query, 250)).size(), 3u);
+    }
+    const QueryScratchStats after = GetQueryScratchStats();
+    ASSERT_EQUAL(after.upstream.allocation_count, warmed_up.upstream.allocation_count);
+    ASSERT(after.reset_count >= warmed_up.reset_count + 300);
+}
+
+void TestConcurrentReadsDuringWrites() {
+    // Писатель держит в индексе не больше kWindow + 1 документов подряд; каждый
+    // читатель должен видеть состояние целиком до или целиком после изменения
+    constexpr int kWindow = 5;
+    constexpr int kDocumentCount = 2000;
+    ConcurrentSearchServer search_server("and"s);
+    atomic<bool> is_writing = true;
+    thread writer([&] {
+        for (int id = 0; id < kDocumentCount; ++id) {
+            if (id % 2 == 0) {
+                search_server.AddDocument(id, "common and word"s + to_string(id), DocumentStatus::ACTUAL, {id});
+            } else {
+                search_server.AddDocuments({{id, "common and word"s + to_string(id), DocumentStatus::ACTUAL, {id}}});
+            }
+            if (id >= kWindow) {
+                search_server.RemoveDocument(id - kWindow);
+            }
+        }
+        is_writing = false;
+    });
+    vector<thread> readers;
+    atomic<int> read_count = 0;
+    for (int reader = 0; reader < 3; ++reader) {
+        readers.emplace_back([&] {
+            const string query = "common -word7"s;
+            while (is_writing) {
+                const auto snapshot = search_server.Read();
+                const int document_count = snapshot->GetDocumentCount();
+                const auto documents = snapshot->FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL,
+                                                                  {kDocumentCount, QueryEvaluation::EXHAUSTIVE});
+                ASSERT(document_count <= kWindow + 1);
+                ASSERT_EQUAL(documents.size() + snapshot->FindTopDocuments("word7"s).size(),
+                             static_cast<size_t>(document_count));
+                for (const Document& document : documents) {
+                    ASSERT_EQUAL(document.rating, document.id);
+                    ASSERT(get<0>(snapshot->MatchDocument(query, document.id)).size() == 1);
+                }
+                ++read_count;
+            }
+        });
+    }
+    writer.join();
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT(read_count > 0);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), kWindow);
+    ASSERT_EQUAL(search_server.FindTopDocuments("common"s).size(), 5u);
+}
+
+void TestSegmentedIndexMatchesRebuilt() {
+    // Документов хватает на несколько запечатанных сегментов и их слияния; часть
+    // удаляется и добавляется снова, в том числе в уже запечатанные сегменты
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s};
+    const auto make_text = [&words](int id) {
+        string text;
+        for (int i = 0; i < 1 + id % 4; ++i) {
+            text += words[(id * 3 + i * i * 5) % words.size()] + " "s;
+        }
+        return text;
+    };
+    constexpr int kDocumentCount = 20000;
+    SearchServer segmented("in"s);
+    for (int id = 0; id < kDocumentCount; ++id) {
+        segmented.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 9});
+        if (id % 3 == 0 && id >= 100) {
+            segmented.RemoveDocument(id - 100 + id % 7);
+        }
+        if (id % 11 == 0) {
+            segmented.RemoveDocument(id);
+            segmented.AddDocument(id, make_text(id + 1), DocumentStatus::ACTUAL, {id % 9});
+        }
+    }
+    SearchServer rebuilt("in"s);
+    for (const int id : segmented) {
+        rebuilt.AddDocument(id, id % 11 == 0 ? make_text(id + 1) : make_text(id), DocumentStatus::ACTUAL, {id % 9});
+    }
+
+    const vector<string> queries = {"cat dog"s, "fluffy tail -white"s, "rat -collar -black"s};
+    SearchOptions wand;
+    wand.max_result_count = 50;
+    wand.evaluation = QueryEvaluation::WAND;
+    const auto find = [&wand](const SearchServer& server, const string& query) {
+        return vector<vector<Document>>{
+            server.FindTopDocuments(query),
+            server.FindTopDocuments(execution::par, query),
+            server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, wand),
+            server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, wand)};
+    };
+    const auto check = [&] {
+        ASSERT_EQUAL(segmented.GetDocumentCount(), rebuilt.GetDocumentCount());
+        for (const string& query : queries) {
+            const auto results = find(segmented, query);
+            const auto expected = find(rebuilt, query);
+            for (size_t i = 0; i < results.size(); ++i) {
+                ASSERT_EQUAL_HINT(results[i].size(), expected[i].size(), query);
+                for (size_t j = 0; j < results[i].size(); ++j) {
+                    ASSERT_EQUAL(results[i][j].id, expected[i][j].id);
+                    ASSERT_EQUAL(results[i][j].relevance, expected[i][j].relevance);
+                }
+            }
+        }
+    };
+    const IndexMemoryUsage usage = segmented.GetIndexMemoryUsage();
+    ASSERT(usage.segment_count > 1);
+    ASSERT(usage.deleted_document_count > 0);
+    check();
+
+    segmented.MergeIndexSegments();
+    ASSERT_EQUAL(segmented.GetIndexMemoryUsage().deleted_document_count, 0u);
+    ASSERT_EQUAL(segmented.GetIndexMemoryUsage().posting_count, rebuilt.GetIndexMemoryUsage().posting_count);
+    check();
+}
+
+void TestProcessQueries() {
+    // Задачи разной длины на пуле с лишними потоками: каждая должна выполниться ровно один раз
+    WorkStealingPool pool(4);
+    vector<atomic<int>> runs(1000);
+    pool.ParallelFor(runs.size(), [&runs](size_t i) {
+        if (i < 10) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        ++runs[i];
+    });
+    ASSERT(all_of(runs.begin(), runs.end(), [](const atomic<int>& run_count) {
+        return run_count == 1;
+    }));
+    bool is_thrown = false;
+    try {
+        pool.ParallelFor(100, [](size_t i) {
+            if (i == 57) {
+                throw invalid_argument("task"s);
+            }
+        });
+    } catch (const invalid_argument&) {
+        is_thrown = true;
+    }
+    ASSERT_HINT(is_thrown, "Task exception must reach the caller"s);
+
+    // Вложенный вызов из задачи и вызовы из нескольких потоков сразу выполняются последовательно
+    vector<atomic<int>> nested_runs(16 * 50);
+    pool.ParallelFor(16, [&pool, &nested_runs](size_t i) {
+        pool.ParallelFor(50, [&nested_runs, i](size_t j) {
+            ++nested_runs[i * 50 + j];
+        });
+    });
+    ASSERT_HINT(all_of(nested_runs.begin(), nested_runs.end(), [](const atomic<int>& run_count) {
+        return run_count == 1;
+    }), "Nested ParallelFor must run every task once"s);
+    vector<atomic<int>> concurrent_runs(4 * 500);
+    vector<thread> callers;
+    for (size_t caller = 0; caller < 4; ++caller) {
+        callers.emplace_back([&pool, &concurrent_runs, caller] {
+            pool.ParallelFor(500, [&concurrent_runs, caller](size_t i) {
+                ++concurrent_runs[caller * 500 + i];
+            });
+        });
+    }
+    for (thread& caller : callers) {
+        caller.join();
+    }
+    ASSERT_HINT(all_of(concurrent_runs.begin(), concurrent_runs.end(), [](const atomic<int>& run_count) {
+        return run_count == 1;
+    }), "Concurrent ParallelFor calls must run every task once"s);
+
+    SearchServer search_server("and with"s);
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s};
+    for (int id = 0; id < 500; ++id) {
+        search_server.AddDocument(id, words[id % 8] + " and "s + words[id * 3 % 7], DocumentStatus::ACTUAL, {id % 5});
+    }
+    vector<string> queries;
+    for (int i = 0; i < 300; ++i) {
+        queries.push_back(words[i % 8] + " "s + words[i * 5 % 8] + (i % 3 == 0 ? " -"s + words[i % 5] : ""s));
+    }
+    queries[7] = "nonexistent"s;
+    const auto documents = ProcessQueries(search_server, queries);
+    ASSERT_EQUAL(documents.size(), queries.size());
+    size_t document_count = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected = search_server.FindTopDocuments(queries[i]);
+        ASSERT_EQUAL_HINT(documents[i].size(), expected.size(), queries[i]);
+        for (size_t j = 0; j < expected.size(); ++j) {
+            ASSERT_EQUAL(documents[i][j].id, expected[j].id);
+            ASSERT_EQUAL(documents[i][j].relevance, expected[j].relevance);
+        }
+        document_count += expected.size();
+    }
+    ASSERT(documents[7].empty());
+
+    const JoinedDocuments joined = ProcessQueriesJoined(search_server, queries);
+    ASSERT_EQUAL(joined.size(), document_count);
+    ASSERT_EQUAL(static_cast<size_t>(distance(joined.begin(), joined.end())), document_count);
+    auto it = joined.begin();
+    for (const auto& query_documents : documents) {
+        for (const Document& document : query_documents) {
+            ASSERT_EQUAL(it->id, document.id);
+            ++it;
+        }
+    }
+    const JoinedDocuments nothing = ProcessQueriesJoined(search_server, {"nonexistent"s, "nothing"s});
+    ASSERT(nothing.empty() && nothing.begin() == nothing.end());
+
+    queries[150] = "cat --dog"s;
+    try {
+        ProcessQueries(search_server, queries);
+        ASSERT_HINT(false, "Invalid query must throw"s);
+    } catch (const invalid_argument&) {
+    }
+}
+
+void TestSharedScanMatchesSingleQueries() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s,
+                                  "parrot"s, "green"s};
+    SearchServer search_server("and with"s);
+    for (int id = 0; id < 6000; id += 1 + id % 2) {
+        string text = "and "s;
+        for (int i = 0; i < 1 + id % 6; ++i) {
+            text += words[(id * 7 + i * i * 3) % words.size()] + " "s;
+        }
+        search_server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), {id % 7});
+    }
+    // Надгробия в запечатанных сегментах и удаления из изменяемого
+    for (int id = 0; id < 6000; id += 13) {
+        search_server.RemoveDocument(id);
+    }
+
+    // Больше kMaxSharedScanQueries запросов с общими словами, повторами, минус-словами и пустыми
+    vector<string> queries;
+    for (int i = 0; i < 150; ++i) {
+        string query = words[i % words.size()] + " "s + words[i * 3 % words.size()];
+        if (i % 4 == 0) {
+            query += " -"s + words[(i + 1) % words.size()];
+        }
+        if (i % 9 == 0) {
+            query += " and unknown "s + words[i % words.size()];
+        }
+        queries.push_back(query);
+    }
+    queries[11] = ""s;
+    queries[12] = "-cat"s;
+    queries[13] = "cat -cat"s;
+
+    const auto check = [&](DocumentStatus status, const SearchOptions& options) {
+        const auto documents = search_server.FindTopDocumentsBatch(queries, status, options);
+        ASSERT_EQUAL(documents.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto expected = search_server.FindTopDocuments(execution::seq, queries[i], status, options);
+            ASSERT_EQUAL_HINT(documents[i].size(), expected.size(), queries[i]);
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL_HINT(documents[i][j].id, expected[j].id, queries[i]);
+                ASSERT_EQUAL(documents[i][j].relevance, expected[j].relevance);
+                ASSERT_EQUAL(documents[i][j].rating, expected[j].rating);
+            }
+        }
+    };
+    check(DocumentStatus::ACTUAL, {});
+    check(DocumentStatus::BANNED, {20, QueryEvaluation::EXHAUSTIVE});
+    search_server.MergeIndexSegments();
+    check(DocumentStatus::IRRELEVANT, {1000, QueryEvaluation::EXHAUSTIVE});
+
+    queries[100] = "cat --dog"s;
+    try {
+        search_server.FindTopDocumentsBatch(queries);
+        ASSERT_HINT(false, "Invalid query must throw"s);
+    } catch (const invalid_argument&) {
+    }
+}
+
+void TestQueryResultCache() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "white cat and fluffy tail"s, DocumentStatus::ACTUAL, {3});
+    search_server.AddDocument(2, "black dog with collar"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "white dog"s, DocumentStatus::BANNED, {1});
+    ASSERT(search_server.NormalizeQuery("  dog and white -cat white"s) == search_server.NormalizeQuery("white dog -cat"s));
+    ASSERT(search_server.NormalizeQuery("white dog"s) != search_server.NormalizeQuery("white -dog"s));
+
+    QueryResultCache cache(search_server, {16, 4, true});
+    const auto expect_same = [&search_server](const vector<Document>& documents, const string& query,
+                                              DocumentStatus status) {
+        const auto expected = search_server.FindTopDocuments(execution::seq, query, status);
+        ASSERT_EQUAL_HINT(documents.size(), expected.size(), query);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected[i].id);
+            ASSERT_EQUAL(documents[i].relevance, expected[i].relevance);
+        }
+    };
+    expect_same(cache.FindTopDocuments("white dog"s), "white dog"s, DocumentStatus::ACTUAL);
+    // Тот же запрос в другом виде попадает в ту же запись, другой статус и K - нет
+    expect_same(cache.FindTopDocuments("dog and white dog"s), "white dog"s, DocumentStatus::ACTUAL);
+    expect_same(cache.FindTopDocuments("white dog"s, DocumentStatus::BANNED), "white dog"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(cache.FindTopDocuments("white dog"s, DocumentStatus::ACTUAL, {1}).size(), 1u);
+    const auto is_odd = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 1;
+    };
+    ASSERT_EQUAL(cache.FindTopDocuments("white dog"s, "odd"s, is_odd).size(), 2u);
+    ASSERT_EQUAL(cache.FindTopDocuments("dog white"s, "odd"s, is_odd).size(), 2u);
+    QueryCacheStats stats = cache.GetStats();
+    ASSERT_EQUAL(stats.hit_count, 2u);
+    ASSERT_EQUAL(stats.miss_count, 4u);
+    ASSERT_EQUAL(stats.size, 4u);
+
+    // Изменение сервера делает прежние результаты недействительными
+    search_server.AddDocument(4, "white dog and white cat"s, DocumentStatus::ACTUAL, {5});
+    expect_same(cache.FindTopDocuments("white dog"s), "white dog"s, DocumentStatus::ACTUAL);
+    search_server.RemoveDocument(4);
+    expect_same(cache.FindTopDocuments("white dog"s), "white dog"s, DocumentStatus::ACTUAL);
+    search_server.RemoveDocument(4);
+    expect_same(cache.FindTopDocuments("white dog"s), "white dog"s, DocumentStatus::ACTUAL);
+    stats = cache.GetStats();
+    ASSERT_EQUAL(stats.invalidation_count, 2u);
+    ASSERT_EQUAL(stats.hit_count, 3u);
+
+    // Частый запрос не вытесняется потоком разовых, а в LRU вытесняется
+    for (const bool use_frequency_admission : {true, false}) {
+        QueryResultCache small_cache(search_server, {4, 1, use_frequency_admission});
+        for (int i = 0; i < 10; ++i) {
+            small_cache.FindTopDocuments("white cat"s);
+        }
+        for (int i = 0; i < 20; ++i) {
+            small_cache.FindTopDocuments("dog "s + to_string(i));
+        }
+        const size_t hit_count = small_cache.GetStats().hit_count;
+        small_cache.FindTopDocuments("white cat"s);
+        stats = small_cache.GetStats();
+        ASSERT_EQUAL(stats.hit_count, hit_count + (use_frequency_admission ? 1 : 0));
+        ASSERT(stats.size <= 4u);
+        if (use_frequency_admission) {
+            ASSERT(stats.rejection_count > 0);
+        } else {
+            ASSERT(stats.eviction_count >= 17u);
+        }
+    }
+
+    // Кэш общий для нескольких потоков
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, &search_server, t] {
+            for (int i = 0; i < 200; ++i) {
+                const string query = (i % 3 == 0 ? "white "s : "dog "s) + to_string((i * t) % 7);
+                ASSERT_EQUAL(cache.FindTopDocuments(query).size(), search_server.FindTopDocuments(query).size());
+            }
+        });
+    }
+    for (thread& thread : threads) {
+        thread.join();
+    }
+    stats = cache.GetStats();
+    ASSERT(stats.size <= 16u);
+    ASSERT(stats.hit_count > 0);
+}
+
+void TestQuantizedScoresApproximateExact() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s,
+                                  "parrot"s, "green"s, "big"s, "small"s};
+    const auto make_text = [&words](int id) {
+        string text;
+        for (int i = 0; i < 1 + id % 7; ++i) {
+            text += words[(id * 5 + i * i * 7 + i) % words.size()] + " "s;
+        }
+        return text;
+    };
+    SearchServer search_server("and"s);
+    for (int id = 0; id < 9000; ++id) {
+        search_server.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 5});
+    }
+    const vector<string> queries = {"cat dog"s, "fluffy tail -white"s, "rat collar black green"s, "parrot"s};
+    const SearchOptions exact{30, QueryEvaluation::EXHAUSTIVE};
+    const SearchOptions quantized{30, QueryEvaluation::QUANTIZED};
+    // Без квантованных вкладов QUANTIZED считает точно
+    for (const string& query : queries) {
+        const auto expected = search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, exact);
+        const auto documents = search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, quantized);
+        ASSERT_EQUAL(documents.size(), expected.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].relevance, expected[i].relevance);
+        }
+    }
+
+    const size_t bytes = search_server.GetIndexMemoryUsage().bytes;
+    search_server.QuantizeIndex();
+    ASSERT(search_server.GetIndexMemoryUsage().bytes > bytes);
+    const auto check = [&](double tolerance) {
+        for (const string& query : queries) {
+            for (const auto& documents : {
+                     search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, quantized),
+                     search_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, quantized)}) {
+                ASSERT_EQUAL_HINT(documents.size(), 30u, query);
+                for (const Document& document : documents) {
+                    const auto exact_documents = search_server.FindTopDocuments(
+                            execution::seq, query, [&document](int document_id, DocumentStatus, int) {
+                                return document_id == document.id;
+                            });
+                    ASSERT_EQUAL(exact_documents.size(), 1u);
+                    ASSERT_HINT(abs(document.relevance - exact_documents[0].relevance) <= tolerance, query);
+                }
+            }
+        }
+    };
+    // Ошибка округления - не больше половины шага на слово запроса
+    check(2.5 * log(2.0 * 9001) / 65535);
+
+    // Документы после квантования: изменяемый сегмент считается точно, запечатанный -
+    // по вкладам с IDF на момент запечатывания
+    for (int id = 9000; id < 13000; ++id) {
+        search_server.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 5});
+    }
+    search_server.RemoveDocument(5);
+    check(0.01);
+}
+
+void TestStatusFilterMatchesPredicate() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s};
+    const vector<DocumentStatus> statuses = {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT,
+                                             DocumentStatus::BANNED, DocumentStatus::REMOVED};
+    SearchServer search_server("and"s);
+    // Пропуски в id и удаления, в том числе документа с наибольшим id
+    for (int id = 0; id < 6000; id += 1 + id % 3) {
+        string text;
+        for (int i = 0; i < 1 + id % 5; ++i) {
+            text += words[(id * 3 + i * i) % words.size()] + " "s;
+        }
+        search_server.AddDocument(id, text, statuses[id * 7 % 4], {id % 11, -id % 3});
+    }
+    const int document_count = search_server.GetDocumentCount();
+    const int last_id = *prev(search_server.end());
+    search_server.RemoveDocument(last_id);
+    search_server.RemoveDocument(100);
+    search_server.RemoveDocument(100);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), document_count - 2);
+    search_server.AddDocument(100, "cat parrot"s, DocumentStatus::BANNED, {7});
+
+    const vector<string> queries = {"cat dog"s, "fluffy tail -white"s, "rat collar black"s, "-cat dog"s};
+    for (const DocumentStatus status : statuses) {
+        const auto predicate = [status](int, DocumentStatus document_status, int) {
+            return document_status == status;
+        };
+        for (const QueryEvaluation evaluation : {QueryEvaluation::EXHAUSTIVE, QueryEvaluation::WAND,
+                                                 QueryEvaluation::QUANTIZED}) {
+            const SearchOptions options{20, evaluation};
+            for (const string& query : queries) {
+                const auto expected = search_server.FindTopDocuments(execution::seq, query, predicate, options);
+                for (const auto& documents : {
+                         search_server.FindTopDocuments(execution::seq, query, status, options),
+                         search_server.FindTopDocuments(execution::par, query, status, options)}) {
+                    ASSERT_EQUAL_HINT(documents.size(), expected.size(), query);
+                    for (size_t i = 0; i < documents.size(); ++i) {
+                        ASSERT_EQUAL(documents[i].id, expected[i].id);
+                        ASSERT_EQUAL(documents[i].relevance, expected[i].relevance);
+                        ASSERT_EQUAL(documents[i].rating, expected[i].rating);
+                    }
+                }
+            }
+        }
+        const auto batch = search_server.FindTopDocumentsBatch(queries, status);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto expected = search_server.FindTopDocuments(queries[i], predicate);
+            ASSERT_EQUAL(batch[i].size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL(batch[i][j].id, expected[j].id);
+                ASSERT_EQUAL(batch[i][j].rating, expected[j].rating);
+            }
+        }
+    }
+    ASSERT(search_server.FindTopDocuments("parrot"s).empty());
+    const auto banned = search_server.FindTopDocuments("parrot"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned.size(), 1u);
+    ASSERT_EQUAL(banned[0].id, 100);
+    ASSERT_EQUAL(banned[0].rating, 7);
+}
+
+void TestRequiredAndMinusWords() {
+    {
+        SearchServer search_server("and"s);
+        search_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, {1});
+        search_server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {2});
+        search_server.AddDocument(3, "cat and dog"s, DocumentStatus::ACTUAL, {3});
+        const auto ids = [&search_server](const string& query) {
+            set<int> result;
+            for (const Document& document : search_server.FindTopDocuments(query)) {
+                result.insert(document.id);
+            }
+            return result;
+        };
+        ASSERT((ids("cat dog"s) == set<int>{1, 2, 3}));
+        ASSERT((ids("+cat dog"s) == set<int>{1, 3}));
+        ASSERT((ids("+cat +dog"s) == set<int>{3}));
+        ASSERT((ids("+cat +dog -collar"s) == set<int>{3}));
+        ASSERT((ids("+cat -cat"s).empty()));
+        ASSERT((ids("+parrot cat"s).empty()));
+        ASSERT((ids("+and cat"s) == set<int>{1, 3}));
+        ASSERT_EQUAL(get<0>(search_server.MatchDocument("+cat dog"s, 2)).size(), 0u);
+        ASSERT((get<0>(search_server.MatchDocument(execution::par, "+dog cat"s, 3))
+                == vector<string_view>{"cat"sv, "dog"sv}));
+        ASSERT_EQUAL(get<0>(search_server.MatchDocument(execution::par, "+cat dog"s, 2)).size(), 0u);
+        ASSERT(search_server.NormalizeQuery("cat +dog"s) != search_server.NormalizeQuery("cat dog"s));
+        for (const string& query : {"+"s, "cat +-dog"s, "-+cat"s, "++cat"s}) {
+            try {
+                search_server.FindTopDocuments(query);
+                ASSERT_HINT(false, query);
+            } catch (const invalid_argument&) {
+            }
+        }
+    }
+
+    {
+        // Слово документа, начинающееся с +, индексируется как есть, но найти его запросом нельзя:
+        // ведущий + в запросе всегда означает обязательное слово
+        SearchServer search_server(""s);
+        search_server.AddDocument(1, "call +7 now"s, DocumentStatus::ACTUAL, {1});
+        search_server.AddDocument(2, "dial 7 now"s, DocumentStatus::ACTUAL, {2});
+        const auto documents = search_server.FindTopDocuments("+7"s);
+        ASSERT_EQUAL(documents.size(), 1u);
+        ASSERT_EQUAL(documents[0].id, 2);
+        ASSERT(get<0>(search_server.MatchDocument("+7 call"s, 1)).empty());
+        ASSERT((search_server.GetWordFrequencies(1).count("+7"sv) == 1));
+        for (const string& query : {"++7"s, "-+7"s}) {
+            try {
+                search_server.FindTopDocuments(query);
+                ASSERT_HINT(false, query);
+            } catch (const invalid_argument&) {
+            }
+        }
+    }
+
+    {
+        // Разреженный кусок, плотный кусок и кусок на границе диапазона
+        DocumentBitmap bitmap;
+        set<int> ids;
+        for (int id = 10; id < 200'000; id += id < 65536 ? 97 : id < 131072 ? 3 : 1000) {
+            bitmap.Add(id);
+            ids.insert(id);
+        }
+        ASSERT_EQUAL(bitmap.GetCount(), ids.size());
+        for (int id = 0; id < 200'000; id += 7) {
+            ASSERT_EQUAL(bitmap.Contains(id), ids.count(id) > 0);
+        }
+        for (const auto& [range_begin, range_end] : {pair{0, 200'000}, pair{1000, 70'000}, pair{65'600, 140'000}}) {
+            set<int> found;
+            bitmap.ForEachWord(range_begin, range_end, [&found](size_t word, uint64_t bits) {
+                for (; bits != 0; bits &= bits - 1) {
+                    found.insert(static_cast<int>(word * 64 + __builtin_ctzll(bits)));
+                }
+            });
+            for (const int id : ids) {
+                if (id >= range_begin && id < range_end) {
+                    ASSERT(found.count(id) > 0);
+                }
+            }
+            for (const int id : found) {
+                ASSERT(ids.count(id) > 0 && id / 64 >= range_begin / 64 && id / 64 <= (range_end - 1) / 64);
+            }
+        }
+    }
+
+    // Частые слова в запечатанных сегментах исключаются битовыми множествами; удалённый
+    // и снова добавленный документ не должен наследовать слова старой версии
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s};
+    SearchServer search_server(""s);
+    map<string, set<int>> documents_by_word;
+    const auto add = [&](int id, int seed) {
+        string text;
+        for (int i = 0; i < 1 + seed % 5; ++i) {
+            const string& word = words[(seed * 3 + i * i + seed / 7) % words.size()];
+            text += word + " "s;
+        }
+        for (auto& [word, ids] : documents_by_word) {
+            ids.erase(id);
+        }
+        for (const string_view word : SplitIntoWords(text)) {
+            documents_by_word[string(word)].insert(id);
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {seed % 7});
+    };
+    for (int id = 0; id < 12000; ++id) {
+        add(id, id);
+    }
+    for (int id = 0; id < 12000; id += 5) {
+        search_server.RemoveDocument(id);
+        for (auto& [word, ids] : documents_by_word) {
+            ids.erase(id);
+        }
+    }
+    for (int id = 0; id < 2000; id += 10) {
+        add(id, id + 1);
+    }
+    const vector<pair<string, string>> queries = {{"fluffy tail -cat"s, "fluffy tail"s},
+                                                  {"+dog white black -rat -collar"s, "dog white black"s},
+                                                  {"+cat +tail fluffy"s, "cat tail fluffy"s},
+                                                  {"rat -cat -dog -white -black -fluffy"s, "rat"s}};
+    const vector<set<int>*> exclusions[] = {{&documents_by_word["cat"s]},
+                                            {&documents_by_word["rat"s], &documents_by_word["collar"s]},
+                                            {},
+                                            {&documents_by_word["cat"s], &documents_by_word["dog"s],
+                                             &documents_by_word["white"s], &documents_by_word["black"s],
+                                             &documents_by_word["fluffy"s]}};
+    const vector<set<int>*> requirements[] = {{}, {&documents_by_word["dog"s]},
+                                              {&documents_by_word["cat"s], &documents_by_word["tail"s]}, {}};
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto predicate = [&](int document_id, DocumentStatus, int) {
+            return all_of(exclusions[i].begin(), exclusions[i].end(), [document_id](const set<int>* ids) {
+                       return ids->count(document_id) == 0;
+                   })
+                   && all_of(requirements[i].begin(), requirements[i].end(), [document_id](const set<int>* ids) {
+                       return ids->count(document_id) > 0;
+                   });
+        };
+        const auto expected = search_server.FindTopDocuments(execution::seq, queries[i].second, predicate, {50});
+        ASSERT(!expected.empty());
+        const auto batch = search_server.FindTopDocumentsBatch({queries[i].first, queries[i].second},
+                                                               DocumentStatus::ACTUAL, {50});
+        for (const auto& documents : {
+                 search_server.FindTopDocuments(execution::seq, queries[i].first, DocumentStatus::ACTUAL, {50}),
+                 search_server.FindTopDocuments(execution::par, queries[i].first, DocumentStatus::ACTUAL, {50}),
+                 search_server.FindTopDocuments(execution::seq, queries[i].first, DocumentStatus::ACTUAL,
+                                                {50, QueryEvaluation::WAND}),
+                 batch[0]}) {
+            ASSERT_EQUAL_HINT(documents.size(), expected.size(), queries[i].first);
+            for (size_t j = 0; j < documents.size(); ++j) {
+                ASSERT_EQUAL_HINT(documents[j].id, expected[j].id, queries[i].first);
+                ASSERT_EQUAL(documents[j].relevance, expected[j].relevance);
+            }
+        }
+    }
+}
+
+void TestMatchDocuments() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s,
+                                  "parrot"s, "green"s};
+    SearchServer search_server("and"s);
+    for (int id = 0; id < 9000; ++id) {
+        string text;
+        for (int i = 0; i < 1 + id % 6; ++i) {
+            // Редкое слово parrot есть лишь в нескольких документах
+            text += words[(id * 7 + i * i) % (id % 500 == 0 ? words.size() : words.size() - 2)] + " "s;
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 3});
+    }
+    for (int id = 0; id < 9000; id += 7) {
+        search_server.RemoveDocument(id);
+    }
+    for (int id = 0; id < 9000; id += 70) {
+        search_server.AddDocument(id, "parrot green and cat"s, DocumentStatus::BANNED, {1});
+    }
+
+    // Все документы, несколько документов и повторы в неотсортированном списке
+    vector<int> all_ids(search_server.begin(), search_server.end());
+    reverse(all_ids.begin(), all_ids.end());
+    const vector<vector<int>> id_lists = {all_ids, {8999, 70, 3, 70, 4001}, {}};
+    const vector<string> queries = {"cat dog"s, "parrot green"s, "white -cat"s, "+parrot cat -tail"s, "rat +dog"s,
+                                    "unknown"s};
+    const auto check = [&] {
+        for (const string& query : queries) {
+            for (const vector<int>& ids : id_lists) {
+                const auto matched = search_server.MatchDocuments(query, ids);
+                ASSERT_EQUAL_HINT(matched.size(), ids.size(), query);
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    ASSERT_HINT(matched[i] == search_server.MatchDocument(query, ids[i]), query);
+                }
+            }
+        }
+    };
+    check();
+    search_server.CompressIndex();
+    check();
+    try {
+        search_server.MatchDocuments("cat"s, {1, 7});
+        ASSERT(false);
+    } catch (const out_of_range&) {
+    }
+}
+
+void TestShardedSearchServer() {
+    const vector<string> words = {"cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "rat"s,
+                                  "parrot"s, "green"s};
+    const vector<string> queries = {"cat dog"s, "parrot green -tail"s, "white +rat"s, "fluffy collar black"s,
+                                    "unknown"s};
+    const auto by_id = [](vector<Document> documents) {
+        sort(documents.begin(), documents.end(), [](const Document& lhs, const Document& rhs) {
+            return lhs.id < rhs.id;
+        });
+        return documents;
+    };
+    const auto check_equal = [](const vector<Document>& actual, const vector<Document>& expected,
+                                const string& query) {
+        ASSERT_EQUAL_HINT(actual.size(), expected.size(), query);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, query);
+            ASSERT_EQUAL_HINT(actual[i].rating, expected[i].rating, query);
+            ASSERT_HINT(abs(actual[i].relevance - expected[i].relevance) < 1e-12, query);
+        }
+    };
+    for (const size_t shard_count : {1u, 3u, 8u}) {
+        SearchServer search_server("and"s);
+        ShardedSearchServer sharded_server("and"s, shard_count);
+        vector<string> texts;
+        for (int id = 0; id < 2000; ++id) {
+            string text;
+            for (int i = 0; i < 1 + id % 5; ++i) {
+                text += words[(id * 3 + i * i * 7) % (id % 50 == 0 ? words.size() : words.size() - 2)] + " "s;
+            }
+            texts.push_back(text);
+        }
+        vector<DocumentToAdd> documents;
+        for (int id = 0; id < 2000; ++id) {
+            const DocumentStatus status = id % 11 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            search_server.AddDocument(id, texts[id], status, {id % 7});
+            if (id < 1000) {
+                sharded_server.AddDocument(id, texts[id], status, {id % 7});
+            } else {
+                documents.push_back({id, texts[id], status, {id % 7}});
+            }
+        }
+        sharded_server.AddDocuments(documents);
+        for (int id = 0; id < 2000; id += 13) {
+            search_server.RemoveDocument(id);
+            sharded_server.RemoveDocument(id);
+        }
+        ASSERT_EQUAL(sharded_server.GetDocumentCount(), search_server.GetDocumentCount());
+
+        // Пакет с уже занятым id не добавляет ни одного документа
+        try {
+            sharded_server.AddDocuments({{5000, "cat"s, DocumentStatus::ACTUAL, {1}},
+                                         {5001, "dog"s, DocumentStatus::ACTUAL, {1}},
+                                         {1, "rat"s, DocumentStatus::ACTUAL, {1}}});
+            ASSERT(false);
+        } catch (const invalid_argument&) {
+        }
+        ASSERT_EQUAL(sharded_server.GetDocumentCount(), search_server.GetDocumentCount());
+
+        const auto is_even = [](int document_id, DocumentStatus, int) {
+            return document_id % 2 == 0;
+        };
+        for (const QueryEvaluation evaluation : {QueryEvaluation::EXHAUSTIVE, QueryEvaluation::WAND}) {
+            SearchOptions all_options;
+            all_options.max_result_count = 5000;
+            all_options.evaluation = evaluation;
+            SearchOptions top_options;
+            top_options.evaluation = evaluation;
+            for (const string& query : queries) {
+                check_equal(by_id(sharded_server.FindTopDocuments(query, DocumentStatus::ACTUAL, all_options)),
+                            by_id(search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL,
+                                                                 all_options)),
+                            query);
+                check_equal(by_id(sharded_server.FindTopDocuments(query, is_even, all_options)),
+                            by_id(search_server.FindTopDocuments(execution::seq, query, is_even, all_options)), query);
+
+                // Топ может разойтись лишь порядком документов с равной релевантностью
+                const auto expected_top = search_server.FindTopDocuments(execution::seq, query,
+                                                                         DocumentStatus::ACTUAL, top_options);
+                const auto actual_top = sharded_server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_options);
+                ASSERT_EQUAL_HINT(actual_top.size(), expected_top.size(), query);
+                for (size_t i = 0; i < expected_top.size(); ++i) {
+                    ASSERT_HINT(abs(actual_top[i].relevance - expected_top[i].relevance) < 1e-12, query);
+                }
+            }
+        }
+        for (const int id : {1, 2, 1001, 1999}) {
+            if (find(search_server.begin(), search_server.end(), id) != search_server.end()) {
+                ASSERT(sharded_server.MatchDocument("cat dog white"s, id)
+                       == search_server.MatchDocument("cat dog white"s, id));
+            }
+        }
+    }
+}
+
+void TestFindDuplicates() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocuments({{3, "hair curly curly pet funny"s, DocumentStatus::BANNED, {2}},
+                                {4, "funny pet curly"s, DocumentStatus::ACTUAL, {2}}});
+    search_server.AddDocument(5, "nasty rat funny pet"s, DocumentStatus::ACTUAL, {1});
+
+    // Порядок, повторы и стоп-слова не важны
+    ASSERT(search_server.FindDuplicate(1) == optional<int>(5));
+    ASSERT(search_server.FindDuplicate(3) == optional<int>(2));
+    ASSERT(!search_server.FindDuplicate(4));
+    ASSERT(FindDuplicates(search_server) == vector<int>({3, 5}));
+    search_server.RemoveDocument(2);
+    ASSERT(!search_server.FindDuplicate(3));
+    try {
+        search_server.FindDuplicate(2);
+        ASSERT(false);
+    } catch (const out_of_range&) {
+    }
+
+    // Документы из 20 слов, которые отличаются одним словом, похожи на 19 / 21
+    SearchServer corpus(""s);
+    for (int id = 0; id < 600; ++id) {
+        const int group = id / 3;
+        string text;
+        for (int i = 0; i < 20; ++i) {
+            text += "w"s + to_string(group * 20 + i) + " "s;
+        }
+        if (id % 3 == 2) {
+            text += "extra"s + to_string(id);
+        }
+        corpus.AddDocument(id, text, DocumentStatus::ACTUAL, {1});
+    }
+    ASSERT_EQUAL(FindDuplicates(corpus).size(), 200u);
+    const vector<int> near_duplicate_ids = FindNearDuplicates(corpus);
+    ASSERT_EQUAL(near_duplicate_ids.size(), 400u);
+    for (const int document_id : near_duplicate_ids) {
+        ASSERT(document_id % 3 != 0);
+    }
+    NearDuplicateOptions strict_options;
+    strict_options.min_similarity = 0.99;
+    ASSERT_EQUAL(FindNearDuplicates(corpus, strict_options).size(), 200u);
+
+    const string path = (filesystem::temp_directory_path() / "search_server_duplicates_test.bin"s).string();
+    corpus.SaveSnapshot(path);
+    {
+        SearchServer restored = SearchServer::OpenSnapshot(path);
+        ASSERT(restored.FindDuplicate(4) == optional<int>(3));
+        RemoveNearDuplicates(restored);
+        ASSERT_EQUAL(restored.GetDocumentCount(), 200);
+    }
+    filesystem::remove(path);
+}
+
+void TestRequestStatistics() {
+    using Clock = RequestStatistics::Clock;
+    RequestStatistics statistics(chrono::minutes(10));
+    const Clock::time_point start{chrono::hours(1000)};
+    for (int minute = 0; minute < 30; ++minute) {
+        for (int i = 0; i < 10; ++i) {
+            statistics.Record(start + chrono::minutes(minute), chrono::microseconds(i < 9 ? 3 : 1000), i != 0);
+        }
+    }
+    // Окно - последние 10 минут, а корзины минут, вышедших из окна, уже переиспользованы
+    RequestWindowStats stats = statistics.GetStats(start + chrono::minutes(29));
+    ASSERT_EQUAL(stats.request_count, 100u);
+    ASSERT_EQUAL(stats.no_result_count, 10u);
+    ASSERT(abs(stats.GetNoResultRate() - 0.1) < 1e-12);
+    ASSERT(stats.GetLatencyQuantile(0.5) == chrono::microseconds(4));
+    ASSERT(stats.GetLatencyQuantile(0.99) == chrono::microseconds(1024));
+    ASSERT_EQUAL(statistics.GetStats(start + chrono::minutes(35)).request_count, 40u);
+    ASSERT_EQUAL(statistics.GetStats(start + chrono::minutes(45)).request_count, 0u);
+
+    // Запись из многих потоков не теряет запросов
+    RequestStatistics shared_statistics(chrono::minutes(5));
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&shared_statistics, &start, t] {
+            for (int i = 0; i < 20000; ++i) {
+                shared_statistics.Record(start + chrono::minutes(i % 3), chrono::microseconds(i % 100), (i + t) % 4 != 0);
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    stats = shared_statistics.GetStats(start + chrono::minutes(2));
+    ASSERT_EQUAL(stats.request_count, 80000u);
+    ASSERT_EQUAL(stats.no_result_count, 20000u);
+
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    RequestQueue request_queue(search_server);
+    for (int i = 0; i < 10; ++i) {
+        request_queue.AddFindRequest(i % 2 == 0 ? "cat"s : "dog"s);
+    }
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 5);
+    ASSERT_EQUAL(request_queue.GetStats().request_count, 10u);
+}
+
+void TestQueryProfiler() {
+    // Значение восстанавливается из корзины с точностью до 1/32
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 100000; ++value) {
+        histogram.Record(value);
+    }
+    ASSERT_EQUAL(histogram.GetCount(), 100000u);
+    ASSERT_EQUAL(histogram.GetMax(), 100000u);
+    for (const double quantile : {0.5, 0.99, 0.999}) {
+        const double exact = quantile * 100000;
+        ASSERT(abs(static_cast<double>(histogram.GetValueAtQuantile(quantile)) - exact) <= exact / 32);
+    }
+    ASSERT_EQUAL(histogram.GetValueAtQuantile(1.0), 100000u);
+
+    // Гистограммы завершившихся потоков не теряются
+    ResetQueryPhaseStats();
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i) {
+                RecordQueryPhase(QueryPhase::TOP_K, chrono::nanoseconds(i < 990 ? 100 : 50000));
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    vector<QueryPhaseStats> stats = GetQueryPhaseStats();
+    ASSERT_EQUAL(stats.size(), kQueryPhaseCount);
+    const QueryPhaseStats& top_k_stats = stats[static_cast<size_t>(QueryPhase::TOP_K)];
+    ASSERT_EQUAL(top_k_stats.count, 4000u);
+    ASSERT(top_k_stats.p50 >= chrono::nanoseconds(100) && top_k_stats.p50 < chrono::nanoseconds(104));
+    ASSERT(top_k_stats.p999 >= chrono::nanoseconds(48000));
+    ASSERT(top_k_stats.max == chrono::nanoseconds(50000));
+
+    ResetQueryPhaseStats();
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.FindTopDocuments("cat -dog"s);
+    stats = GetQueryPhaseStats();
+    for (const QueryPhaseStats& phase_stats : stats) {
+        // Без SEARCH_SERVER_PROFILE запрос ничего не замеряет
+        ASSERT_EQUAL(phase_stats.count > 0, kQueryProfilingEnabled);
+    }
+}
+
+void TestBenchmarkSuite() {
+    const BenchmarkConfig config = ParseBenchmarkConfig({"--documents=300"s, "--queries=20"s, "--zipf=1.2"s,
+                                                         "--warmup=0"s, "--repetitions=2"s, "--format=json"s});
+    ASSERT_EQUAL(config.document_count, 300u);
+    ASSERT_EQUAL(config.query_count, 20u);
+    ASSERT_EQUAL(config.repetition_count, 2u);
+    ASSERT(config.zipf_exponent == 1.2);
+    ASSERT(config.format == BenchmarkFormat::JSON);
+    for (const string& argument : {"--documents=0"s, "--documents=-5"s, "--zipf=x"s, "--duplicates=2"s,
+                                   "--format=xml"s, "--unknown=1"s, "documents=10"s}) {
+        try {
+            ParseBenchmarkConfig({argument});
+            ASSERT_HINT(false, argument);
+        } catch (const invalid_argument&) {
+        }
+    }
+
+    const vector<BenchmarkResult> results = RunBenchmarkSuite(config);
+    const vector<string> names = {"AddDocument"s, "FindTopDocuments seq"s, "FindTopDocuments par"s, "MatchDocument"s,
+                                  "RemoveDocument"s, "RemoveDuplicates"s};
+    const vector<size_t> operation_counts = {300, 20, 20, 20, 300, 1};
+    ASSERT_EQUAL(results.size(), names.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        ASSERT_EQUAL(results[i].name, names[i]);
+        ASSERT_EQUAL_HINT(results[i].operation_count, operation_counts[i], names[i]);
+        ASSERT_EQUAL_HINT(results[i].repetition_count, 2u, names[i]);
+        ASSERT_HINT(results[i].min_throughput <= results[i].median_throughput
+                    && results[i].median_throughput <= results[i].max_throughput, names[i]);
+        ASSERT_HINT(results[i].p50_nanoseconds <= results[i].p99_nanoseconds
+                    && results[i].p99_nanoseconds <= results[i].max_nanoseconds, names[i]);
+        // Тесты не заменяют operator new, поэтому выделения не считаются
+        ASSERT_HINT(results[i].allocations_per_operation < 0.0, names[i]);
+    }
+
+    ostringstream output;
+    PrintBenchmarkResults(output, config, results);
+    ASSERT(output.str().find("\"name\": \"RemoveDuplicates\""s) != string::npos);
+    ASSERT(output.str().find("\"allocations_per_op\": null"s) != string::npos);
+}
+
 #define RUN_TEST(func) func(); cerr << #func << " OK"s << endl
 
 void TestSearchServer() {
+    RUN_TEST(TestSplitIntoWords);
     RUN_TEST(TestGetWordFrequencies);
     RUN_TEST(TestRemoveDocument);
     RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestOutOfOrderAddAndRemove);
+    RUN_TEST(TestMinusWordsExcludeDocuments);
+    RUN_TEST(TestParallelSearchMatchesSequential);
+    RUN_TEST(TestMaxResultCount);
+    RUN_TEST(TestWandMatchesExhaustiveSearch);
+    RUN_TEST(TestCompressedIndexMatchesFlat);
+    RUN_TEST(TestSnapshotRoundTrip);
+    RUN_TEST(TestSnapshotRejectsInconsistentPostings);
+    RUN_TEST(TestAddDocumentsMatchesAddDocument);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestAllocatorStats);
+    RUN_TEST(TestConcurrentReadsDuringWrites);
+    RUN_TEST(TestSegmentedIndexMatchesRebuilt);
+    RUN_TEST(TestProcessQueries);
+    RUN_TEST(TestSharedScanMatchesSingleQueries);
+    RUN_TEST(TestQueryResultCache);
+    RUN_TEST(TestQuantizedScoresApproximateExact);
+    RUN_TEST(TestStatusFilterMatchesPredicate);
+    RUN_TEST(TestRequiredAndMinusWords);
+    RUN_TEST(TestMatchDocuments);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestFindDuplicates);
+    RUN_TEST(TestRequestStatistics);
+    RUN_TEST(TestQueryProfiler);
+    RUN_TEST(TestBenchmarkSuite);
 }
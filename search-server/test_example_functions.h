@@ -1,9 +1,61 @@
 #pragma once
 
+void TestSplitIntoWords();
+
 void TestGetWordFrequencies();
 
 void TestRemoveDocument();
 
 void TestRemoveDuplicates();
 
+void TestOutOfOrderAddAndRemove();
+
+void TestMinusWordsExcludeDocuments();
+
+void TestParallelSearchMatchesSequential();
+
+void TestMaxResultCount();
+
+void TestWandMatchesExhaustiveSearch();
+
+void TestCompressedIndexMatchesFlat();
+
+void TestSnapshotRoundTrip();
+
+void TestSnapshotRejectsInconsistentPostings();
+
+void TestAddDocumentsMatchesAddDocument();
+
+void TestTermDictionary();
+
+void TestAllocatorStats();
+
+void TestConcurrentReadsDuringWrites();
+
+void TestSegmentedIndexMatchesRebuilt();
+
+void TestProcessQueries();
+
+void TestSharedScanMatchesSingleQueries();
+
+void TestQueryResultCache();
+
+void TestQuantizedScoresApproximateExact();
+
+void TestStatusFilterMatchesPredicate();
+
+void TestRequiredAndMinusWords();
+
+void TestMatchDocuments();
+
+void TestShardedSearchServer();
+
+void TestFindDuplicates();
+
+void TestRequestStatistics();
+
+void TestQueryProfiler();
+
+void TestBenchmarkSuite();
+
 void TestSearchServer();
@@ -0,0 +1,56 @@
+#include "top_documents_collector.h"
+
+#include <algorithm>
+#include <cmath>
+
+TopDocumentsCollector::TopDocumentsCollector(std::size_t max_count, std::pmr::memory_resource* resource)
+        : max_count_(max_count)
+        , documents_(resource) {
+    documents_.reserve(max_count_);
+}
+
+void TopDocumentsCollector::Merge(const TopDocumentsCollector& other) {
+    for (const Document& document : other.documents_) {
+        Add(document);
+    }
+}
+
+std::size_t TopDocumentsCollector::GetMaxCount() const {
+    return max_count_;
+}
+
+bool TopDocumentsCollector::IsFull() const {
+    return documents_.size() == max_count_;
+}
+
+const Document& TopDocumentsCollector::GetWorst() const {
+    return documents_.front();
+}
+
+std::vector<Document> TopDocumentsCollector::Extract() {
+    std::sort_heap(documents_.begin(), documents_.end(), IsBetter);
+    std::vector<Document> result(documents_.begin(), documents_.end());
+    documents_.clear();
+    return result;
+}
+
+bool TopDocumentsCollector::IsBetter(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= kEpsilon) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+void TopDocumentsCollector::Push(const Document& document) {
+    documents_.push_back(document);
+    std::push_heap(documents_.begin(), documents_.end(), IsBetter);
+}
+
+void TopDocumentsCollector::ReplaceWorst(const Document& document) {
+    std::pop_heap(documents_.begin(), documents_.end(), IsBetter);
+    documents_.back() = document;
+    std::push_heap(documents_.begin(), documents_.end(), IsBetter);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+#include "document.h"
+
+// Отбирает K лучших документов из потока через ограниченную кучу, не храня
+// остальные. Документы с релевантностью в пределах kEpsilon упорядочиваются
+// по рейтингу, а при равном рейтинге выше документ с меньшим id
+class TopDocumentsCollector {
+public:
+    static constexpr double kEpsilon = 1e-6;
+
+    // Куча резервируется сразу на max_count документов, поэтому Add ничего не выделяет
+    explicit TopDocumentsCollector(std::size_t max_count,
+                                   std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void Add(const Document& document) {
+        if (documents_.size() < max_count_) {
+            Push(document);
+        } else if (max_count_ > 0 && IsBetter(document, documents_.front())) {
+            ReplaceWorst(document);
+        }
+    }
+
+    void Merge(const TopDocumentsCollector& other);
+
+    std::size_t GetMaxCount() const;
+
+    bool IsFull() const;
+
+    // Худший из отобранных документов; вызывать только для заполненного сборщика
+    const Document& GetWorst() const;
+
+    // Возвращает отобранные документы от лучшего к худшему
+    std::vector<Document> Extract();
+
+    static bool IsBetter(const Document& lhs, const Document& rhs);
+
+private:
+    std::size_t max_count_;
+    // Куча, на вершине которой худший из отобранных документов
+    std::pmr::vector<Document> documents_;
+
+    void Push(const Document& document);
+
+    void ReplaceWorst(const Document& document);
+};
@@ -0,0 +1,63 @@
+#include "word_set_hash.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+
+std::uint64_t MixHash(std::uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+}  // namespace
+
+std::uint64_t HashWordSet(const TermFrequencies& term_freqs) {
+    std::uint64_t hash = MixHash(term_freqs.size);
+    for (std::size_t i = 0; i < term_freqs.size; ++i) {
+        hash = MixHash(hash ^ (term_freqs.terms[i] + 0x9e3779b97f4a7c15ULL));
+    }
+    return hash;
+}
+
+void ComputeMinHashSignature(const TermFrequencies& term_freqs, std::vector<std::uint64_t>& signature) {
+    // k-я функция - a_k·h + b_k с нечётным a_k и сдвигом-xor: одно умножение на слово
+    // и функцию вместо полного перемешивания
+    thread_local std::vector<std::pair<std::uint64_t, std::uint64_t>> coefficients;
+    for (std::size_t k = coefficients.size(); k < signature.size(); ++k) {
+        coefficients.emplace_back(MixHash(2 * k + 1) | 1, MixHash(2 * k + 2));
+    }
+    std::fill(signature.begin(), signature.end(), std::numeric_limits<std::uint64_t>::max());
+    for (std::size_t i = 0; i < term_freqs.size; ++i) {
+        const std::uint64_t term_hash = MixHash(term_freqs.terms[i]);
+        for (std::size_t k = 0; k < signature.size(); ++k) {
+            std::uint64_t value = term_hash * coefficients[k].first + coefficients[k].second;
+            value ^= value >> 29;
+            signature[k] = std::min(signature[k], value);
+        }
+    }
+}
+
+double ComputeJaccardSimilarity(const TermFrequencies& lhs, const TermFrequencies& rhs) {
+    if (lhs.size == 0 && rhs.size == 0) {
+        return 1.0;
+    }
+    std::size_t common_count = 0;
+    for (std::size_t i = 0, j = 0; i < lhs.size && j < rhs.size;) {
+        if (lhs.terms[i] < rhs.terms[j]) {
+            ++i;
+        } else if (rhs.terms[j] < lhs.terms[i]) {
+            ++j;
+        } else {
+            ++common_count;
+            ++i;
+            ++j;
+        }
+    }
+    return static_cast<double>(common_count) / (lhs.size + rhs.size - common_count);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "term_dictionary.h"
+
+// Отпечаток набора слов документа: у документов с одним набором слов он совпадает,
+// от частот не зависит
+std::uint64_t HashWordSet(const TermFrequencies& term_freqs);
+
+// MinHash-подпись набора слов: signature[k] - наименьшее значение k-й хэш-функции по словам
+// документа. Доля совпавших позиций двух подписей оценивает меру Жаккара их наборов
+void ComputeMinHashSignature(const TermFrequencies& term_freqs, std::vector<std::uint64_t>& signature);
+
+// Мера Жаккара: доля общих слов в объединении наборов. Два пустых набора одинаковы
+double ComputeJaccardSimilarity(const TermFrequencies& lhs, const TermFrequencies& rhs);
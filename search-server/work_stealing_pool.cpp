@@ -0,0 +1,170 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Пул, задачу которого сейчас выполняет этот поток: вложенный ParallelFor на том же пуле
+// выполняется последовательно, иначе он ждал бы потоки, занятые внешним вызовом
+thread_local const WorkStealingPool* current_pool = nullptr;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t thread_count)
+        : ranges_(std::max<std::size_t>(thread_count, 1)) {
+    threads_.reserve(ranges_.size() - 1);
+    for (std::size_t worker = 1; worker < ranges_.size(); ++worker) {
+        threads_.emplace_back([this, worker] {
+            RunThread(worker);
+        });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)>& task) {
+    if (current_pool == this || ranges_.size() == 1 || count < 2
+        || is_busy_.exchange(true, std::memory_order_acquire)) {
+        for (std::size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    // Задачи делятся поровну заранее, кража лишь выравнивает их длительность
+    const std::size_t worker_count = ranges_.size();
+    for (std::size_t worker = 0; worker < worker_count; ++worker) {
+        std::lock_guard guard(ranges_[worker].mutex);
+        ranges_[worker].begin = count * worker / worker_count;
+        ranges_[worker].end = count * (worker + 1) / worker_count;
+    }
+    {
+        std::lock_guard guard(mutex_);
+        task_ = &task;
+        is_cancelled_.store(false);
+        error_ = nullptr;
+        running_count_ = threads_.size();
+        ++generation_;
+    }
+    wake_up_.notify_all();
+
+    const WorkStealingPool* const outer_pool = std::exchange(current_pool, this);
+    Work(0);
+    current_pool = outer_pool;
+
+    std::unique_lock lock(mutex_);
+    finished_.wait(lock, [this] {
+        return running_count_ == 0;
+    });
+    task_ = nullptr;
+    const std::exception_ptr error = std::exchange(error_, nullptr);
+    lock.unlock();
+    is_busy_.store(false, std::memory_order_release);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::size_t WorkStealingPool::GetThreadCount() const {
+    return ranges_.size();
+}
+
+void WorkStealingPool::RunThread(std::size_t worker) {
+    current_pool = this;
+    std::size_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            wake_up_.wait(lock, [this, generation] {
+                return is_stopping_ || generation_ != generation;
+            });
+            if (is_stopping_) {
+                return;
+            }
+            generation = generation_;
+        }
+        Work(worker);
+        {
+            std::lock_guard guard(mutex_);
+            --running_count_;
+        }
+        finished_.notify_one();
+    }
+}
+
+void WorkStealingPool::Work(std::size_t worker) {
+    std::size_t task = 0;
+    while (TakeTask(worker, task) || (Steal(worker) && TakeTask(worker, task))) {
+        try {
+            (*task_)(task);
+        } catch (...) {
+            std::lock_guard guard(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            is_cancelled_.store(true);
+        }
+    }
+}
+
+bool WorkStealingPool::TakeTask(std::size_t worker, std::size_t& task) {
+    WorkRange& range = ranges_[worker];
+    std::lock_guard guard(range.mutex);
+    if (range.begin == range.end) {
+        return false;
+    }
+    if (is_cancelled_.load(std::memory_order_relaxed)) {
+        range.begin = range.end;
+        return false;
+    }
+    task = range.begin++;
+    return true;
+}
+
+bool WorkStealingPool::Steal(std::size_t worker) {
+    // Задачи только переходят между отрезками, поэтому если все чужие отрезки
+    // пусты, новых задач уже не появится
+    while (true) {
+        std::size_t victim = worker;
+        std::size_t victim_size = 0;
+        for (std::size_t i = 1; i < ranges_.size(); ++i) {
+            const std::size_t candidate = (worker + i) % ranges_.size();
+            std::lock_guard guard(ranges_[candidate].mutex);
+            const std::size_t size = ranges_[candidate].end - ranges_[candidate].begin;
+            if (size > victim_size) {
+                victim = candidate;
+                victim_size = size;
+            }
+        }
+        if (victim_size == 0) {
+            return false;
+        }
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        {
+            WorkRange& range = ranges_[victim];
+            std::lock_guard guard(range.mutex);
+            if (range.begin == range.end) {
+                // Пока выбирали, отрезок успели опустошить
+                continue;
+            }
+            end = range.end;
+            begin = range.end - (range.end - range.begin + 1) / 2;
+            range.end = begin;
+        }
+        std::lock_guard guard(ranges_[worker].mutex);
+        ranges_[worker].begin = begin;
+        ranges_[worker].end = end;
+        return true;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков для обработки пачки независимых задач с номерами [0, count). Каждому
+// потоку достаётся свой отрезок номеров; он берёт задачи с его начала, а закончив
+// свой отрезок, отнимает половину самого длинного из чужих. Так задачи разной
+// длины делятся без общей очереди, за которую спорили бы все потоки. Потоки живут
+// столько же, сколько пул, поэтому их thread_local буферы переживают вызовы ParallelFor
+class WorkStealingPool {
+public:
+    // Вызывающий ParallelFor поток тоже работает, поэтому фоновых потоков на один меньше
+    explicit WorkStealingPool(std::size_t thread_count = std::thread::hardware_concurrency());
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool();
+
+    // Выполняет task(i) для каждого i из [0, count) и ждёт, пока все задачи закончатся.
+    // Первое исключение из задачи отменяет ещё не начатые задачи и бросается отсюда.
+    // Пул обслуживает один вызов за раз. Вложенный вызов из задачи этого же пула и вызов
+    // из другого потока, пока пул занят, не ждут его, а выполняют все задачи сами в вызывающем потоке
+    void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& task);
+
+    std::size_t GetThreadCount() const;
+
+private:
+    // Отрезок задач потока; его конец могут укоротить другие потоки
+    struct alignas(64) WorkRange {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    std::vector<WorkRange> ranges_;
+    std::vector<std::thread> threads_;
+
+    std::atomic<bool> is_busy_ = false;
+    std::mutex mutex_;
+    std::condition_variable wake_up_;
+    std::condition_variable finished_;
+    const std::function<void(std::size_t)>* task_ = nullptr;
+    std::size_t generation_ = 0;
+    std::size_t running_count_ = 0;
+    std::atomic<bool> is_cancelled_ = false;
+    bool is_stopping_ = false;
+    std::exception_ptr error_;
+
+    void RunThread(std::size_t worker);
+
+    // Выполняет задачи потока worker, пока их не останется ни у кого
+    void Work(std::size_t worker);
+
+    bool TakeTask(std::size_t worker, std::size_t& task);
+
+    bool Steal(std::size_t worker);
+};